@@ -0,0 +1,77 @@
+#include "blockcache.h"
+
+using namespace PSEmu;
+
+BlockCache::BlockCache() : m_blocks{}, m_pageBlocks{}, m_generation{ 1 } { }
+
+DecodedBlock* BlockCache::Find(uint32_t physAddr)
+{
+    auto foundIt = m_blocks.find(physAddr);
+    if (foundIt != m_blocks.cend())
+    {
+        return &foundIt->second;
+    }
+
+    return nullptr;
+}
+
+DecodedBlock& BlockCache::Insert(uint32_t physAddr, DecodedBlock block)
+{
+    m_pageBlocks[physAddr / PAGE_SIZE].push_back(physAddr);
+
+    // References to the elements of an unordered_map stay valid on insertion
+    return m_blocks[physAddr] = std::move(block);
+}
+
+// Returns the block previously linked to <block> for <address>, if the link is still valid
+DecodedBlock* BlockCache::FollowLink(const DecodedBlock& block, uint32_t address) const
+{
+    for (const BlockLink& link : block.m_links)
+    {
+        if (link.m_address == address && link.m_generation == m_generation)
+        {
+            return link.m_block;
+        }
+    }
+
+    return nullptr;
+}
+
+// Record that <successor> starts at <address> and was executed after <block>.
+// <blockEnd> is the address following <block>, reached when no branch was taken.
+void BlockCache::Link(DecodedBlock& block, uint32_t blockEnd, uint32_t address, DecodedBlock& successor) const
+{
+    BlockLink& link = block.m_links[address == blockEnd ? 0 : 1];
+
+    link.m_address = address;
+    link.m_generation = m_generation;
+    link.m_block = &successor;
+}
+
+// Drop every block decoded from the page containing <physAddr>.
+// Called when the content of that page is modified.
+void BlockCache::InvalidatePage(uint32_t physAddr)
+{
+    auto foundIt = m_pageBlocks.find(physAddr / PAGE_SIZE);
+    if (foundIt == m_pageBlocks.end())
+    {
+        return;
+    }
+
+    for (uint32_t blockAddr : foundIt->second)
+    {
+        m_blocks.erase(blockAddr);
+    }
+
+    m_pageBlocks.erase(foundIt);
+
+    // Links pointing to the erased blocks are now dangling
+    ++m_generation;
+}
+
+void BlockCache::Clear()
+{
+    m_blocks.clear();
+    m_pageBlocks.clear();
+    ++m_generation;
+}
@@ -0,0 +1,96 @@
+#ifndef BLOCK_CACHE_H
+#define BLOCK_CACHE_H
+
+#include "instruction.h"
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace PSEmu
+{
+
+class R3000A;
+
+// Pointer to the R3000A method executing a given instruction
+using InstructionHandler = void (R3000A::*)(Instruction);
+
+// Instruction decoded once and kept around so it doesn't have to be fetched
+// through the interconnect and decoded again every time it's executed
+struct DecodedInstruction
+{
+    InstructionHandler m_handler;
+    Instruction m_inst;
+};
+
+struct DecodedBlock;
+
+// Direct link from a block to one of the blocks executed after it.
+// A link is only valid if no block was invalidated since it was made.
+struct BlockLink
+{
+    uint32_t m_address = 0;
+    uint32_t m_generation = 0;
+    DecodedBlock* m_block = nullptr;
+};
+
+// Straight line sequence of instructions ending after the delay slot
+// of the first branch or jump (or at the end of a page)
+struct DecodedBlock
+{
+    std::vector<DecodedInstruction> m_instructions;
+
+    // Last successors seen for the fall through and the taken branch paths
+    std::array<BlockLink, 2> m_links;
+
+    // Set when the block is a loop back to itself whose outcome only depends
+    // on memory: running it again changes nothing until a device does
+    bool m_isIdleLoop = false;
+};
+
+class BlockCache
+{
+public:
+    // Blocks never cross a page boundary so that invalidating a page
+    // only has to look at the blocks starting in it
+    static constexpr uint32_t PAGE_SIZE = 4 * 1024;
+
+    // Upper bound on the number of instructions decoded in one go
+    static constexpr uint32_t MAX_BLOCK_SIZE = 64;
+
+public:
+    BlockCache();
+
+    // It should not be possible to copy an instance of this class
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    // But it should be possible to move it
+    BlockCache(BlockCache&&) = default;
+    BlockCache& operator=(BlockCache&&) = default;
+
+public:
+    DecodedBlock* Find(uint32_t physAddr);
+    DecodedBlock& Insert(uint32_t physAddr, DecodedBlock block);
+
+    DecodedBlock* FollowLink(const DecodedBlock& block, uint32_t address) const;
+    void Link(DecodedBlock& block, uint32_t blockEnd, uint32_t address, DecodedBlock& successor) const;
+
+    void InvalidatePage(uint32_t physAddr);
+    void Clear();
+
+private:
+    // Decoded blocks keyed by the physical address of their first instruction
+    std::unordered_map<uint32_t, DecodedBlock> m_blocks;
+
+    // Start addresses of the blocks contained in each page
+    std::unordered_map<uint32_t, std::vector<uint32_t>> m_pageBlocks;
+
+    // Bumped every time blocks are thrown away, which breaks all existing links
+    uint32_t m_generation;
+};
+
+}   // end namespace PSEmu
+
+#endif // BLOCK_CACHE_H
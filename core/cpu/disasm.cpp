@@ -126,6 +126,7 @@ std::string DisassembleInstruction(const Instruction& inst)
         case SWC1:    DisassembleMemoryInstruction(instStream, "SWC1", inst); break;
         case SWC2:    DisassembleMemoryInstruction(instStream, "SWC2", inst); break;
         case SWC3:    DisassembleMemoryInstruction(instStream, "SWC3", inst); break;
+        case HLE:     DisassembleImmediateTypeInstruction(instStream, "HLE", inst.GetImm()); break;
         default:
             assert(false && "Unhandled opcode");
             std::cout << inst.GetOp() << std::endl;
@@ -0,0 +1,1093 @@
+#include "hlebios.h"
+
+#include "opcodes.h"
+#include "r3000a.h"
+
+#include "../memory/memorymap.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+using namespace PSEmu;
+
+namespace
+{
+
+// Registers used by the calling convention
+constexpr uint32_t V0 = 2;
+constexpr uint32_t A0 = 4;
+constexpr uint32_t A1 = 5;
+constexpr uint32_t A2 = 6;
+constexpr uint32_t A3 = 7;
+constexpr uint32_t S0 = 16;
+constexpr uint32_t GP = 28;
+constexpr uint32_t SP = 29;
+constexpr uint32_t FP = 30;
+constexpr uint32_t RA = 31;
+
+// The BIOS leaves the stack at the top of RAM when it starts the shell
+constexpr uint32_t INITIAL_SP = 0x801FFF00;
+
+// Area used by the BIOS for alloc_kernel_memory
+constexpr uint32_t KERNEL_HEAP_ADDRESS = 0xA000E000;
+constexpr uint32_t KERNEL_HEAP_SIZE = 0x2000;
+
+// Addresses of the BIOS function tables, returned to the programs patching them
+constexpr uint32_t B_TABLE_ADDRESS = 0x00000874;
+constexpr uint32_t C_TABLE_ADDRESS = 0x00000674;
+
+constexpr uint32_t EVENT_HANDLE_BASE = 0xF1000000;
+
+// Event status
+constexpr uint32_t EVENT_FREE = 0x0000;
+constexpr uint32_t EVENT_DISABLED = 0x1000;
+constexpr uint32_t EVENT_ENABLED = 0x2000;
+constexpr uint32_t EVENT_READY = 0x4000;
+
+// Event delivered by the interrupts of the root counters (VBLANK is the fourth one)
+constexpr uint32_t ROOT_COUNTER_EVENT_CLASS = 0xF2000000;
+constexpr uint32_t INTERRUPT_EVENT_SPEC = 0x0002;
+
+constexpr uint32_t STDOUT = 1;
+
+// Guest accesses are never allowed past the size of RAM
+constexpr uint32_t MAX_ACCESS_SIZE = 2 * 1024 * 1024;
+
+// Returns the offset of [<address>, <address> + <size>) in RAM if it's entirely in one of its mirrors
+std::optional<uint32_t> GetRAMOffset(const Interconnect& interconnect, uint32_t address, uint32_t size)
+{
+    const auto mirrorOffset = RAM_MIRRORS_RANGE.Contains(interconnect.GetPhysicalAddress(address));
+    if (!mirrorOffset || (*mirrorOffset % RAM_SIZE) + size > RAM_SIZE)
+    {
+        return std::nullopt;
+    }
+
+    return *mirrorOffset % RAM_SIZE;
+}
+
+std::vector<uint8_t> ReadGuest(Interconnect& interconnect, uint32_t address, uint32_t size)
+{
+    std::vector<uint8_t> data(std::min(size, MAX_ACCESS_SIZE));
+
+    if (auto offset = GetRAMOffset(interconnect, address, data.size()))
+    {
+        interconnect.GetRAM().ReadSpan(*offset, data.data(), data.size());
+        return data;
+    }
+
+    for (size_t iByte = 0; iByte < data.size(); ++iByte)
+    {
+        data[iByte] = interconnect.Load<uint8_t>(address + iByte);
+    }
+
+    return data;
+}
+
+void WriteGuest(Interconnect& interconnect, uint32_t address, const uint8_t* src, uint32_t size)
+{
+    size = std::min(size, MAX_ACCESS_SIZE);
+
+    if (auto offset = GetRAMOffset(interconnect, address, size))
+    {
+        interconnect.GetRAM().WriteSpan(*offset, src, size);
+        return;
+    }
+
+    for (uint32_t iByte = 0; iByte < size; ++iByte)
+    {
+        interconnect.Store<uint8_t>(address + iByte, src[iByte]);
+    }
+}
+
+void WriteGuest(Interconnect& interconnect, uint32_t address, const std::string& str)
+{
+    // Including the terminating null character
+    WriteGuest(interconnect, address, reinterpret_cast<const uint8_t*>(str.c_str()), str.size() + 1);
+}
+
+std::string ReadString(Interconnect& interconnect, uint32_t address, uint32_t maxLength = MAX_ACCESS_SIZE)
+{
+    std::string str;
+    for (char c; str.size() < maxLength && (c = interconnect.Load<uint8_t>(address + str.size())) != '\0'; )
+    {
+        str += c;
+    }
+
+    return str;
+}
+
+// Sign of the comparison of the first differing characters, like the C library
+uint32_t Compare(const std::string& lhs, const std::string& rhs)
+{
+    const int result = lhs.compare(rhs);
+    return (result > 0) - (result < 0);
+}
+
+uint32_t Compare(const std::vector<uint8_t>& lhs, const std::vector<uint8_t>& rhs)
+{
+    const auto [lhsIt, rhsIt] = std::mismatch(lhs.cbegin(), lhs.cend(), rhs.cbegin());
+    return lhsIt == lhs.cend() ? 0 : (*lhsIt > *rhsIt) - (*lhsIt < *rhsIt);
+}
+
+template <typename T>
+void AppendFormatted(std::string& out, const std::string& spec, T value)
+{
+    const int length = std::snprintf(nullptr, 0, spec.c_str(), value);
+    if (length <= 0)
+    {
+        return;
+    }
+
+    const size_t start = out.size();
+    out.resize(start + length + 1);
+    std::snprintf(&out[start], length + 1, spec.c_str(), value);
+    out.resize(start + length);
+}
+
+}   // end anonymous namespace
+
+HLEBios::HLEBios()
+    : m_savedRegisters{},
+      m_savedHi{ 0 },
+      m_savedLo{ 0 },
+      m_returnAddress{ 0 },
+      m_customExit{ 0 },
+      m_clearRCnt{},
+      m_events{},
+      m_heap{},
+      m_kernelHeap{},
+      m_randSeed{ 1 },
+      m_reportedCalls{},
+      m_outputEnabled{ true }
+{
+}
+
+// Install the kernel in RAM and leave the CPU where the BIOS starts the shell
+void HLEBios::Reset(R3000A& cpu)
+{
+    m_savedRegisters.fill(0);
+    m_savedHi = 0;
+    m_savedLo = 0;
+    m_returnAddress = 0;
+    m_customExit = 0;
+    m_clearRCnt.fill(true);
+    m_events.fill(Event{});
+    m_heap = Heap{};
+    m_kernelHeap.Init(KERNEL_HEAP_ADDRESS, KERNEL_HEAP_SIZE);
+    m_randSeed = 1;
+    m_reportedCalls.clear();
+
+    Interconnect& interconnect = cpu.m_interconnect;
+    for (uint32_t vector : { EXCEPTION_VECTOR, A_VECTOR, B_VECTOR, C_VECTOR })
+    {
+        interconnect.Store<uint32_t>(vector, HLE | vector);
+    }
+
+    // The shell only waits: executables are side loaded in its place
+    interconnect.Store<uint32_t>(SHELL_ENTRY_ADDRESS, J | ((SHELL_ENTRY_ADDRESS >> 2) & 0x03FFFFFF));
+    interconnect.Store<uint32_t>(SHELL_ENTRY_ADDRESS + 4, 0);
+
+    cpu.SetRegister(SP, INITIAL_SP);
+
+    // Interrupts from the interrupt controller are enabled
+    cpu.m_sr = 0x401;
+    cpu.SetPC(SHELL_ENTRY_ADDRESS);
+}
+
+// Run the kernel code found at <vector>
+void HLEBios::Execute(R3000A& cpu, uint32_t vector)
+{
+    // The native code has to see the value loaded by the previous instruction
+    cpu.m_registers[cpu.m_delayedLoad.first] = cpu.m_delayedLoad.second;
+    cpu.m_registers[0] = 0;
+    cpu.m_delayedLoad = {};
+
+    // The function number is passed in T1
+    const uint32_t function = cpu.m_registers[9] & 0xFF;
+
+    switch (vector)
+    {
+        case EXCEPTION_VECTOR: HandleException(cpu); break;
+        case A_VECTOR:         CallA(cpu, function); break;
+        case B_VECTOR:         CallB(cpu, function); break;
+        case C_VECTOR:         CallC(cpu, function); break;
+        default:               CallUnimplemented(cpu, '?', vector); break;
+    }
+}
+
+void HLEBios::SetOutputEnabled(bool enabled)
+{
+    m_outputEnabled = enabled;
+}
+
+void HLEBios::Save(Utils::StateWriter& writer) const
+{
+    for (uint32_t value : m_savedRegisters)
+    {
+        writer.Write(value);
+    }
+    writer.Write(m_savedHi);
+    writer.Write(m_savedLo);
+    writer.Write(m_returnAddress);
+
+    writer.Write(m_customExit);
+    for (bool clear : m_clearRCnt)
+    {
+        writer.Write(clear);
+    }
+
+    for (const Event& event : m_events)
+    {
+        writer.Write(event.m_class);
+        writer.Write(event.m_spec);
+        writer.Write(event.m_mode);
+        writer.Write(event.m_status);
+    }
+
+    m_heap.Save(writer);
+    m_kernelHeap.Save(writer);
+    writer.Write(m_randSeed);
+}
+
+void HLEBios::Load(Utils::StateReader& reader)
+{
+    for (uint32_t& value : m_savedRegisters)
+    {
+        reader.Read(value);
+    }
+    reader.Read(m_savedHi);
+    reader.Read(m_savedLo);
+    reader.Read(m_returnAddress);
+
+    reader.Read(m_customExit);
+    for (bool& clear : m_clearRCnt)
+    {
+        reader.Read(clear);
+    }
+
+    for (Event& event : m_events)
+    {
+        reader.Read(event.m_class);
+        reader.Read(event.m_spec);
+        reader.Read(event.m_mode);
+        reader.Read(event.m_status);
+    }
+
+    m_heap.Load(reader);
+    m_kernelHeap.Load(reader);
+    reader.Read(m_randSeed);
+}
+
+void HLEBios::CallA(R3000A& cpu, uint32_t function)
+{
+    Interconnect& interconnect = cpu.m_interconnect;
+    const std::array<uint32_t, 32>& regs = cpu.m_registers;
+    const uint32_t a0 = regs[A0];
+    const uint32_t a1 = regs[A1];
+    const uint32_t a2 = regs[A2];
+
+    switch (function)
+    {
+        // Files: only the TTY is available
+        case 0x00:  // open(filename, accessmode)
+        case 0x01:  // lseek(fd, offset, seektype)
+        case 0x02:  // read(fd, dst, length)
+            Return(cpu, -1);
+            break;
+        case 0x03:  // write(fd, src, length)
+        {
+            if (a0 != STDOUT)
+            {
+                Return(cpu, -1);
+                break;
+            }
+
+            const std::vector<uint8_t> data = ReadGuest(interconnect, a1, a2);
+            WriteTTY({ reinterpret_cast<const char*>(data.data()), data.size() });
+            Return(cpu, data.size());
+            break;
+        }
+        case 0x04:  // close(fd)
+            Return(cpu, a0 <= STDOUT ? a0 : -1);
+            break;
+        case 0x09:  // putc(char, fd)
+            if (a1 == STDOUT)
+            {
+                WriteTTY(std::string(1, static_cast<char>(a0)));
+            }
+            Return(cpu, a0);
+            break;
+
+        // Integers
+        case 0x0E:  // abs(val)
+        case 0x0F:  // labs(val)
+            Return(cpu, std::abs(static_cast<int32_t>(a0)));
+            break;
+        case 0x10:  // atoi(src)
+        case 0x11:  // atol(src)
+            Return(cpu, std::strtol(ReadString(interconnect, a0).c_str(), nullptr, 10));
+            break;
+
+        // Non local jumps
+        case 0x13:  // setjmp(buf)
+            SetJmp(cpu, a0);
+            Return(cpu, 0);
+            break;
+        case 0x14:  // longjmp(buf, param)
+            LongJmp(cpu, a0, a1);
+            break;
+
+        // Strings
+        case 0x15:  // strcat(dst, src)
+            if (a0 != 0 && a1 != 0)
+            {
+                const uint32_t length = ReadString(interconnect, a0).size();
+                WriteGuest(interconnect, a0 + length, ReadString(interconnect, a1));
+            }
+            Return(cpu, a0);
+            break;
+        case 0x16:  // strncat(dst, src, maxlen)
+            if (a0 != 0 && a1 != 0)
+            {
+                const uint32_t length = ReadString(interconnect, a0).size();
+                WriteGuest(interconnect, a0 + length, ReadString(interconnect, a1, a2));
+            }
+            Return(cpu, a0);
+            break;
+        case 0x17:  // strcmp(str1, str2)
+            Return(cpu, Compare(ReadString(interconnect, a0), ReadString(interconnect, a1)));
+            break;
+        case 0x18:  // strncmp(str1, str2, maxlen)
+            Return(cpu, Compare(ReadString(interconnect, a0, a2), ReadString(interconnect, a1, a2)));
+            break;
+        case 0x19:  // strcpy(dst, src)
+            if (a0 != 0 && a1 != 0)
+            {
+                WriteGuest(interconnect, a0, ReadString(interconnect, a1));
+            }
+            Return(cpu, a0);
+            break;
+        case 0x1A:  // strncpy(dst, src, maxlen)
+            if (a0 != 0 && a1 != 0)
+            {
+                // The rest of the destination is filled with zeroes
+                std::string str = ReadString(interconnect, a1, a2);
+                str.resize(std::min(a2, MAX_ACCESS_SIZE), '\0');
+                WriteGuest(interconnect, a0, reinterpret_cast<const uint8_t*>(str.data()), str.size());
+            }
+            Return(cpu, a0);
+            break;
+        case 0x1B:  // strlen(src)
+            Return(cpu, a0 != 0 ? ReadString(interconnect, a0).size() : 0);
+            break;
+        case 0x1C:  // index(src, char)
+        case 0x1E:  // strchr(src, char)
+        case 0x1D:  // rindex(src, char)
+        case 0x1F:  // strrchr(src, char)
+        {
+            // The terminating null character can be searched for too
+            const std::string str = ReadString(interconnect, a0);
+            const char c = static_cast<char>(a1);
+            const size_t position = (function == 0x1C || function == 0x1E) ? str.find(c) : str.rfind(c);
+            if (c == '\0')
+            {
+                Return(cpu, a0 + str.size());
+            }
+            else
+            {
+                Return(cpu, position != std::string::npos ? a0 + position : 0);
+            }
+            break;
+        }
+        case 0x25:  // toupper(char)
+            Return(cpu, std::toupper(a0 & 0xFF));
+            break;
+        case 0x26:  // tolower(char)
+            Return(cpu, std::tolower(a0 & 0xFF));
+            break;
+
+        // Memory
+        case 0x27:  // bcopy(src, dst, len)
+        {
+            const std::vector<uint8_t> data = ReadGuest(interconnect, a0, a2);
+            WriteGuest(interconnect, a1, data.data(), data.size());
+            Return(cpu, a1);
+            break;
+        }
+        case 0x28:  // bzero(dst, len)
+        {
+            const std::vector<uint8_t> zeroes(std::min(a1, MAX_ACCESS_SIZE));
+            WriteGuest(interconnect, a0, zeroes.data(), zeroes.size());
+            Return(cpu, a0);
+            break;
+        }
+        case 0x29:  // bcmp(ptr1, ptr2, len)
+        case 0x2D:  // memcmp(src1, src2, len)
+            Return(cpu, Compare(ReadGuest(interconnect, a0, a2), ReadGuest(interconnect, a1, a2)));
+            break;
+        case 0x2A:  // memcpy(dst, src, len)
+        case 0x2C:  // memmove(dst, src, len)
+        {
+            // The source is read entirely before anything is written so overlaps are handled
+            const std::vector<uint8_t> data = ReadGuest(interconnect, a1, a2);
+            WriteGuest(interconnect, a0, data.data(), data.size());
+            Return(cpu, a0);
+            break;
+        }
+        case 0x2B:  // memset(dst, fillbyte, len)
+        {
+            const std::vector<uint8_t> data(std::min(a2, MAX_ACCESS_SIZE), static_cast<uint8_t>(a1));
+            WriteGuest(interconnect, a0, data.data(), data.size());
+            Return(cpu, a0);
+            break;
+        }
+        case 0x2E:  // memchr(src, scanbyte, len)
+        {
+            const std::vector<uint8_t> data = ReadGuest(interconnect, a0, a2);
+            const auto foundIt = std::find(data.cbegin(), data.cend(), static_cast<uint8_t>(a1));
+            Return(cpu, foundIt != data.cend() ? a0 + (foundIt - data.cbegin()) : 0);
+            break;
+        }
+
+        // Random numbers, same generator as the BIOS
+        case 0x2F:  // rand()
+            m_randSeed = m_randSeed * 0x41C64E6D + 0x3039;
+            Return(cpu, (m_randSeed >> 16) & 0x7FFF);
+            break;
+        case 0x30:  // srand(seed)
+            m_randSeed = a0;
+            Return(cpu, 0);
+            break;
+
+        // Heap
+        case 0x33:  // malloc(size)
+            Return(cpu, m_heap.Allocate(a0));
+            break;
+        case 0x34:  // free(buf)
+            m_heap.Free(a0);
+            Return(cpu, 0);
+            break;
+        case 0x37:  // calloc(sizx, sizy)
+        {
+            const uint64_t size = static_cast<uint64_t>(a0) * a1;
+            const uint32_t address = size <= MAX_ACCESS_SIZE ? m_heap.Allocate(size) : 0;
+            if (address != 0)
+            {
+                const std::vector<uint8_t> zeroes(size);
+                WriteGuest(interconnect, address, zeroes.data(), zeroes.size());
+            }
+            Return(cpu, address);
+            break;
+        }
+        case 0x38:  // realloc(old_buf, new_size)
+        {
+            const uint32_t address = a1 != 0 ? m_heap.Allocate(a1) : 0;
+            if (address != 0 && a0 != 0)
+            {
+                const std::vector<uint8_t> data = ReadGuest(interconnect, a0, std::min(a1, m_heap.GetSize(a0)));
+                WriteGuest(interconnect, address, data.data(), data.size());
+            }
+            if (address != 0 || a1 == 0)
+            {
+                m_heap.Free(a0);
+            }
+            Return(cpu, address);
+            break;
+        }
+        case 0x39:  // InitHeap(addr, size)
+            m_heap.Init(a0, a1);
+            Return(cpu, 0);
+            break;
+
+        // TTY
+        case 0x3C:  // putchar(char)
+            WriteTTY(std::string(1, static_cast<char>(a0)));
+            Return(cpu, a0);
+            break;
+        case 0x3E:  // puts(src)
+            WriteTTY(ReadString(interconnect, a0));
+            Return(cpu, 0);
+            break;
+        case 0x3F:  // printf(txt, param1, param2, etc.)
+        {
+            const std::string text = Format(cpu, a0);
+            WriteTTY(text);
+            Return(cpu, text.size());
+            break;
+        }
+
+        // The instruction cache isn't emulated
+        case 0x44:  // FlushCache()
+            Return(cpu, 0);
+            break;
+
+        default:
+            CallUnimplemented(cpu, 'A', function);
+            break;
+    }
+}
+
+void HLEBios::CallB(R3000A& cpu, uint32_t function)
+{
+    Interconnect& interconnect = cpu.m_interconnect;
+    const std::array<uint32_t, 32>& regs = cpu.m_registers;
+    const uint32_t a0 = regs[A0];
+    const uint32_t a1 = regs[A1];
+    const uint32_t a2 = regs[A2];
+    const uint32_t a3 = regs[A3];
+
+    switch (function)
+    {
+        case 0x00:  // alloc_kernel_memory(size)
+            Return(cpu, m_kernelHeap.Allocate(a0));
+            break;
+        case 0x01:  // free_kernel_memory(buf)
+            m_kernelHeap.Free(a0);
+            Return(cpu, 0);
+            break;
+
+        // Events
+        case 0x07:  // DeliverEvent(class, spec)
+            DeliverEvent(a0, a1);
+            Return(cpu, 0);
+            break;
+        case 0x08:  // OpenEvent(class, spec, mode, func)
+            Return(cpu, OpenEvent(a0, a1, a2));
+            break;
+        case 0x09:  // CloseEvent(event)
+        {
+            if (Event* event = FindEvent(a0))
+            {
+                *event = Event{};
+            }
+            Return(cpu, 1);
+            break;
+        }
+        case 0x0A:  // WaitEvent(event)
+        {
+            Event* event = FindEvent(a0);
+            if (event != nullptr && event->m_status == EVENT_ENABLED)
+            {
+                // Call again until the event is delivered by an interrupt, like the BIOS busy waits
+                cpu.SetPC(B_VECTOR);
+                break;
+            }
+            [[fallthrough]];
+        }
+        case 0x0B:  // TestEvent(event)
+        {
+            Event* event = FindEvent(a0);
+            if (event != nullptr && event->m_status == EVENT_READY)
+            {
+                event->m_status = EVENT_ENABLED;
+                Return(cpu, 1);
+                break;
+            }
+            Return(cpu, 0);
+            break;
+        }
+        case 0x0C:  // EnableEvent(event)
+        case 0x0D:  // DisableEvent(event)
+        {
+            Event* event = FindEvent(a0);
+            if (event != nullptr && event->m_status != EVENT_FREE)
+            {
+                event->m_status = function == 0x0C ? EVENT_ENABLED : EVENT_DISABLED;
+            }
+            Return(cpu, 1);
+            break;
+        }
+        case 0x20:  // UnDeliverEvent(class, spec)
+            UnDeliverEvent(a0, a1);
+            Return(cpu, 0);
+            break;
+
+        // Controllers aren't emulated: none is ever connected
+        case 0x12:  // InitPad(buf1, siz1, buf2, siz2)
+        {
+            const uint8_t noController = 0xFF;
+            for (const auto& [buffer, size] : { std::pair{ a0, a1 }, std::pair{ a2, a3 } })
+            {
+                if (buffer != 0 && size != 0)
+                {
+                    WriteGuest(interconnect, buffer, &noController, 1);
+                }
+            }
+            Return(cpu, 1);
+            break;
+        }
+        case 0x13:  // StartPad()
+        case 0x14:  // StopPad()
+        case 0x5B:  // ChangeClearPad(int)
+            Return(cpu, 1);
+            break;
+
+        // Exceptions
+        case 0x17:  // ReturnFromException()
+            ReturnFromException(cpu);
+            break;
+        case 0x18:  // SetDefaultExitFromException()
+            m_customExit = 0;
+            Return(cpu, 0);
+            break;
+        case 0x19:  // SetCustomExitFromException(addr)
+            m_customExit = a0;
+            Return(cpu, 0);
+            break;
+
+        // TTY
+        case 0x3D:  // putchar(char)
+            WriteTTY(std::string(1, static_cast<char>(a0)));
+            Return(cpu, a0);
+            break;
+        case 0x3F:  // puts(src)
+            WriteTTY(ReadString(interconnect, a0));
+            Return(cpu, 0);
+            break;
+
+        // The tables themselves aren't used: patching them has no effect
+        case 0x56:  // GetC0Table()
+            Return(cpu, C_TABLE_ADDRESS);
+            break;
+        case 0x57:  // GetB0Table()
+            Return(cpu, B_TABLE_ADDRESS);
+            break;
+
+        default:
+            CallUnimplemented(cpu, 'B', function);
+            break;
+    }
+}
+
+void HLEBios::CallC(R3000A& cpu, uint32_t function)
+{
+    const std::array<uint32_t, 32>& regs = cpu.m_registers;
+    const uint32_t a0 = regs[A0];
+    const uint32_t a1 = regs[A1];
+
+    switch (function)
+    {
+        // The native exception handler already does what these install
+        case 0x00:  // EnqueueTimerAndVblankIrqs(priority)
+        case 0x01:  // EnqueueSyscallHandler(priority)
+        case 0x02:  // SysEnqIntRP(priority, struc)
+        case 0x03:  // SysDeqIntRP(priority, struc)
+        case 0x07:  // InstallExceptionHandlers()
+        case 0x12:  // InstallDevices(ttyflag)
+        case 0x1C:  // AdjustA0Table()
+            Return(cpu, 0);
+            break;
+        case 0x08:  // SysInitMemory(addr, size)
+            m_kernelHeap.Init(a0, a1);
+            Return(cpu, 0);
+            break;
+        case 0x0A:  // ChangeClearRCnt(t, flag)
+        {
+            if (a0 >= m_clearRCnt.size())
+            {
+                Return(cpu, 0);
+                break;
+            }
+
+            const bool previous = m_clearRCnt[a0];
+            m_clearRCnt[a0] = a1 != 0;
+            Return(cpu, previous);
+            break;
+        }
+        default:
+            CallUnimplemented(cpu, 'C', function);
+            break;
+    }
+}
+
+void HLEBios::CallUnimplemented(R3000A& cpu, char table, uint32_t function)
+{
+    // Some calls are made every frame: only report them once
+    if (m_reportedCalls.insert((static_cast<uint32_t>(table) << 16) | function).second)
+    {
+        std::cerr << "Unimplemented BIOS call " << table << "(0x" << std::hex << function << std::dec << ")\n";
+    }
+
+    Return(cpu, 0);
+}
+
+void HLEBios::HandleException(R3000A& cpu)
+{
+    m_savedRegisters = cpu.m_registers;
+    m_savedHi = cpu.m_hi;
+    m_savedLo = cpu.m_lo;
+    m_returnAddress = cpu.m_epc;
+
+    // The interrupted mode is now the previous one in SR
+    switch (static_cast<R3000A::ExceptionCause>((cpu.m_cause >> 2) & 0x1F))
+    {
+        case R3000A::ExceptionCause::INTERRUPT:
+        {
+            HandleInterrupts(cpu);
+            if (m_customExit != 0)
+            {
+                // Interrupts stay disabled until the program calls ReturnFromException
+                LongJmp(cpu, m_customExit, 1);
+                return;
+            }
+            break;
+        }
+        case R3000A::ExceptionCause::SYSCALL:
+        {
+            // Interrupts are only enabled if both IEp and IM2 are set
+            m_returnAddress += 4;
+            switch (m_savedRegisters[A0])
+            {
+                case 1:  // EnterCriticalSection()
+                    m_savedRegisters[V0] = (cpu.m_sr & 0x404) == 0x404;
+                    cpu.m_sr &= ~0x404;
+                    break;
+                case 2:  // ExitCriticalSection()
+                    cpu.m_sr |= 0x404;
+                    break;
+                default:
+                    break;
+            }
+            break;
+        }
+        default:
+        {
+            // The BIOS would lock up: skip the faulting instruction instead
+            if (m_reportedCalls.insert(cpu.m_cause & 0x7C).second)
+            {
+                std::cerr << "Unhandled exception, CAUSE 0x" << std::hex << cpu.m_cause
+                          << " EPC 0x" << cpu.m_epc << std::dec << '\n';
+            }
+            m_returnAddress += 4;
+            break;
+        }
+    }
+
+    ReturnFromException(cpu);
+}
+
+// Deliver the events of the root counters which interrupted the CPU
+void HLEBios::HandleInterrupts(R3000A& cpu)
+{
+    InterruptController& controller = cpu.m_interconnect.GetInterruptController();
+    const uint32_t pending = controller.GetStatus() & controller.GetMask();
+
+    constexpr std::array<std::pair<Interrupt, uint32_t>, 4> ROOT_COUNTERS{ {
+        { Interrupt::TIMER_0, 0 }, { Interrupt::TIMER_1, 1 }, { Interrupt::TIMER_2, 2 }, { Interrupt::VBLANK, 3 }
+    } };
+
+    uint32_t handled = 0;
+    for (const auto& [interrupt, counter] : ROOT_COUNTERS)
+    {
+        const uint32_t bit = 1 << static_cast<uint32_t>(interrupt);
+        if ((pending & bit) != 0)
+        {
+            DeliverEvent(ROOT_COUNTER_EVENT_CLASS + counter, INTERRUPT_EVENT_SPEC);
+            handled |= m_clearRCnt[counter] ? bit : 0;
+        }
+    }
+
+    // Without a custom exit nothing else can acknowledge the other interrupts
+    if (m_customExit == 0)
+    {
+        handled = pending;
+    }
+
+    controller.Acknowledge(~handled);
+}
+
+// Resume the code interrupted by the last exception
+void HLEBios::ReturnFromException(R3000A& cpu)
+{
+    cpu.m_registers = m_savedRegisters;
+    cpu.m_hi = m_savedHi;
+    cpu.m_lo = m_savedLo;
+    cpu.m_pendingLoad = {};
+    cpu.m_delayedLoad = {};
+
+    cpu.ExecuteRFE(Instruction{ RFE });
+    cpu.SetPC(m_returnAddress);
+}
+
+void HLEBios::Return(R3000A& cpu, uint32_t value)
+{
+    cpu.SetRegister(V0, value);
+    cpu.SetPC(cpu.m_registers[RA]);
+}
+
+// Layout of the buffer: RA, SP, FP, S0 to S7, GP
+void HLEBios::SetJmp(R3000A& cpu, uint32_t buffer)
+{
+    Interconnect& interconnect = cpu.m_interconnect;
+    const std::array<uint32_t, 32>& regs = cpu.m_registers;
+
+    interconnect.Store<uint32_t>(buffer, regs[RA]);
+    interconnect.Store<uint32_t>(buffer + 4, regs[SP]);
+    interconnect.Store<uint32_t>(buffer + 8, regs[FP]);
+    for (uint32_t iReg = 0; iReg < 8; ++iReg)
+    {
+        interconnect.Store<uint32_t>(buffer + 12 + 4 * iReg, regs[S0 + iReg]);
+    }
+    interconnect.Store<uint32_t>(buffer + 44, regs[GP]);
+}
+
+void HLEBios::LongJmp(R3000A& cpu, uint32_t buffer, uint32_t value)
+{
+    Interconnect& interconnect = cpu.m_interconnect;
+
+    cpu.SetRegister(RA, interconnect.Load<uint32_t>(buffer));
+    cpu.SetRegister(SP, interconnect.Load<uint32_t>(buffer + 4));
+    cpu.SetRegister(FP, interconnect.Load<uint32_t>(buffer + 8));
+    for (uint32_t iReg = 0; iReg < 8; ++iReg)
+    {
+        cpu.SetRegister(S0 + iReg, interconnect.Load<uint32_t>(buffer + 12 + 4 * iReg));
+    }
+    cpu.SetRegister(GP, interconnect.Load<uint32_t>(buffer + 44));
+
+    Return(cpu, value);
+}
+
+uint32_t HLEBios::OpenEvent(uint32_t eventClass, uint32_t spec, uint32_t mode)
+{
+    for (uint32_t iEvent = 0; iEvent < m_events.size(); ++iEvent)
+    {
+        Event& event = m_events[iEvent];
+        if (event.m_status == EVENT_FREE)
+        {
+            event = Event{ eventClass, spec, mode, EVENT_DISABLED };
+            return EVENT_HANDLE_BASE | iEvent;
+        }
+    }
+
+    return -1;
+}
+
+HLEBios::Event* HLEBios::FindEvent(uint32_t handle)
+{
+    const uint32_t index = handle & 0xFFFF;
+    if ((handle & 0xFFFF0000) != EVENT_HANDLE_BASE || index >= m_events.size())
+    {
+        return nullptr;
+    }
+
+    return &m_events[index];
+}
+
+// Guest callbacks can't be called from here: events are always marked as ready
+// whatever their mode, which is enough for the programs waiting on them.
+void HLEBios::DeliverEvent(uint32_t eventClass, uint32_t spec)
+{
+    for (Event& event : m_events)
+    {
+        if (event.m_status == EVENT_ENABLED && event.m_class == eventClass && event.m_spec == spec)
+        {
+            event.m_status = EVENT_READY;
+        }
+    }
+}
+
+void HLEBios::UnDeliverEvent(uint32_t eventClass, uint32_t spec)
+{
+    for (Event& event : m_events)
+    {
+        if (event.m_status == EVENT_READY && event.m_class == eventClass && event.m_spec == spec)
+        {
+            event.m_status = EVENT_ENABLED;
+        }
+    }
+}
+
+// Expand the printf format string at <format> with the arguments of the current call.
+// Every integer is 32 bits wide, whatever its length modifier.
+std::string HLEBios::Format(R3000A& cpu, uint32_t format)
+{
+    Interconnect& interconnect = cpu.m_interconnect;
+    const std::array<uint32_t, 32>& regs = cpu.m_registers;
+
+    // The first four arguments are passed in registers, the others after their slots on the stack
+    uint32_t argIndex = 1;
+    auto nextArg = [&]()
+    {
+        const uint32_t index = argIndex++;
+        return index < 4 ? regs[A0 + index] : interconnect.Load<uint32_t>(regs[SP] + 4 * index);
+    };
+
+    auto appendDigits = [](const std::string& fmt, size_t& iChar, std::string& spec)
+    {
+        while (iChar < fmt.size() && std::isdigit(static_cast<unsigned char>(fmt[iChar])))
+        {
+            spec += fmt[iChar++];
+        }
+    };
+
+    const std::string fmt = ReadString(interconnect, format);
+    std::string out;
+
+    for (size_t iChar = 0; iChar < fmt.size(); ++iChar)
+    {
+        if (fmt[iChar] != '%')
+        {
+            out += fmt[iChar];
+            continue;
+        }
+
+        std::string spec = "%";
+        ++iChar;
+
+        while (iChar < fmt.size() && std::strchr("-+ #0", fmt[iChar]) != nullptr)
+        {
+            spec += fmt[iChar++];
+        }
+
+        if (iChar < fmt.size() && fmt[iChar] == '*')
+        {
+            spec += std::to_string(static_cast<int32_t>(nextArg()));
+            ++iChar;
+        }
+        appendDigits(fmt, iChar, spec);
+
+        if (iChar < fmt.size() && fmt[iChar] == '.')
+        {
+            spec += fmt[iChar++];
+            if (iChar < fmt.size() && fmt[iChar] == '*')
+            {
+                spec += std::to_string(static_cast<int32_t>(nextArg()));
+                ++iChar;
+            }
+            appendDigits(fmt, iChar, spec);
+        }
+
+        while (iChar < fmt.size() && (fmt[iChar] == 'h' || fmt[iChar] == 'l' || fmt[iChar] == 'L'))
+        {
+            ++iChar;
+        }
+
+        if (iChar == fmt.size())
+        {
+            break;
+        }
+
+        const char conversion = fmt[iChar];
+        switch (conversion)
+        {
+            case 'd':
+            case 'i':
+                AppendFormatted(out, spec + 'd', static_cast<int>(static_cast<int32_t>(nextArg())));
+                break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X':
+                AppendFormatted(out, spec + conversion, static_cast<unsigned int>(nextArg()));
+                break;
+            case 'p':
+                AppendFormatted(out, spec + 'x', static_cast<unsigned int>(nextArg()));
+                break;
+            case 'c':
+                AppendFormatted(out, spec + 'c', static_cast<int>(nextArg() & 0xFF));
+                break;
+            case 's':
+                AppendFormatted(out, spec + 's', ReadString(interconnect, nextArg()).c_str());
+                break;
+            case '%':
+                out += '%';
+                break;
+            default:
+                // Unknown conversions are printed as they are
+                out += spec;
+                out += conversion;
+                break;
+        }
+    }
+
+    return out;
+}
+
+void HLEBios::WriteTTY(std::string_view text)
+{
+    if (m_outputEnabled)
+    {
+        std::cout << text;
+    }
+}
+
+void HLEBios::Heap::Init(uint32_t address, uint32_t size)
+{
+    // Blocks are aligned on 8 bytes
+    m_start = (address + 7) & ~7u;
+    m_end = std::max(address + size, m_start);
+    m_blocks.clear();
+}
+
+uint32_t HLEBios::Heap::Allocate(uint32_t size)
+{
+    if (size == 0 || size > m_end - m_start)
+    {
+        return 0;
+    }
+
+    size = (size + 7) & ~7u;
+
+    // Blocks are sorted by address: take the first gap large enough
+    uint32_t candidate = m_start;
+    for (const auto& [address, blockSize] : m_blocks)
+    {
+        if (address - candidate >= size)
+        {
+            break;
+        }
+        candidate = address + blockSize;
+    }
+
+    if (m_end - candidate < size)
+    {
+        return 0;
+    }
+
+    m_blocks.emplace(candidate, size);
+    return candidate;
+}
+
+void HLEBios::Heap::Free(uint32_t address)
+{
+    m_blocks.erase(address);
+}
+
+uint32_t HLEBios::Heap::GetSize(uint32_t address) const
+{
+    auto foundIt = m_blocks.find(address);
+    return foundIt != m_blocks.cend() ? foundIt->second : 0;
+}
+
+void HLEBios::Heap::Save(Utils::StateWriter& writer) const
+{
+    writer.Write(m_start);
+    writer.Write(m_end);
+    writer.Write(static_cast<uint32_t>(m_blocks.size()));
+    for (const auto& [address, size] : m_blocks)
+    {
+        writer.Write(address);
+        writer.Write(size);
+    }
+}
+
+void HLEBios::Heap::Load(Utils::StateReader& reader)
+{
+    reader.Read(m_start);
+    reader.Read(m_end);
+    m_blocks.clear();
+
+    // Stop at the first failed read instead of trusting a corrupted count
+    const uint32_t count = reader.Read<uint32_t>();
+    for (uint32_t iBlock = 0; iBlock < count && !reader.HasFailed(); ++iBlock)
+    {
+        const uint32_t address = reader.Read<uint32_t>();
+        m_blocks[address] = reader.Read<uint32_t>();
+    }
+}
@@ -0,0 +1,127 @@
+#ifndef HLE_BIOS_H
+#define HLE_BIOS_H
+
+#include "../utils/state.h"
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+namespace PSEmu
+{
+
+class Interconnect;
+class R3000A;
+
+// High level emulation of the kernel normally installed by the BIOS.
+// HLE instructions are written at the A0h, B0h and C0h function table
+// vectors and at the exception vector: reaching one of them runs the
+// native implementation of the call instead of the BIOS code, so
+// executables can run without a BIOS image.
+// Only the calls useful without a CD-ROM drive, memory cards or
+// controllers are implemented. The others print a message and return 0.
+class HLEBios
+{
+public:
+    // Entry points, as found in the immediate of the HLE instruction
+    static constexpr uint32_t EXCEPTION_VECTOR = 0x80;
+    static constexpr uint32_t A_VECTOR = 0xA0;
+    static constexpr uint32_t B_VECTOR = 0xB0;
+    static constexpr uint32_t C_VECTOR = 0xC0;
+
+public:
+    HLEBios();
+
+    // It should not be possible to copy an instance of this class
+    HLEBios(const HLEBios&) = delete;
+    HLEBios& operator=(const HLEBios&) = delete;
+
+    // But it should be possible to move it
+    HLEBios(HLEBios&&) = default;
+    HLEBios& operator=(HLEBios&&) = default;
+
+public:
+    void Reset(R3000A& cpu);
+    void Execute(R3000A& cpu, uint32_t vector);
+
+    void Save(Utils::StateWriter& writer) const;
+    void Load(Utils::StateReader& reader);
+
+    // TTY output is dropped while disabled
+    void SetOutputEnabled(bool enabled);
+
+private:
+    // First fit allocator handing out blocks of guest memory
+    class Heap
+    {
+    public:
+        void Init(uint32_t address, uint32_t size);
+        uint32_t Allocate(uint32_t size);
+        void Free(uint32_t address);
+        uint32_t GetSize(uint32_t address) const;
+
+        void Save(Utils::StateWriter& writer) const;
+        void Load(Utils::StateReader& reader);
+
+    private:
+        uint32_t m_start = 0;
+        uint32_t m_end = 0;
+        std::map<uint32_t, uint32_t> m_blocks; /**< Size of the allocated blocks, by address */
+    };
+
+    // Kernel event control block
+    struct Event
+    {
+        uint32_t m_class = 0;
+        uint32_t m_spec = 0;
+        uint32_t m_mode = 0;
+        uint32_t m_status = 0;
+    };
+
+private:
+    void CallA(R3000A& cpu, uint32_t function);
+    void CallB(R3000A& cpu, uint32_t function);
+    void CallC(R3000A& cpu, uint32_t function);
+    void CallUnimplemented(R3000A& cpu, char table, uint32_t function);
+
+    void HandleException(R3000A& cpu);
+    void HandleInterrupts(R3000A& cpu);
+    void ReturnFromException(R3000A& cpu);
+
+    void Return(R3000A& cpu, uint32_t value);
+    void SetJmp(R3000A& cpu, uint32_t buffer);
+    void LongJmp(R3000A& cpu, uint32_t buffer, uint32_t value);
+
+    uint32_t OpenEvent(uint32_t eventClass, uint32_t spec, uint32_t mode);
+    Event* FindEvent(uint32_t handle);
+    void DeliverEvent(uint32_t eventClass, uint32_t spec);
+    void UnDeliverEvent(uint32_t eventClass, uint32_t spec);
+
+    std::string Format(R3000A& cpu, uint32_t format);
+    void WriteTTY(std::string_view text);
+
+private:
+    std::array<uint32_t, 32> m_savedRegisters; /**< Context of the code interrupted by the last exception */
+    uint32_t m_savedHi;
+    uint32_t m_savedLo;
+    uint32_t m_returnAddress;                  /**< Where ReturnFromException resumes execution */
+
+    uint32_t m_customExit;                     /**< setjmp buffer jumped to after interrupts, 0 if none */
+    std::array<bool, 4> m_clearRCnt;           /**< Acknowledge the root counter interrupts in the kernel */
+
+    std::array<Event, 16> m_events;
+
+    Heap m_heap;                               /**< Set up by InitHeap */
+    Heap m_kernelHeap;
+    uint32_t m_randSeed;
+
+    std::unordered_set<uint32_t> m_reportedCalls;
+    bool m_outputEnabled;
+};
+
+}   // end namespace PSEmu
+
+#endif // HLE_BIOS_H
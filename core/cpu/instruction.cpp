@@ -45,6 +45,11 @@ Opcode Instruction::GetOp() const
     return static_cast<Opcode>(instOpcode);
 }
 
+uint32_t Instruction::GetPrimaryOpcode() const
+{
+    return m_intRep >> 26;
+}
+
 uint32_t Instruction::GetRd() const
 {
     return (m_intRep >> 11) & 0x1F;
@@ -19,6 +19,7 @@ public:
     uint32_t GetImmJump() const;
     uint32_t GetImmSe() const;
     Opcode GetOp() const;
+    uint32_t GetPrimaryOpcode() const;
     uint32_t GetRd() const;
     uint32_t GetRs() const;
     uint32_t GetRt() const;
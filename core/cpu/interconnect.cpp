@@ -2,10 +2,109 @@
 
 using namespace PSEmu;
 
-Interconnect::Interconnect(BIOS bios) : m_bios{ std::move(bios) }, m_ram{}, m_gpu{}, m_dma{ m_gpu, m_ram } { }
+Interconnect::Interconnect(BIOS bios, bool useFastMem) 
+    : m_scheduler{},
+      m_interruptController{},
+      m_bios{ std::move(bios) }, 
+      m_fastMem{ useFastMem ? FastMem::Create(m_bios.GetFile(), m_bios.GetSize()) : nullptr },
+      m_ram{ m_fastMem ? RAM{ m_fastMem->GetRAM() } : RAM{} }, 
+      m_scratchpad{ m_fastMem ? Scratchpad{ m_fastMem->GetScratchpad() } : Scratchpad{} },
+      m_gpu{}, 
+      m_dma{}, 
+      m_timers{},
+      m_pageTable{}
+{
+    ConnectDevices();
+
+    m_scheduler.Schedule(EventType::VBLANK, m_gpu.GetCyclesPerFrame());
+
+    // Host buffers don't move when the devices owning them do
+    if (m_fastMem)
+    {
+        // The mirrors are already laid out contiguously in the host mapping
+        const uint8_t* base = m_fastMem->GetBase();
+        m_pageTable.Map(RAM_ADDRESS, base + RAM_ADDRESS, 4 * RAM_SIZE);
+        m_pageTable.Map(BIOS_ADDRESS, base + BIOS_ADDRESS, m_bios.GetSize());
+    }
+    else
+    {
+        for (uint32_t mirror = RAM_ADDRESS; mirror < RAM_ADDRESS + 4 * RAM_SIZE; mirror += RAM_SIZE)
+        {
+            m_pageTable.Map(mirror, m_ram.GetData(), RAM_SIZE);
+        }
+        m_pageTable.Map(BIOS_ADDRESS, m_bios.GetData(), m_bios.GetSize());
+    }
+
+    // Its page is mapped as a whole: the padding after it reads as 0 like the unmapped addresses
+    static_assert(Scratchpad::STORAGE_SIZE == PageTable::PAGE_SIZE);
+    m_pageTable.Map(SCRATCHPAD_ADDRESS, m_scratchpad.GetData(), Scratchpad::STORAGE_SIZE);
+}
+
+// Devices keep pointers to each other and to the scheduler which must follow them when they move.
+// The host buffers mapped in the page table don't move.
+Interconnect::Interconnect(Interconnect&& other) 
+    : m_scheduler{ std::move(other.m_scheduler) },
+      m_interruptController{ std::move(other.m_interruptController) },
+      m_bios{ std::move(other.m_bios) },
+      m_fastMem{ std::move(other.m_fastMem) },
+      m_ram{ std::move(other.m_ram) },
+      m_scratchpad{ std::move(other.m_scratchpad) },
+      m_gpu{ std::move(other.m_gpu) },
+      m_dma{ std::move(other.m_dma) },
+      m_timers{ std::move(other.m_timers) },
+      m_pageTable{ std::move(other.m_pageTable) }
+{
+    ConnectDevices();
+}
+
+RAM& Interconnect::GetRAM()
+{
+    return m_ram;
+}
+
+GPU& Interconnect::GetGPU()
+{
+    return m_gpu;
+}
 
 // TODO: Document
-uint32_t Interconnect::GetPhysicalAddress(uint32_t virtAddr)
+uint32_t Interconnect::GetPhysicalAddress(uint32_t virtAddr) const
 {
     return virtAddr & REGION_MASK[virtAddr >> 29];
 }
+
+void Interconnect::Save(Utils::StateWriter& writer, bool includeMemories) const
+{
+    m_scheduler.Save(writer);
+    m_interruptController.Save(writer);
+    if (includeMemories)
+    {
+        m_ram.Save(writer);
+    }
+    m_scratchpad.Save(writer);
+    m_gpu.Save(writer, includeMemories);
+    m_dma.Save(writer);
+    m_timers.Save(writer);
+}
+
+void Interconnect::Load(Utils::StateReader& reader, bool includeMemories)
+{
+    m_scheduler.Load(reader);
+    m_interruptController.Load(reader);
+    if (includeMemories)
+    {
+        m_ram.Load(reader);
+    }
+    m_scratchpad.Load(reader);
+    m_gpu.Load(reader, includeMemories);
+    m_dma.Load(reader);
+    m_timers.Load(reader);
+}
+
+void Interconnect::ConnectDevices()
+{
+    m_interruptController.Connect(m_scheduler);
+    m_gpu.Connect(m_scheduler, m_interruptController);
+    m_dma.Connect(m_gpu, m_ram, m_scheduler, m_interruptController);
+    m_timers.Connect(m_scheduler, m_interruptController);
+}
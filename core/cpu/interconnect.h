@@ -3,9 +3,16 @@
 
 #include "../memory/bios.h"
 #include "../memory/dma.h"
+#include "../memory/fastmem.h"
+#include "../memory/interruptcontroller.h"
 #include "../memory/memorymap.h"
+#include "../memory/pagetable.h"
 #include "../memory/ram.h"
+#include "../memory/scratchpad.h"
+#include "../memory/timers.h"
+#include "../utils/endian.h"
 #include "../video/gpu.h"
+#include "scheduler.h"
 
 #include <cassert>
 
@@ -15,7 +22,31 @@ namespace PSEmu
 class Interconnect
 {
 public:
-    explicit Interconnect(BIOS bios);
+    explicit Interconnect(BIOS bios, bool useFastMem = false);
+
+    // It should not be possible to copy an instance of this class
+    Interconnect(const Interconnect&) = delete;
+    Interconnect& operator=(const Interconnect&) = delete;
+
+    // But it should be possible to move it
+    Interconnect(Interconnect&& other);
+    Interconnect& operator=(Interconnect&&) = delete;
+
+public:
+    RAM& GetRAM();
+    GPU& GetGPU();
+    const BIOS& GetBIOS() const { return m_bios; }
+    InterruptController& GetInterruptController() { return m_interruptController; }
+    const InterruptController& GetInterruptController() const { return m_interruptController; }
+    Timers& GetTimers() { return m_timers; }
+    Scheduler& GetScheduler() { return m_scheduler; }
+
+    uint32_t GetPhysicalAddress(uint32_t virtAddr) const;
+
+    // The BIOS image isn't part of the state: it must be the same when loading.
+    // Without the memories, their content is left to the caller (see RewindBuffer).
+    void Save(Utils::StateWriter& writer, bool includeMemories = true) const;
+    void Load(Utils::StateReader& reader, bool includeMemories = true);
 
 public:
     template <typename TSize>
@@ -25,21 +56,31 @@ public:
 
         const uint32_t physAddr = GetPhysicalAddress(address);
 
+        // Fast path: RAM, BIOS and scratchpad are read directly from host memory
+        if (const uint8_t* hostPtr = m_pageTable.GetHostPointer(physAddr))
+        {
+            return Utils::LoadLittleEndian<TSize>(hostPtr);
+        }
+
         if (auto offset = BIOS_RANGE.Contains(physAddr))
         {
             return m_bios.Load<TSize>(*offset);
         }
-        else if (auto offset = RAM_RANGE.Contains(physAddr))
+        else if (auto offset = RAM_MIRRORS_RANGE.Contains(physAddr))
+        {
+            return m_ram.Load<TSize>(*offset % RAM_SIZE);
+        }
+        else if (auto offset = SCRATCHPAD_RANGE.Contains(physAddr))
         {
-            return m_ram.Load<TSize>(*offset);
+            return m_scratchpad.Load<TSize>(*offset);
         }
         else if (auto offset = IRQ_CONTROL_RANGE.Contains(physAddr))
         {
-            return 0;
+            return static_cast<TSize>(*offset < 4 ? m_interruptController.GetStatus() : m_interruptController.GetMask());
         }
         else if (auto offset = DMA_RANGE.Contains(physAddr))
         {
-            return m_dma.RegisterRead(address);
+            return m_dma.RegisterRead(*offset);
         }
         else if (auto offset = GPU_RANGE.Contains(physAddr))
         {
@@ -47,16 +88,15 @@ public:
             // TODO: Review how to enable/disable loads depending on the number of bytes demanded
             if constexpr(sizeof(TSize) == 4)
             {
-                // TODO: Not implemented yet! Placeholder for now!
-                if (*offset == 4)
-                {
-                    // GPUSTAT: Set bit 28 to signal that the GPU is ready to receive DMA blocks
-                    return 0x1C000000;
-                }
+                return *offset == 4 ? m_gpu.GetStatus() : m_gpu.GetRead();
             }
             
             return 0;
         }
+        else if (auto offset = TIMERS_RANGE.Contains(physAddr))
+        {
+            return static_cast<TSize>(m_timers.RegisterRead(*offset));
+        }
         else if (auto offset = EXPANSION_1_RANGE.Contains(physAddr))
         {
             return 0xFF;
@@ -73,33 +113,46 @@ public:
 
         const uint32_t physAddr = GetPhysicalAddress(address);
 
-        if (MEMCONTROL_RANGE.Contains(physAddr) != std::nullopt)
+        // Fast path: RAM and scratchpad are the only memories the CPU can write to
+        if (auto offset = RAM_MIRRORS_RANGE.Contains(physAddr))
+        {
+            m_ram.Store<TSize>(*offset % RAM_SIZE, value);
+        }
+        else if (auto offset = SCRATCHPAD_RANGE.Contains(physAddr))
+        {
+            m_scratchpad.Store<TSize>(*offset, value);
+        }
+        else if (MEMCONTROL_RANGE.Contains(physAddr) != std::nullopt)
         {
             // TODO: Handle error
         }
-        else if (IRQ_CONTROL_RANGE.Contains(physAddr) != std::nullopt)
+        else if (auto offset = IRQ_CONTROL_RANGE.Contains(physAddr))
         {
-            // TODO: Not implemented yet
+            if (*offset < 4)
+            {
+                m_interruptController.Acknowledge(value);
+            }
+            else
+            {
+                m_interruptController.SetMask(value);
+            }
         }
         else if (auto offset = DMA_RANGE.Contains(physAddr))
         {
-            m_dma.RegisterWrite(address, value);
+            m_dma.RegisterWrite(*offset, value);
         }
         else if (auto offset = GPU_RANGE.Contains(physAddr))
         {
             switch (*offset)
             {
                 case 0: m_gpu.SetGP0(value); break;
+                case 4: m_gpu.SetGP1(value); break;
                 default: assert(false && "Unhandled GPU write");
             }
         }
         else if (auto offset = TIMERS_RANGE.Contains(physAddr))
         {
-            // TODO: Not implemented yet!
-        }
-        else if (auto offset = RAM_RANGE.Contains(physAddr))
-        {
-            m_ram.Store<TSize>(*offset, value);
+            m_timers.RegisterWrite(*offset, value);
         }
         else if (EXPANSION_2_RANGE.Contains(physAddr) != std::nullopt)
         {
@@ -114,13 +167,26 @@ public:
     }
 
 private:
-    uint32_t GetPhysicalAddress(uint32_t virtAddr);
+    void ConnectDevices();
 
 private:
+    // Declared first: devices register their events with it
+    Scheduler m_scheduler;
+    InterruptController m_interruptController;
+
     BIOS m_bios;
+
+    // Optional host mapping of the physical address space backing the RAM
+    std::unique_ptr<FastMem> m_fastMem;
+
     RAM m_ram;
+    Scratchpad m_scratchpad;
     GPU m_gpu;
     DMA m_dma;
+    Timers m_timers;
+
+    // Direct mapping of RAM, BIOS and scratchpad used to bypass the range checks
+    PageTable m_pageTable;
 };
 
 } // end namespace PSEmu
@@ -40,7 +40,7 @@ namespace PSEmu
         LWC1    = 0xC4000000,
         LWC2    = 0xC8000000,
         LWC3    = 0xCC000000,
-        SWC0    = 0xDC000000,
+        SWC0    = 0xE0000000,
         SWC1    = 0xE4000000,
         SWC2    = 0xE8000000,
         SWC3    = 0xEC000000,
@@ -88,6 +88,10 @@ namespace PSEmu
         COP1    = 0x44000000,
         COP2    = 0x48000000,
         COP3    = 0x4C000000,
+
+        // Emulator
+        HLE     = 0xB0000000,   // Unused primary opcode 0x2C. Traps into the HLE kernel,
+                                // the immediate tells which entry point was reached.
     };
 }   // end namespace PSEmu
 
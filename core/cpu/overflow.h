@@ -0,0 +1,41 @@
+#ifndef OVERFLOW_H
+#define OVERFLOW_H
+
+#include <cstdint>
+
+namespace PSEmu
+{
+
+// Signed addition reporting whether the result overflowed 32 bits
+struct OverflowingPlus
+{
+    bool operator()(int32_t lhs, int32_t rhs, int32_t& result) const
+    {
+#if defined(__GNUC__)
+        return __builtin_add_overflow(lhs, rhs, &result);
+#else
+        const int64_t wideResult = static_cast<int64_t>(lhs) + rhs;
+        result = static_cast<int32_t>(wideResult);
+        return wideResult != result;
+#endif
+    }
+};
+
+// Signed subtraction reporting whether the result overflowed 32 bits
+struct OverflowingMinus
+{
+    bool operator()(int32_t lhs, int32_t rhs, int32_t& result) const
+    {
+#if defined(__GNUC__)
+        return __builtin_sub_overflow(lhs, rhs, &result);
+#else
+        const int64_t wideResult = static_cast<int64_t>(lhs) - rhs;
+        result = static_cast<int32_t>(wideResult);
+        return wideResult != result;
+#endif
+    }
+};
+
+}
+
+#endif // OVERFLOW_H
@@ -1,6 +1,7 @@
 #include "r3000a.h"
 
 #include "opcodes.h"
+#include "overflow.h"
 
 #ifndef NDEBUG
 #include "disasm.h"
@@ -9,8 +10,10 @@
 
 #include "../memory/memorymap.h"
 
+#include <algorithm>
 #include <cassert>
-#include <limits>
+#include <functional>
+#include <optional>
 
 
 // TODO: This might not work with ExecuteTrappingALU which works on signed integers
@@ -38,21 +41,90 @@ ALUOperands<T> DecodeThreeOperands(const std::array<uint32_t, 32>& regs, PSEmu::
     return { inst.GetRd(), regs[inst.GetRs()], regs[inst.GetRt()] };
 }
 
-}   // end anonymous namespace
+// Only loops this short are looked at by the idle loop detection
+constexpr size_t MAX_IDLE_LOOP_SIZE = 16;
+
+// Registers read and written by an instruction allowed in an idle loop
+struct RegisterUsage
+{
+    uint32_t m_reads = 0;       /**< Bit mask of the registers read */
+    uint32_t m_write = 0;       /**< Register written, 0 if none */
+    bool m_isLoad = false;      /**< The write only happens after the next instruction */
+};
 
-bool WouldOverflow(int32_t lhs, int32_t rhs, std::function<int32_t(int32_t,int32_t)> func)
+// Returns std::nullopt for instructions with side effects other than writing a register
+std::optional<RegisterUsage> GetIdleLoopRegisterUsage(PSEmu::Instruction inst)
 {
-    return lhs > func(std::numeric_limits<int32_t>::max(), rhs);
+    using namespace PSEmu;
+
+    const uint32_t rs = 1 << inst.GetRs();
+    const uint32_t rt = 1 << inst.GetRt();
+
+    switch (inst.GetOp())
+    {
+        case LB: case LBU: case LH: case LHU: case LW:
+            return RegisterUsage{ rs, inst.GetRt(), true };
+        case ADDIU: case SLTI: case SLTIU: case ANDI: case ORI: case XORI:
+            return RegisterUsage{ rs, inst.GetRt(), false };
+        case LUI:
+            return RegisterUsage{ 0, inst.GetRt(), false };
+        case SLL: case SRL: case SRA:
+            return RegisterUsage{ rt, inst.GetRd(), false };
+        case SLLV: case SRLV: case SRAV: case ADDU: case SUBU: 
+        case AND: case OR: case XOR: case NOR: case SLT: case SLTU:
+            return RegisterUsage{ rs | rt, inst.GetRd(), false };
+        case BEQ: case BNE:
+            return RegisterUsage{ rs | rt, 0, false };
+        case BLEZ: case BGTZ:
+            return RegisterUsage{ rs, 0, false };
+        case BLTZ:
+            // Covers all the BCOND instructions: the linking ones write RA (see REGIMM_HANDLERS)
+            if ((inst.GetRt() & 0x1E) == 0x10)
+            {
+                return std::nullopt;
+            }
+            return RegisterUsage{ rs, 0, false };
+        case J:
+            return RegisterUsage{};
+        default:
+            return std::nullopt;
+    }
 }
 
+// Average cost of an instruction. The pipeline retires one instruction
+// per cycle but memory accesses regularly stall it.
+constexpr uint32_t CYCLES_PER_INSTRUCTION = 2;
+
+// Savestates start with a magic number and a version, bumped whenever the layout changes
+constexpr uint32_t STATE_MAGIC = 0x53455350;    // "PSES"
+constexpr uint32_t STATE_VERSION = 6;
+
+}   // end anonymous namespace
+
 namespace PSEmu
 {
 
-R3000A::R3000A(Interconnect interconnect, Debugger debugger) 
+R3000A::R3000A(Interconnect interconnect, Debugger debugger, ExecutionMode mode, bool useHLE) 
     : m_interconnect{ std::move(interconnect) }, 
       m_nextInst{ 0x0 },
-      m_debugger{ std::move(debugger) }
+      m_debugger{ std::move(debugger) },
+      m_executionMode{ mode },
+      m_blockCache{},
+      m_hle{ useHLE ? std::make_optional<HLEBios>() : std::nullopt }
 {
+    // Decoded blocks must be thrown away when the code they come from is overwritten
+    m_interconnect.GetRAM().SetCodeWriteHandler([this](uint32_t offset)
+    {
+        m_blockCache.InvalidatePage(offset);
+        m_currentBlock = nullptr;
+    });
+
+    // Interrupts are only looked at when the interrupt line goes up or when the CPU unmasks them
+    m_interconnect.GetScheduler().SetHandler(EventType::INTERRUPT, [this](uint64_t)
+    {
+        CheckInterrupts();
+    });
+
     Reset();
 }
 
@@ -77,99 +149,255 @@ void R3000A::Step()
     }
 
     // Fetch instruction at PC
-    const Instruction instToExec = m_interconnect.Load<uint32_t>(m_pc);
+    Dispatch(Fetch(m_pc));
+}
 
+// Execute <cycles> instructions in a row. In cached interpreter mode, the instructions
+// of each block are dispatched one after the other without going back through the
+// fetch and the per instruction debugger hook.
+void R3000A::Run(uint32_t cycles)
+{
+    Scheduler& scheduler = m_interconnect.GetScheduler();
+    const uint64_t endCycle = scheduler.GetCycles() + cycles;
+
+    // Breakpoints have to be checked before each instruction
+    if (m_executionMode != ExecutionMode::CACHED_INTERPRETER || m_debugger.HasBreakpoints())
+    {
+        while (scheduler.GetCycles() < endCycle)
+        {
+            Step();
+        }
+        return;
+    }
+
+    while (scheduler.GetCycles() < endCycle)
+    {
+        DecodedBlock* block = (m_pc % 4 == 0) ? EnterBlock(m_pc) : nullptr;
+        if (block == nullptr)
+        {
+            // Let Step deal with misaligned PCs and code that can't be cached
+            Step();
+            continue;
+        }
+
+        // The block is freed when a store overwrites its code: only m_currentBlock tells
+        const uint32_t blockStart = m_pc;
+        const size_t blockSize = block->m_instructions.size();
+        const bool isIdleLoop = block->m_isIdleLoop;
+        const uint64_t deadline = scheduler.GetNextDeadline();
+        if (isIdleLoop)
+        {
+            m_interconnect.GetTimers().TakePolled();
+        }
+
+        m_blockIndex = 0;
+        m_blockNextPC = m_pc;
+
+        while (scheduler.GetCycles() < endCycle && m_blockIndex < blockSize)
+        {
+            m_isInDelaySlot = m_isBranching;
+            m_isBranching = false;
+            m_currentPC = m_pc;
+
+            m_blockNextPC += 4;
+            Dispatch(block->m_instructions[m_blockIndex++]);
+
+            // Stop following the block on exceptions or if it just got overwritten
+            if (m_pc != m_blockNextPC || m_currentBlock != block)
+            {
+                break;
+            }
+        }
+
+        // A whole iteration of an idle loop ran without any event happening: 
+        // the next ones won't do anything different until the next event.
+        // Timers change with time alone so polling them doesn't count as idle.
+        if (isIdleLoop && m_currentBlock == block 
+            && m_blockIndex == blockSize && m_pc == blockStart 
+            && scheduler.GetCycles() < deadline && !m_interconnect.GetTimers().TakePolled())
+        {
+            scheduler.SkipTo(std::min(deadline, endCycle));
+            if (scheduler.IsEventPending())
+            {
+                scheduler.RunEvents();
+            }
+        }
+    }
+}
+
+// Execute an instruction that was just fetched from m_pc
+void R3000A::Dispatch(const DecodedInstruction& instToExec)
+{
     // Increment next PC to point to the next instruction
     m_pc = m_nextPC;
     m_nextPC += 4;
 
-    // Execute any pending load
-    SetRegister(m_pendingLoad.first, m_pendingLoad.second);
+    // The load initiated by the previous instruction completes at the end of this one
+    m_delayedLoad = m_pendingLoad;
     m_pendingLoad = {};
 
 #ifndef NDEBUG
-    std::cout << DisassembleInstruction(instToExec);
+    std::cout << DisassembleInstruction(instToExec.m_inst);
 #endif
 
-    switch(instToExec.GetOp())
-    {
-        case LUI:     ExecuteLUI(instToExec); break;
-        case ORI:     ExecuteALU(std::bit_or<uint32_t>{}, DecodeZeroExtendedImmediate<uint32_t>, instToExec); break;
-        case SW:      ExecuteStore<uint32_t>(instToExec); break;
-        case SLL:     ExecuteSLL(instToExec); break;
-        case ADDIU:   ExecuteALU(std::plus<uint32_t>{}, DecodeSignExtendedImmediate<uint32_t>, instToExec); break;
-        case J:       ExecuteJ(instToExec); break;
-        case OR:      ExecuteALU(std::bit_or<uint32_t>{}, DecodeThreeOperands<uint32_t>, instToExec); break;
-        case MTC0:    ExecuteMTC0(instToExec); break;
-        case BNE:     ExecuteBNE(instToExec); break;
-        case ADDI:    ExecuteTrappingALU(std::plus<int32_t>{}, std::minus<int32_t>{}, DecodeSignExtendedImmediate<int32_t>, instToExec); break;
-        case LW:      ExecuteLoad<uint32_t>(instToExec); break;
-        case SLTU:    ExecuteALU(std::less<uint32_t>{}, DecodeZeroExtendedImmediate<uint32_t>, instToExec); break;
-        case ADDU:    ExecuteALU(std::plus<uint32_t>{}, DecodeZeroExtendedImmediate<uint32_t>, instToExec); break;
-        case SH:      ExecuteStore<uint16_t>(instToExec); break;
-        case JAL:     ExecuteJAL(instToExec); break;
-        case ANDI:    ExecuteALU(std::bit_and<uint32_t>{}, DecodeZeroExtendedImmediate<uint32_t>, instToExec); break;
-        case SB:      ExecuteStore<uint8_t>(instToExec); break;
-        case JR:      ExecuteJR(instToExec); break;
-        case LB:      ExecuteLoad<uint8_t, int8_t>(instToExec); break;
-        case BEQ:     ExecuteBEQ(instToExec); break;
-        case MFC0:    ExecuteMFC0(instToExec); break;
-        case AND:     ExecuteALU(std::bit_and<uint32_t>{}, DecodeThreeOperands<uint32_t>, instToExec); break;
-        case ADD:     ExecuteTrappingALU(std::plus<int32_t>{}, std::minus<int32_t>{}, DecodeThreeOperands<int32_t>, instToExec); break;
-        case BGTZ:    ExecuteBranch(std::greater<int32_t>{}, instToExec); break;
-        case BLEZ:    ExecuteBranch(std::less_equal<int32_t>{}, instToExec); break;
-        case LBU:     ExecuteLoad<uint8_t>(instToExec); break;
-        case JALR:    ExecuteJALR(instToExec); break;
-        case BLTZ:    ExecuteBranch(std::less<int32_t>{}, instToExec); break;
-        case BLTZAL:  ExecuteBranchAndLink(std::less<int32_t>{}, instToExec); break;
-        case BGEZ:    ExecuteBranch(std::greater_equal<int32_t>{}, instToExec); break;
-        case BGEZAL:  ExecuteBranchAndLink(std::greater_equal<int32_t>{}, instToExec); break;
-        case SLTI:    ExecuteSLTI(instToExec); break;
-        case SUBU:    ExecuteALU(std::minus<uint32_t>{}, DecodeZeroExtendedImmediate<uint32_t>, instToExec); break;
-        case SRA:     ExecuteSRA(instToExec); break;
-        case DIV:     ExecuteDIV(instToExec); break;
-        case MFLO:    SetRegister(instToExec.GetRd(), m_lo); break;
-        case SRL:     ExecuteSRL(instToExec); break;
-        case SLTIU:   ExecuteALU(std::less<uint32_t>{}, DecodeSignExtendedImmediate<uint32_t>, instToExec); break;
-        case DIVU:    ExecuteDIVU(instToExec); break;
-        case MFHI:    SetRegister(instToExec.GetRd(), m_hi); break;
-        case SLT:     ExecuteSLT(instToExec); break;
-        case SYSCALL: TriggerException(ExceptionCause::SYSCALL); break;
-        case MTLO:    SetRegister(m_lo, m_registers[instToExec.GetRs()]); break;
-        case MTHI:    SetRegister(m_hi, m_registers[instToExec.GetRs()]); break;
-        case RFE :    ExecuteRFE(instToExec); break;
-        case LHU :    ExecuteLoad<uint16_t>(instToExec); break;
-        case SLLV:    ExecuteSLLV(instToExec); break;
-        case LH:      ExecuteLoad<uint16_t, int16_t>(instToExec); break;
-        case NOR:     ExecuteNOR(instToExec); break;
-        case SRAV:    ExecuteSRAV(instToExec); break;
-        case SRLV:    ExecuteSRLV(instToExec); break;
-        case MULTU:   ExecuteMULTU(instToExec); break;
-        case XOR:     ExecuteALU(std::bit_xor<uint32_t>{}, DecodeThreeOperands<uint32_t>, instToExec); break;
-        case BREAK:   TriggerException(ExceptionCause::BREAK); break;
-        case MULT:    ExecuteMULT(instToExec); break;
-        case SUB:     ExecuteTrappingALU(std::minus<int32_t>{}, std::plus<int32_t>{}, DecodeThreeOperands<int32_t>, instToExec); break;
-        case XORI:    ExecuteALU(std::bit_xor<uint32_t>{}, DecodeZeroExtendedImmediate<uint32_t>, instToExec); break;
-        case COP1:    TriggerException(ExceptionCause::COPROCESSOR_ERROR); break;
-        case COP2:    assert(false && "Unimplemented instruction"); break;
-        case COP3:    TriggerException(ExceptionCause::COPROCESSOR_ERROR); break;
-        case LWL:     ExecuteLWL(instToExec); break;
-        case LWR:     ExecuteLWR(instToExec); break;
-        case SWL:     ExecuteSWL(instToExec); break;
-        case SWR:     ExecuteSWR(instToExec); break;
-        case LWC0:    TriggerException(ExceptionCause::COPROCESSOR_ERROR); break;
-        case LWC1:    TriggerException(ExceptionCause::COPROCESSOR_ERROR); break;
-        case LWC2:    assert(false && "Unimplemented instruction"); break;
-        case LWC3:    TriggerException(ExceptionCause::COPROCESSOR_ERROR); break;
-        case SWC0:    TriggerException(ExceptionCause::COPROCESSOR_ERROR); break;
-        case SWC1:    TriggerException(ExceptionCause::COPROCESSOR_ERROR); break;
-        case SWC2:    assert(false && "Unimplemented instruction"); break;
-        case SWC3:    TriggerException(ExceptionCause::COPROCESSOR_ERROR); break;
-        default:      assert(false && "ILLEGAL INSTRUCTION!!!"); TriggerException(ExceptionCause::ILLEGAL_INSTRUCTION); break;
-    }
-       
-    // Copy the output registers as input for the next instruction
-    m_registers = m_outputRegisters;
+    (this->*instToExec.m_handler)(instToExec.m_inst);
+
+    // The instruction in the load delay slot saw the old value of the register
+    m_registers[m_delayedLoad.first] = m_delayedLoad.second;
+    m_registers[0] = 0;
+
+    ++m_instructionCount;
+
+    // Devices are only looked at once the nearest event is due
+    Scheduler& scheduler = m_interconnect.GetScheduler();
+    scheduler.AddCycles(CYCLES_PER_INSTRUCTION);
+    if (scheduler.IsEventPending())
+    {
+        scheduler.RunEvents();
+    }
+}
+
+// Run until the instruction at <address> is about to be executed, for at most <maxCycles>.
+// Returns true if <address> was reached.
+bool R3000A::RunUntil(uint32_t address, uint64_t maxCycles)
+{
+    const Scheduler& scheduler = m_interconnect.GetScheduler();
+    const uint64_t endCycle = scheduler.GetCycles() + maxCycles;
+
+    while (m_pc != address)
+    {
+        if (scheduler.GetCycles() >= endCycle)
+        {
+            return false;
+        }
+
+        Step();
+    }
+
+    return true;
+}
+
+// Copy <exe> in RAM and jump to its entry point. Meant to be called once the 
+// BIOS has initialized the kernel (see SHELL_ENTRY_ADDRESS) so that the 
+// executable can use the kernel functions without sitting through the boot sequence.
+void R3000A::SideLoad(const PsxExe& exe)
+{
+    exe.CopyTo(m_interconnect.GetRAM());
+
+    SetRegister(28, exe.GetInitialGP());
+    if (exe.GetInitialSP() != 0)
+    {
+        SetRegister(29, exe.GetInitialSP());
+        SetRegister(30, exe.GetInitialSP());
+    }
+
+    SetPC(exe.GetInitialPC());
+}
+
+void R3000A::SaveState(std::vector<uint8_t>& state, bool includeMemories) const
+{
+    Utils::StateWriter writer{ state };
+
+    writer.Write(STATE_MAGIC);
+    writer.Write(STATE_VERSION);
+    writer.Write(m_interconnect.GetBIOS().GetHash());
+    writer.Write(m_hle.has_value());
+    writer.Write(includeMemories);
+
+    for (uint32_t value : m_registers)
+    {
+        writer.Write(value);
+    }
+    writer.Write(m_pc);
+    writer.Write(m_nextPC);
+    writer.Write(m_currentPC);
+    writer.Write(m_hi);
+    writer.Write(m_lo);
+    writer.Write(m_pendingLoad.first);
+    writer.Write(m_pendingLoad.second);
+    writer.Write(m_delayedLoad.first);
+    writer.Write(m_delayedLoad.second);
+    writer.Write(m_sr);
+    writer.Write(m_cause);
+    writer.Write(m_epc);
+    writer.Write(m_isBranching);
+    writer.Write(m_isInDelaySlot);
+    writer.Write(m_instructionCount);
+
+    if (m_hle)
+    {
+        m_hle->Save(writer);
+    }
+
+    m_interconnect.Save(writer, includeMemories);
+}
+
+bool R3000A::LoadState(const uint8_t* data, size_t size, bool includeMemories)
+{
+    Utils::StateReader reader{ data, size };
+
+    // The state is only valid for the same BIOS image and kernel
+    if (reader.Read<uint32_t>() != STATE_MAGIC ||
+        reader.Read<uint32_t>() != STATE_VERSION ||
+        reader.Read<uint64_t>() != m_interconnect.GetBIOS().GetHash() ||
+        reader.Read<bool>() != m_hle.has_value() ||
+        reader.Read<bool>() != includeMemories ||
+        reader.HasFailed())
+    {
+        return false;
+    }
+
+    for (uint32_t& value : m_registers)
+    {
+        reader.Read(value);
+    }
+    reader.Read(m_pc);
+    reader.Read(m_nextPC);
+    reader.Read(m_currentPC);
+    reader.Read(m_hi);
+    reader.Read(m_lo);
+    reader.Read(m_pendingLoad.first);
+    reader.Read(m_pendingLoad.second);
+    reader.Read(m_delayedLoad.first);
+    reader.Read(m_delayedLoad.second);
+    reader.Read(m_sr);
+    reader.Read(m_cause);
+    reader.Read(m_epc);
+    reader.Read(m_isBranching);
+    reader.Read(m_isInDelaySlot);
+    reader.Read(m_instructionCount);
+
+    // Register indices index the register file
+    m_pendingLoad.first &= 0x1F;
+    m_delayedLoad.first &= 0x1F;
+
+    if (m_hle)
+    {
+        m_hle->Load(reader);
+    }
+
+    m_interconnect.Load(reader, includeMemories);
+
+    // The RAM content changed under the decoded blocks. When the caller restores it,
+    // the writes invalidate the blocks decoded from the pages which changed.
+    if (includeMemories)
+    {
+        m_blockCache.Clear();
+    }
+    m_currentBlock = nullptr;
+    m_blockIndex = 0;
+    m_blockNextPC = 0;
+
+    return !reader.HasFailed() && reader.IsAtEnd();
+}
+
+void R3000A::SetOutputEnabled(bool enabled)
+{
+    m_interconnect.GetGPU().SetOutputEnabled(enabled);
+    if (m_hle)
+    {
+        m_hle->SetOutputEnabled(enabled);
+    }
 }
 
 void R3000A::Reset()
@@ -177,12 +405,26 @@ void R3000A::Reset()
     m_pc = 0xBFC00000;
     m_nextPC = m_pc + 4;
     m_registers.fill(0x0);
-    m_outputRegisters.fill(0x0);
+    m_pendingLoad = {};
+    m_delayedLoad = {};
     m_sr = {};
+    m_cause = {};
+    m_epc = {};
     m_hi = {};
     m_lo = {};
     m_isBranching = false;
     m_isInDelaySlot = false;
+    m_blockCache.Clear();
+    m_currentBlock = nullptr;
+    m_blockIndex = 0;
+    m_blockNextPC = 0;
+    m_instructionCount = 0;
+
+    // Without a BIOS to boot, the kernel is ready right away
+    if (m_hle)
+    {
+        m_hle->Reset(*this);
+    }
 }
 
 uint32_t R3000A::GetPC() const
@@ -190,24 +432,76 @@ uint32_t R3000A::GetPC() const
     return m_pc;
 }
 
+// Jump to <address> between two instructions, e.g. to start an executable loaded in memory
+void R3000A::SetPC(uint32_t address)
+{
+    m_pc = address;
+    m_nextPC = address + 4;
+    m_isBranching = false;
+    m_isInDelaySlot = false;
+    m_currentBlock = nullptr;
+}
+
 const std::array<uint32_t, 32>& R3000A::GetRegisters() const
 {
     return m_registers;
 }
 
+uint64_t R3000A::GetInstructionCount() const
+{
+    return m_instructionCount;
+}
+
+Interconnect& R3000A::GetInterconnect()
+{
+    return m_interconnect;
+}
+
 void R3000A::Branch(uint32_t offset)
 {
     m_isBranching = true;
+    // The offset is relative to the address of the delay slot
     const uint32_t alignedOffset = offset << 2;
-    m_nextPC += alignedOffset;
+    m_nextPC = m_pc + alignedOffset;
 }
 
 void R3000A::SetRegister(uint32_t registerIndex, uint32_t value)
 {
-    m_outputRegisters[registerIndex] = value;
+    m_registers[registerIndex] = value;
 
     // Make sure R0 is always equal to 0
-    m_outputRegisters[0] = 0;
+    m_registers[0] = 0;
+
+    // An instruction writing to the target of a load in its
+    // delay slot wins over the load
+    if (registerIndex == m_delayedLoad.first)
+    {
+        m_delayedLoad = {};
+    }
+}
+
+// Loads only write their target after the next instruction. A load in the delay slot
+// of another one to the same register cancels it: the old value is read in between.
+void R3000A::SetRegisterDelayed(uint32_t registerIndex, uint32_t value)
+{
+    if (registerIndex == m_delayedLoad.first)
+    {
+        m_delayedLoad = {};
+    }
+
+    m_pendingLoad = {registerIndex, value};
+}
+
+// Value of a register including the load completing during the current instruction.
+// Used by LWL and LWR which bypass the load delay.
+uint32_t R3000A::GetLoadDelayedRegister(uint32_t registerIndex) const
+{
+    if (registerIndex == m_delayedLoad.first)
+    {
+        return m_delayedLoad.second;
+    }
+
+    return m_registers[registerIndex];
 }
 
 void R3000A::TriggerException(ExceptionCause cause)
@@ -228,9 +522,10 @@ void R3000A::TriggerException(ExceptionCause cause)
     m_sr &= ~0x3f;
     m_sr |= (mode << 2) & 0x3F;
 
-    // Update the CAUSE register with the exception code (bits [6:2])
-    m_cause <<= 2;
-    m_cause = static_cast<uint32_t>(cause) << 2;
+    // Update the CAUSE register with the exception code (bits [6:2]).
+    // Only the software interrupt bits [9:8] are preserved.
+    m_cause &= 0x300;
+    m_cause |= static_cast<uint32_t>(cause) << 2;
 
     // Save current instruction address in EPC
     m_epc = m_currentPC;
@@ -248,6 +543,36 @@ void R3000A::TriggerException(ExceptionCause cause)
     m_nextPC = m_pc + 4;
 }
 
+// Take the hardware or software interrupt, if any, before executing the next instruction
+void R3000A::CheckInterrupts()
+{
+    // Interrupts must be enabled (IEc) and the pending ones unmasked (IM)
+    if ((m_sr & 1) == 0 || (GetCause() & m_sr & 0x700) == 0)
+    {
+        return;
+    }
+
+    // The next instruction hasn't started: it's the one the handler returns to
+    m_currentPC = m_pc;
+    m_isInDelaySlot = m_isBranching;
+    m_isBranching = false;
+
+    TriggerException(ExceptionCause::INTERRUPT);
+}
+
+// Called when the CPU might start accepting a pending interrupt
+void R3000A::RequestInterruptCheck()
+{
+    m_interconnect.GetScheduler().Schedule(EventType::INTERRUPT, 0);
+}
+
+// The interrupt controller drives bit 10 (IP2) of the CAUSE register
+uint32_t R3000A::GetCause() const
+{
+    const bool pending = m_interconnect.GetInterruptController().IsPending();
+    return m_cause | (static_cast<uint32_t>(pending) << 10);
+}
+
 void R3000A::ExecuteLUI(Instruction inst)
 {
     uint32_t res = inst.GetImm() << 16;
@@ -267,14 +592,23 @@ void R3000A::ExecuteJ(Instruction inst)
 
 void R3000A::ExecuteMTC0(Instruction inst)
 {
-    uint32_t cop0Reg = inst.GetRd();
-    if (cop0Reg != 0xC)
+    const uint32_t value = m_registers[inst.GetRt()];
+
+    switch (inst.GetRd())
     {
-        // TODO: unimplemented register access
-        return;
+        case 0xC:
+            m_sr = value;
+            RequestInterruptCheck();
+            break;
+        case 0xD:
+            // Only the software interrupt bits can be written
+            m_cause = (m_cause & ~0x300u) | (value & 0x300);
+            RequestInterruptCheck();
+            break;
+        default:
+            // TODO: unimplemented register access (breakpoint registers)
+            break;
     }
-
-    m_sr = m_registers[inst.GetRt()];
 }
 
 void R3000A::ExecuteBNE(Instruction inst)
@@ -287,8 +621,9 @@ void R3000A::ExecuteBNE(Instruction inst)
 
 void R3000A::ExecuteJAL(Instruction inst)
 {
-    // Store return address in the RA register
-    SetRegister(31, m_pc);
+    // Store return address in the RA register.
+    // m_pc is the delay slot: execution resumes after it.
+    SetRegister(31, m_nextPC);
 
     ExecuteJ(inst);
 }
@@ -309,25 +644,30 @@ void R3000A::ExecuteBEQ(Instruction inst)
 
 void R3000A::ExecuteMFC0(Instruction inst)
 {
-    uint32_t cop0Reg = inst.GetRd();
-    if (cop0Reg != 0xC
-        || cop0Reg != 0xD
-        || cop0Reg != 0xE)
+    uint32_t value = 0;
+
+    switch (inst.GetRd())
     {
-        // TODO: unimplemented register access
-        return;
+        case 0xC: value = m_sr; break;
+        case 0xD: value = GetCause(); break;
+        case 0xE: value = m_epc; break;
+        case 0xF: value = 0x2; break;   // Processor ID
+        default:
+            // TODO: unimplemented register access
+            break;
     }
 
-    SetRegister(inst.GetRt(), m_sr);
-
-    m_pendingLoad = {{inst.GetRt()}, m_sr};
+    // Like loads, the value is only available after the next instruction
+    SetRegisterDelayed(inst.GetRt(), value);
 }
 
 void R3000A::ExecuteJALR(Instruction inst)
 {
+    // Read the target first in case the link register is also the source
+    const uint32_t returnAddress = m_nextPC;
     m_isBranching = true;
-    SetRegister(inst.GetRd(), m_pc);
     m_nextPC = m_registers[inst.GetRs()];
+    SetRegister(inst.GetRd(), returnAddress);
 }
 
 void R3000A::ExecuteSLTI(Instruction inst)
@@ -337,7 +677,7 @@ void R3000A::ExecuteSLTI(Instruction inst)
 
 void R3000A::ExecuteSRA(Instruction inst)
 {
-    const uint32_t value = (static_cast<int32_t>(inst.GetRt()) >> inst.GetShamt());
+    const uint32_t value = (static_cast<int32_t>(m_registers[inst.GetRt()]) >> inst.GetShamt());
     SetRegister(inst.GetRd(), value);
 }
 
@@ -367,7 +707,7 @@ void R3000A::ExecuteDIV(Instruction inst)
 
 void R3000A::ExecuteSRL(Instruction inst)
 {
-    SetRegister(inst.GetRd(), inst >> inst.GetShamt());
+    SetRegister(inst.GetRd(), m_registers[inst.GetRt()] >> inst.GetShamt());
 }
 
 void R3000A::ExecuteDIVU(Instruction inst)
@@ -398,9 +738,12 @@ void R3000A::ExecuteRFE(Instruction)
     // Restore the pre-exception mode by shifting the
     // Interrupt Enable/User Mode stack back to its 
     // original position.
+    // The oldest entry is left untouched.
     const uint32_t mode = m_sr & 0x3F;
-    m_sr &= !0x3F;
+    m_sr &= ~0xF;
     m_sr |= mode >> 2;
+
+    RequestInterruptCheck();
 }
 
 void R3000A::ExecuteSLLV(Instruction inst)
@@ -411,7 +754,7 @@ void R3000A::ExecuteSLLV(Instruction inst)
 
 void R3000A::ExecuteNOR(Instruction inst)
 {
-    SetRegister(inst.GetRd(), !(m_registers[inst.GetRs()] | m_registers[inst.GetRt()]));
+    SetRegister(inst.GetRd(), ~(m_registers[inst.GetRs()] | m_registers[inst.GetRt()]));
 }
 
 void R3000A::ExecuteSRAV(Instruction inst)
@@ -428,7 +771,7 @@ void R3000A::ExecuteSRLV(Instruction inst)
 
 void R3000A::ExecuteMULTU(Instruction inst)
 {
-    const uint64_t value = m_registers[inst.GetRs()] * m_registers[inst.GetRt()];
+    const uint64_t value = static_cast<uint64_t>(m_registers[inst.GetRs()]) * m_registers[inst.GetRt()];
 
     m_hi = value >> 32;
     m_lo = value;
@@ -436,8 +779,8 @@ void R3000A::ExecuteMULTU(Instruction inst)
 
 void R3000A::ExecuteMULT(Instruction inst)
 {
-    const int64_t lhs = m_registers[inst.GetRs()];
-    const int64_t rhs = m_registers[inst.GetRt()];
+    const int64_t lhs = static_cast<int32_t>(m_registers[inst.GetRs()]);
+    const int64_t rhs = static_cast<int32_t>(m_registers[inst.GetRt()]);
 
     const uint64_t result = lhs * rhs;
 
@@ -452,11 +795,11 @@ void R3000A::ExecuteLWL(Instruction inst)
     // This instruction bypasses the load delay restriction:
     // this instruction will merge the new contents with the
     // value currently being loaded if need be.
-    const uint32_t curValue = m_outputRegisters[inst.GetRt()];
+    const uint32_t curValue = GetLoadDelayedRegister(inst.GetRt());
 
     // Next, we load the *aligned* word containing the first
     // addressed byte
-    const uint32_t alignedAddr = address & !3;
+    const uint32_t alignedAddr = address & ~3;
     const uint32_t alignedWord = Load<uint32_t>(alignedAddr);
 
     // Depending on the address alignment, we fetch the 1,2,3 or 4
@@ -480,7 +823,7 @@ void R3000A::ExecuteLWL(Instruction inst)
             assert(false && "You've reached the unreachable!");
     }
 
-    m_pendingLoad = {{inst.GetRt()}, newValue};
+    SetRegisterDelayed(inst.GetRt(), newValue);
 }
 
 void R3000A::ExecuteLWR(Instruction inst)
@@ -490,11 +833,11 @@ void R3000A::ExecuteLWR(Instruction inst)
     // This instruction bypasses the load delay restriction:
     // this instruction will merge the new contents with the
     // value currently being loaded if need be.
-    const uint32_t curValue = m_outputRegisters[inst.GetRt()];
+    const uint32_t curValue = GetLoadDelayedRegister(inst.GetRt());
 
     // Next, we load the *aligned* word containing the first
     // addressed byte
-    const uint32_t alignedAddr = address & !3;
+    const uint32_t alignedAddr = address & ~3;
     const uint32_t alignedWord = Load<uint32_t>(alignedAddr);
 
     // Depending on the address alignment, we fetch the 1,2,3 or 4
@@ -509,7 +852,7 @@ void R3000A::ExecuteLWR(Instruction inst)
             newValue = (curValue & 0xFF000000) | (alignedWord >> 8);
             break;
         case 2:
-            newValue = (curValue & 0xFFFF0000) | (alignedWord << 16);
+            newValue = (curValue & 0xFFFF0000) | (alignedWord >> 16);
             break;
         case 3:
             newValue = (curValue & 0xFFFFFF00) | (alignedWord >> 24);
@@ -518,7 +861,7 @@ void R3000A::ExecuteLWR(Instruction inst)
             assert(false && "You've reached the unreachable!");
     }
 
-    m_pendingLoad = {{inst.GetRt()}, newValue};
+    SetRegisterDelayed(inst.GetRt(), newValue);
 }
 
 void R3000A::ExecuteSWL(Instruction inst)
@@ -526,7 +869,7 @@ void R3000A::ExecuteSWL(Instruction inst)
     const uint32_t address = m_registers[inst.GetRs()] + inst.GetImmSe();
     const uint32_t value = m_registers[inst.GetRt()];
 
-    const uint32_t alignedAddr = address & !3;
+    const uint32_t alignedAddr = address & ~3;
 
     // Load the current value for the aligned word at the target address
     const uint32_t curValue = Load<uint32_t>(alignedAddr);
@@ -535,13 +878,13 @@ void R3000A::ExecuteSWL(Instruction inst)
     switch (address & 3)
     {
         case 0:
-            newValue = (curValue & 0x00FFFFFF) | (value >> 24);
+            newValue = (curValue & 0xFFFFFF00) | (value >> 24);
             break;
         case 1:
-            newValue = (curValue & 0x0000FFFF) | (value >> 16);
+            newValue = (curValue & 0xFFFF0000) | (value >> 16);
             break;
         case 2:
-            newValue = (curValue & 0x000000FF) | (value >> 8);
+            newValue = (curValue & 0xFF000000) | (value >> 8);
             break;
         case 3:
             newValue = (curValue & 0x00000000) | (value >> 0);
@@ -558,7 +901,7 @@ void R3000A::ExecuteSWR(Instruction inst)
     const uint32_t address = m_registers[inst.GetRs()] + inst.GetImmSe();
     const uint32_t value = m_registers[inst.GetRt()];
 
-    const uint32_t alignedAddr = address & !3;
+    const uint32_t alignedAddr = address & ~3;
 
     // Load the current value for the aligned word at the target address
     const uint32_t curValue = Load<uint32_t>(alignedAddr);
@@ -570,13 +913,13 @@ void R3000A::ExecuteSWR(Instruction inst)
             newValue = (curValue & 0x00000000) | (value << 0);
             break;
         case 1:
-            newValue = (curValue & 0xFF000000) | (value << 8);
+            newValue = (curValue & 0x000000FF) | (value << 8);
             break;
         case 2:
-            newValue = (curValue & 0xFFFF0000) | (value << 16);
+            newValue = (curValue & 0x0000FFFF) | (value << 16);
             break;
         case 3:
-            newValue = (curValue & 0xFFFFFF00) | (value << 24);
+            newValue = (curValue & 0x00FFFFFF) | (value << 24);
             break;
         default:
             assert(false && "You've reached the unreachable!");
@@ -585,4 +928,429 @@ void R3000A::ExecuteSWR(Instruction inst)
     Store<uint32_t>(alignedAddr, newValue);
 }
 
+void R3000A::ExecuteCoprocessorError(Instruction)
+{
+    TriggerException(ExceptionCause::COPROCESSOR_ERROR);
+}
+
+void R3000A::ExecuteUnimplemented(Instruction)
+{
+    assert(false && "Unimplemented instruction");
+}
+
+void R3000A::ExecuteIllegal(Instruction)
+{
+    assert(false && "ILLEGAL INSTRUCTION!!!");
+    TriggerException(ExceptionCause::ILLEGAL_INSTRUCTION);
+}
+
+// Only found at the entry points of the HLE kernel
+void R3000A::ExecuteHLE(Instruction inst)
+{
+    if (!m_hle)
+    {
+        ExecuteIllegal(inst);
+        return;
+    }
+
+    m_hle->Execute(*this, inst.GetImm());
+}
+
+template <> void R3000A::Execute<ORI>(Instruction inst)     { ExecuteALU(std::bit_or<uint32_t>{}, DecodeZeroExtendedImmediate<uint32_t>, inst); }
+template <> void R3000A::Execute<SW>(Instruction inst)      { ExecuteStore<uint32_t>(inst); }
+template <> void R3000A::Execute<ADDIU>(Instruction inst)   { ExecuteALU(std::plus<uint32_t>{}, DecodeSignExtendedImmediate<uint32_t>, inst); }
+template <> void R3000A::Execute<OR>(Instruction inst)      { ExecuteALU(std::bit_or<uint32_t>{}, DecodeThreeOperands<uint32_t>, inst); }
+template <> void R3000A::Execute<ADDI>(Instruction inst)    { ExecuteTrappingALU(OverflowingPlus{}, DecodeSignExtendedImmediate<int32_t>, inst); }
+template <> void R3000A::Execute<LW>(Instruction inst)      { ExecuteLoad<uint32_t>(inst); }
+template <> void R3000A::Execute<SLTU>(Instruction inst)    { ExecuteALU(std::less<uint32_t>{}, DecodeThreeOperands<uint32_t>, inst); }
+template <> void R3000A::Execute<ADDU>(Instruction inst)    { ExecuteALU(std::plus<uint32_t>{}, DecodeThreeOperands<uint32_t>, inst); }
+template <> void R3000A::Execute<SH>(Instruction inst)      { ExecuteStore<uint16_t>(inst); }
+template <> void R3000A::Execute<ANDI>(Instruction inst)    { ExecuteALU(std::bit_and<uint32_t>{}, DecodeZeroExtendedImmediate<uint32_t>, inst); }
+template <> void R3000A::Execute<SB>(Instruction inst)      { ExecuteStore<uint8_t>(inst); }
+template <> void R3000A::Execute<LB>(Instruction inst)      { ExecuteLoad<uint8_t, int8_t>(inst); }
+template <> void R3000A::Execute<AND>(Instruction inst)     { ExecuteALU(std::bit_and<uint32_t>{}, DecodeThreeOperands<uint32_t>, inst); }
+template <> void R3000A::Execute<ADD>(Instruction inst)     { ExecuteTrappingALU(OverflowingPlus{}, DecodeThreeOperands<int32_t>, inst); }
+template <> void R3000A::Execute<BGTZ>(Instruction inst)    { ExecuteBranch(std::greater<int32_t>{}, inst); }
+template <> void R3000A::Execute<BLEZ>(Instruction inst)    { ExecuteBranch(std::less_equal<int32_t>{}, inst); }
+template <> void R3000A::Execute<LBU>(Instruction inst)     { ExecuteLoad<uint8_t>(inst); }
+template <> void R3000A::Execute<BLTZ>(Instruction inst)    { ExecuteBranch(std::less<int32_t>{}, inst); }
+template <> void R3000A::Execute<BLTZAL>(Instruction inst)  { ExecuteBranchAndLink(std::less<int32_t>{}, inst); }
+template <> void R3000A::Execute<BGEZ>(Instruction inst)    { ExecuteBranch(std::greater_equal<int32_t>{}, inst); }
+template <> void R3000A::Execute<BGEZAL>(Instruction inst)  { ExecuteBranchAndLink(std::greater_equal<int32_t>{}, inst); }
+template <> void R3000A::Execute<SUBU>(Instruction inst)    { ExecuteALU(std::minus<uint32_t>{}, DecodeThreeOperands<uint32_t>, inst); }
+template <> void R3000A::Execute<MFLO>(Instruction inst)    { SetRegister(inst.GetRd(), m_lo); }
+template <> void R3000A::Execute<SLTIU>(Instruction inst)   { ExecuteALU(std::less<uint32_t>{}, DecodeSignExtendedImmediate<uint32_t>, inst); }
+template <> void R3000A::Execute<MFHI>(Instruction inst)    { SetRegister(inst.GetRd(), m_hi); }
+template <> void R3000A::Execute<SYSCALL>(Instruction)      { TriggerException(ExceptionCause::SYSCALL); }
+template <> void R3000A::Execute<MTLO>(Instruction inst)    { m_lo = m_registers[inst.GetRs()]; }
+template <> void R3000A::Execute<MTHI>(Instruction inst)    { m_hi = m_registers[inst.GetRs()]; }
+template <> void R3000A::Execute<LHU>(Instruction inst)     { ExecuteLoad<uint16_t>(inst); }
+template <> void R3000A::Execute<LH>(Instruction inst)      { ExecuteLoad<uint16_t, int16_t>(inst); }
+template <> void R3000A::Execute<XOR>(Instruction inst)     { ExecuteALU(std::bit_xor<uint32_t>{}, DecodeThreeOperands<uint32_t>, inst); }
+template <> void R3000A::Execute<BREAK>(Instruction)        { TriggerException(ExceptionCause::BREAK); }
+template <> void R3000A::Execute<SUB>(Instruction inst)     { ExecuteTrappingALU(OverflowingMinus{}, DecodeThreeOperands<int32_t>, inst); }
+template <> void R3000A::Execute<XORI>(Instruction inst)    { ExecuteALU(std::bit_xor<uint32_t>{}, DecodeZeroExtendedImmediate<uint32_t>, inst); }
+
+constexpr InstructionHandler R3000A::GetHandler(Opcode op)
+{
+    switch(op)
+    {
+        case LUI:     return &R3000A::ExecuteLUI;
+        case ORI:     return &R3000A::Execute<ORI>;
+        case SW:      return &R3000A::Execute<SW>;
+        case SLL:     return &R3000A::ExecuteSLL;
+        case ADDIU:   return &R3000A::Execute<ADDIU>;
+        case J:       return &R3000A::ExecuteJ;
+        case OR:      return &R3000A::Execute<OR>;
+        case MTC0:    return &R3000A::ExecuteMTC0;
+        case BNE:     return &R3000A::ExecuteBNE;
+        case ADDI:    return &R3000A::Execute<ADDI>;
+        case LW:      return &R3000A::Execute<LW>;
+        case SLTU:    return &R3000A::Execute<SLTU>;
+        case ADDU:    return &R3000A::Execute<ADDU>;
+        case SH:      return &R3000A::Execute<SH>;
+        case JAL:     return &R3000A::ExecuteJAL;
+        case ANDI:    return &R3000A::Execute<ANDI>;
+        case SB:      return &R3000A::Execute<SB>;
+        case JR:      return &R3000A::ExecuteJR;
+        case LB:      return &R3000A::Execute<LB>;
+        case BEQ:     return &R3000A::ExecuteBEQ;
+        case MFC0:    return &R3000A::ExecuteMFC0;
+        case AND:     return &R3000A::Execute<AND>;
+        case ADD:     return &R3000A::Execute<ADD>;
+        case BGTZ:    return &R3000A::Execute<BGTZ>;
+        case BLEZ:    return &R3000A::Execute<BLEZ>;
+        case LBU:     return &R3000A::Execute<LBU>;
+        case JALR:    return &R3000A::ExecuteJALR;
+        case BLTZ:    return &R3000A::Execute<BLTZ>;
+        case BLTZAL:  return &R3000A::Execute<BLTZAL>;
+        case BGEZ:    return &R3000A::Execute<BGEZ>;
+        case BGEZAL:  return &R3000A::Execute<BGEZAL>;
+        case SLTI:    return &R3000A::ExecuteSLTI;
+        case SUBU:    return &R3000A::Execute<SUBU>;
+        case SRA:     return &R3000A::ExecuteSRA;
+        case DIV:     return &R3000A::ExecuteDIV;
+        case MFLO:    return &R3000A::Execute<MFLO>;
+        case SRL:     return &R3000A::ExecuteSRL;
+        case SLTIU:   return &R3000A::Execute<SLTIU>;
+        case DIVU:    return &R3000A::ExecuteDIVU;
+        case MFHI:    return &R3000A::Execute<MFHI>;
+        case SLT:     return &R3000A::ExecuteSLT;
+        case SYSCALL: return &R3000A::Execute<SYSCALL>;
+        case MTLO:    return &R3000A::Execute<MTLO>;
+        case MTHI:    return &R3000A::Execute<MTHI>;
+        case RFE :    return &R3000A::ExecuteRFE;
+        case LHU :    return &R3000A::Execute<LHU>;
+        case SLLV:    return &R3000A::ExecuteSLLV;
+        case LH:      return &R3000A::Execute<LH>;
+        case NOR:     return &R3000A::ExecuteNOR;
+        case SRAV:    return &R3000A::ExecuteSRAV;
+        case SRLV:    return &R3000A::ExecuteSRLV;
+        case MULTU:   return &R3000A::ExecuteMULTU;
+        case XOR:     return &R3000A::Execute<XOR>;
+        case BREAK:   return &R3000A::Execute<BREAK>;
+        case MULT:    return &R3000A::ExecuteMULT;
+        case SUB:     return &R3000A::Execute<SUB>;
+        case XORI:    return &R3000A::Execute<XORI>;
+        case COP1:    return &R3000A::ExecuteCoprocessorError;
+        case COP2:    return &R3000A::ExecuteUnimplemented;
+        case COP3:    return &R3000A::ExecuteCoprocessorError;
+        case LWL:     return &R3000A::ExecuteLWL;
+        case LWR:     return &R3000A::ExecuteLWR;
+        case SWL:     return &R3000A::ExecuteSWL;
+        case SWR:     return &R3000A::ExecuteSWR;
+        case LWC0:    return &R3000A::ExecuteCoprocessorError;
+        case LWC1:    return &R3000A::ExecuteCoprocessorError;
+        case LWC2:    return &R3000A::ExecuteUnimplemented;
+        case LWC3:    return &R3000A::ExecuteCoprocessorError;
+        case SWC0:    return &R3000A::ExecuteCoprocessorError;
+        case SWC1:    return &R3000A::ExecuteCoprocessorError;
+        case SWC2:    return &R3000A::ExecuteUnimplemented;
+        case SWC3:    return &R3000A::ExecuteCoprocessorError;
+        case HLE:     return &R3000A::ExecuteHLE;
+        default:      return &R3000A::ExecuteIllegal;
+    }
+}
+
+// Builds the table of handlers for all the values of a 5 or 6 bits opcode field.
+// Entry <i> handles the opcode pattern <base> | (<i> << <shift>).
+template <size_t TSize>
+constexpr R3000A::HandlerTable<TSize> R3000A::MakeHandlerTable(uint32_t base, uint32_t shift)
+{
+    HandlerTable<TSize> table{};
+
+    for (uint32_t iEntry = 0; iEntry < TSize; ++iEntry)
+    {
+        table[iEntry] = GetHandler(static_cast<Opcode>(base | (iEntry << shift)));
+    }
+
+    return table;
+}
+
+// Indexed by bits [31:26]
+constexpr R3000A::HandlerTable<64> R3000A::PRIMARY_HANDLERS = MakeHandlerTable<64>(0x00000000, 26);
+
+// SPECIAL instructions (primary opcode 0x00), indexed by bits [5:0]
+constexpr R3000A::HandlerTable<64> R3000A::SPECIAL_HANDLERS = MakeHandlerTable<64>(0x00000000, 0);
+
+// BCOND instructions (primary opcode 0x01), indexed by bits [20:16]
+constexpr R3000A::HandlerTable<32> R3000A::REGIMM_HANDLERS = []()
+{
+    HandlerTable<32> table{};
+
+    // The hardware only decodes part of the field: bit 16 selects the condition and
+    // bits [20:17] link when they are 0b1000. The other encodings aren't illegal.
+    for (uint32_t iEntry = 0; iEntry < 32; ++iEntry)
+    {
+        const bool isGreaterOrEqual = (iEntry & 0x01) != 0;
+        const bool isLinking = (iEntry & 0x1E) == 0x10;
+
+        table[iEntry] = isLinking ? GetHandler(isGreaterOrEqual ? BGEZAL : BLTZAL)
+                                  : GetHandler(isGreaterOrEqual ? BGEZ : BLTZ);
+    }
+
+    return table;
+}();
+
+// COP0 instructions (primary opcode 0x10), indexed by bits [25:21]
+constexpr R3000A::HandlerTable<32> R3000A::COP0_HANDLERS = []()
+{
+    HandlerTable<32> table = MakeHandlerTable<32>(0x40000000, 21);
+
+    // When bit 25 is set the operation is encoded in bits [5:0].
+    // The only such operation supported by the R3000A is RFE
+    // since it doesn't have a TLB.
+    for (uint32_t iEntry = 0x10; iEntry < 0x20; ++iEntry)
+    {
+        table[iEntry] = &R3000A::ExecuteRFE;
+    }
+
+    return table;
+}();
+
+InstructionHandler R3000A::Decode(Instruction inst)
+{
+    switch (inst.GetPrimaryOpcode())
+    {
+        case 0x00: return SPECIAL_HANDLERS[inst.GetFunct()];
+        case 0x01: return REGIMM_HANDLERS[inst.GetRt()];
+        case 0x10: return COP0_HANDLERS[inst.GetRs()];
+        default:   return PRIMARY_HANDLERS[inst.GetPrimaryOpcode()];
+    }
+}
+
+// An idle loop branches back to its own start and only loads from memory and
+// computes registers. If none of the registers it reads before writing them
+// is modified by the loop, every iteration computes the same thing as long as
+// memory doesn't change, which only devices can do.
+bool R3000A::IsIdleLoop(const DecodedBlock& block, uint32_t address)
+{
+    const auto& instructions = block.m_instructions;
+    if (instructions.size() < 2 || instructions.size() > MAX_IDLE_LOOP_SIZE)
+    {
+        return false;
+    }
+
+    // The branch is the second to last instruction, followed by its delay slot
+    const Instruction branch = instructions[instructions.size() - 2].m_inst;
+    const uint32_t delaySlotAddress = address + 4 * static_cast<uint32_t>(instructions.size() - 1);
+
+    uint32_t target = 0;
+    switch (branch.GetOp())
+    {
+        case J:
+            target = (delaySlotAddress & 0xF0000000) | (branch.GetImmJump() << 2);
+            break;
+        case BEQ: case BNE: case BLEZ: case BGTZ: case BLTZ:
+            target = delaySlotAddress + (branch.GetImmSe() << 2);
+            break;
+        default:
+            return false;
+    }
+
+    if (target != address)
+    {
+        return false;
+    }
+
+    uint32_t written = 0;
+    uint32_t readBeforeWritten = 0;
+    uint32_t pendingLoad = 0;
+
+    for (const DecodedInstruction& decoded : instructions)
+    {
+        const std::optional<RegisterUsage> usage = GetIdleLoopRegisterUsage(decoded.m_inst);
+        if (!usage)
+        {
+            return false;
+        }
+
+        readBeforeWritten |= usage->m_reads & ~written;
+
+        // A load only lands after the next instruction read the registers
+        written |= pendingLoad;
+        pendingLoad = 0;
+
+        if (usage->m_isLoad)
+        {
+            pendingLoad = 1 << usage->m_write;
+        }
+        else
+        {
+            written |= 1 << usage->m_write;
+        }
+    }
+
+    written |= pendingLoad;
+
+    // R0 is never really written
+    return (readBeforeWritten & written & ~1u) == 0;
+}
+
+// Branches and jumps: execution may not continue sequentially after their delay slot
+bool R3000A::HasDelaySlot(Opcode op)
+{
+    switch(op)
+    {
+        case J:
+        case JAL:
+        case JR:
+        case JALR:
+        case BEQ:
+        case BNE:
+        case BGTZ:
+        case BLEZ:
+        case BLTZ:
+        case BLTZAL:
+        case BGEZ:
+        case BGEZAL:
+            return true;
+        default:
+            return false;
+    }
+}
+
+DecodedInstruction R3000A::Fetch(uint32_t address)
+{
+    if (m_executionMode == ExecutionMode::CACHED_INTERPRETER)
+    {
+        if (const DecodedInstruction* decoded = FetchCached(address))
+        {
+            return *decoded;
+        }
+    }
+
+    const Instruction inst = m_interconnect.Load<uint32_t>(address);
+    return { Decode(inst), inst };
+}
+
+// Returns the decoded instruction at <address>, decoding a new block if need be.
+// Returns nullptr if the instruction doesn't come from memory that can be cached.
+const DecodedInstruction* R3000A::FetchCached(uint32_t address)
+{
+    // Fast path: we're still executing the current block sequentially
+    if (m_currentBlock != nullptr
+        && address == m_blockNextPC
+        && m_blockIndex < m_currentBlock->m_instructions.size())
+    {
+        m_blockNextPC += 4;
+        return &m_currentBlock->m_instructions[m_blockIndex++];
+    }
+
+    if (EnterBlock(address) == nullptr)
+    {
+        return nullptr;
+    }
+
+    m_blockIndex = 1;
+    m_blockNextPC = address + 4;
+    return &m_currentBlock->m_instructions.front();
+}
+
+// Makes the block starting at <address> the current block.
+// Returns nullptr if the instruction doesn't come from memory that can be cached.
+DecodedBlock* R3000A::EnterBlock(uint32_t address)
+{
+    DecodedBlock* previousBlock = m_currentBlock;
+    m_currentBlock = nullptr;
+
+    // First try to follow the links between blocks to avoid looking up the cache
+    if (previousBlock != nullptr)
+    {
+        m_currentBlock = m_blockCache.FollowLink(*previousBlock, address);
+        if (m_currentBlock != nullptr)
+        {
+            return m_currentBlock;
+        }
+    }
+
+    uint32_t physAddr = m_interconnect.GetPhysicalAddress(address);
+
+    // The same code can be reached through the RAM mirrors
+    if (auto offset = RAM_MIRRORS_RANGE.Contains(physAddr))
+    {
+        physAddr = RAM_ADDRESS + (*offset % RAM_SIZE);
+    }
+
+    m_currentBlock = m_blockCache.Find(physAddr);
+    if (m_currentBlock == nullptr)
+    {
+        m_currentBlock = DecodeBlock(address, physAddr);
+        if (m_currentBlock == nullptr)
+        {
+            return nullptr;
+        }
+    }
+
+    if (previousBlock != nullptr)
+    {
+        const uint32_t previousBlockEnd = m_blockNextPC + 4 * (previousBlock->m_instructions.size() - m_blockIndex);
+        m_blockCache.Link(*previousBlock, previousBlockEnd, address, *m_currentBlock);
+    }
+
+    return m_currentBlock;
+}
+
+DecodedBlock* R3000A::DecodeBlock(uint32_t address, uint32_t physAddr)
+{
+    // Only code living in RAM or in the BIOS is worth caching
+    if (auto offset = RAM_RANGE.Contains(physAddr))
+    {
+        // Make sure we hear about it if this code gets overwritten
+        m_interconnect.GetRAM().MarkCodePage(*offset);
+    }
+    else if (BIOS_RANGE.Contains(physAddr) == std::nullopt)
+    {
+        return nullptr;
+    }
+
+    const uint32_t startAddress = address;
+
+    DecodedBlock block;
+    bool isDelaySlot = false;
+
+    for (;;)
+    {
+        const Instruction inst = m_interconnect.Load<uint32_t>(address);
+        const Opcode op = inst.GetOp();
+
+        block.m_instructions.push_back({ Decode(inst), inst });
+        address += 4;
+
+        if (isDelaySlot
+            || ((address % BlockCache::PAGE_SIZE) == 0)
+            || (block.m_instructions.size() == BlockCache::MAX_BLOCK_SIZE))
+        {
+            break;
+        }
+
+        // The block ends with the delay slot of the first branch
+        isDelaySlot = HasDelaySlot(op);
+    }
+
+    block.m_isIdleLoop = IsIdleLoop(block, startAddress);
+
+    return &m_blockCache.Insert(physAddr, std::move(block));
+}
+
 }   // end namespace PSEmu
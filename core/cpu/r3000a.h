@@ -2,22 +2,28 @@
 #define R3000A_H
 
 #include "../debug/debugger.h"
+#include "blockcache.h"
+#include "hlebios.h"
 #include "instruction.h"
 #include "interconnect.h"
+#include "../memory/psxexe.h"
 
 #include <array>
-#include <functional>
-
-bool WouldOverflow(int32_t lhs, int32_t rhs, std::function<int32_t(int32_t,int32_t)> func);
+#include <optional>
+#include <vector>
 
 namespace PSEmu
 {
 
 class R3000A
 {
+    // The HLE kernel works on the state of the CPU like the BIOS code it replaces
+    friend class HLEBios;
+
 private:
     enum class ExceptionCause
     {
+        INTERRUPT           = 0x0,
         LOAD_ADDRESS_ERROR  = 0x4,
         STORE_ADDRESS_ERROR = 0x5,
         SYSCALL             = 0x8,
@@ -28,7 +34,15 @@ private:
     };
 
 public:
-    R3000A(Interconnect interconnect, Debugger debugger);
+    enum class ExecutionMode
+    {
+        INTERPRETER,        // Fetch and decode every instruction as it is executed
+        CACHED_INTERPRETER  // Execute blocks of instructions decoded ahead of time
+    };
+
+public:
+    R3000A(Interconnect interconnect, Debugger debugger, ExecutionMode mode = ExecutionMode::INTERPRETER, 
+           bool useHLE = false);
 
     // It should not be possible to copy or move this class
     R3000A(const R3000A&) = delete;
@@ -39,18 +53,66 @@ public:
 
 public:
     void Step();
+    void Run(uint32_t cycles);
+    bool RunUntil(uint32_t address, uint64_t maxCycles);
     void Reset();
 
+    void SideLoad(const PsxExe& exe);
+
+    // Snapshot of the whole machine, to be loaded back with the same BIOS image and kernel mode.
+    // A state rejected because of its header (magic, version, BIOS, kernel or memories) leaves the machine
+    // untouched. The rest is loaded as it is read and checked: a state rejected past its header leaves the
+    // machine partly loaded, possibly without any scheduled event, and Reset() must be called.
+    // States without the memories are restored along with the memories content by the caller.
+    void SaveState(std::vector<uint8_t>& state, bool includeMemories = true) const;
+    bool LoadState(const uint8_t* data, size_t size, bool includeMemories = true);
+
+    // Frames and TTY text aren't output while disabled, e.g. while emulating speculative frames
+    void SetOutputEnabled(bool enabled);
+
 public:
     uint32_t GetPC() const;
+    void SetPC(uint32_t address);
+
     const std::array<uint32_t, 32>& GetRegisters() const;
 
+    uint64_t GetInstructionCount() const;
+
+    Interconnect& GetInterconnect();
+
 private:
     void Branch(uint32_t offset);
     void SetRegister(uint32_t registerIndex, uint32_t value);
+    void SetRegisterDelayed(uint32_t registerIndex, uint32_t value);
+    uint32_t GetLoadDelayedRegister(uint32_t registerIndex) const;
     void TriggerException(ExceptionCause cause);
+    void CheckInterrupts();
+    void RequestInterruptCheck();
+    uint32_t GetCause() const;
+
+private:
+    template <size_t TSize>
+    using HandlerTable = std::array<InstructionHandler, TSize>;
+
+    static constexpr InstructionHandler GetHandler(Opcode op);
+
+    template <size_t TSize>
+    static constexpr HandlerTable<TSize> MakeHandlerTable(uint32_t base, uint32_t shift);
+
+    static InstructionHandler Decode(Instruction inst);
+    static bool HasDelaySlot(Opcode op);
+    static bool IsIdleLoop(const DecodedBlock& block, uint32_t address);
+
+    DecodedInstruction Fetch(uint32_t address);
+    const DecodedInstruction* FetchCached(uint32_t address);
+    DecodedBlock* EnterBlock(uint32_t address);
+    void Dispatch(const DecodedInstruction& instToExec);
+    DecodedBlock* DecodeBlock(uint32_t address, uint32_t physAddr);
 
 private:
+    template <Opcode TOpcode>
+    void Execute(Instruction inst);
+
     void ExecuteLUI(Instruction inst);
     void ExecuteSLL(Instruction inst);
     void ExecuteJ(Instruction inst);
@@ -78,6 +140,10 @@ private:
     void ExecuteLWR(Instruction inst);
     void ExecuteSWL(Instruction inst);
     void ExecuteSWR(Instruction inst);
+    void ExecuteCoprocessorError(Instruction inst);
+    void ExecuteUnimplemented(Instruction inst);
+    void ExecuteIllegal(Instruction inst);
+    void ExecuteHLE(Instruction inst);
 
 private:
     // TODO: Load should probably return an optional value since it'll be ignored when the cache is isolated
@@ -90,8 +156,8 @@ private:
     template <typename TOperator, typename TDecoder>
     void ExecuteALU(TOperator&& op, TDecoder&& dec, Instruction inst);
 
-    template <typename TOperator, typename TOverflow, typename TDecoder>
-    void ExecuteTrappingALU(TOperator&& op, TOverflow&& overflowHandler, TDecoder&& dec, Instruction inst);
+    template <typename TOperator, typename TDecoder>
+    void ExecuteTrappingALU(TOperator&& op, TDecoder&& dec, Instruction inst);
 
     template <typename TComparator>
     void ExecuteBranch(TComparator&& comp, Instruction inst);
@@ -107,7 +173,6 @@ private:
 
 private:
     std::array<uint32_t, 32> m_registers;        /**< CPU registers */  
-    std::array<uint32_t, 32> m_outputRegisters;  /**< CPU registers. Used ti simulate the load delay slot */
     uint32_t m_pc;                /**< Program counter. Points to the next instruction */
     uint32_t m_nextPC;            /**< Next value for the PC. Used to simulate the branch delay slot */
     uint32_t m_currentPC;         /**< Address of the instruction currently being executed.
@@ -118,6 +183,8 @@ private:
     Interconnect m_interconnect;
     Instruction m_nextInst;       /**< Next instruction to execute. Used to simulate the branch delay slot */
     std::pair<uint32_t, uint32_t> m_pendingLoad; /**< Load initiated by the current instruction */
+    std::pair<uint32_t, uint32_t> m_delayedLoad; /**< Load completing at the end of the current instruction.
+                                                      Used to simulate the load delay slot */
 
     uint32_t m_sr;                /**< Cop0 register 12: Status register
                                         It is used to mask exceptions and control the cache behavior */
@@ -129,6 +196,21 @@ private:
     bool m_isInDelaySlot;         /**< Set if the current instruction executes in the delay slot */
 
     Debugger m_debugger;
+
+    static const HandlerTable<64> PRIMARY_HANDLERS;  /**< Handlers indexed by the primary opcode */
+    static const HandlerTable<64> SPECIAL_HANDLERS;  /**< Handlers for the SPECIAL instructions */
+    static const HandlerTable<32> REGIMM_HANDLERS;   /**< Handlers for the BCOND instructions */
+    static const HandlerTable<32> COP0_HANDLERS;     /**< Handlers for the coprocessor 0 instructions */
+
+    ExecutionMode m_executionMode;
+    BlockCache m_blockCache;
+    DecodedBlock* m_currentBlock; /**< Block being executed in cached interpreter mode */
+    uint32_t m_blockIndex;        /**< Index of the next instruction to execute in the current block */
+    uint32_t m_blockNextPC;       /**< Address of the next instruction in the current block */
+
+    uint64_t m_instructionCount;  /**< Number of instructions executed since the last reset */
+
+    std::optional<HLEBios> m_hle; /**< Kernel emulated natively instead of running the BIOS */
 };
 
 template <typename TSize>
@@ -146,6 +228,7 @@ TSize R3000A::Load(uint32_t address)
     if (address % sizeof(TSize) != 0)
     {
         TriggerException(ExceptionCause::LOAD_ADDRESS_ERROR);
+        return 0;
     }
 
     return m_interconnect.Load<TSize>(address);
@@ -166,6 +249,7 @@ void R3000A::Store(uint32_t address, TSize value)
     if (address % sizeof(TSize) != 0)
     {
         TriggerException(ExceptionCause::STORE_ADDRESS_ERROR);
+        return;
     }
 
     m_interconnect.Store<TSize>(address, value);
@@ -178,18 +262,21 @@ void R3000A::ExecuteALU(TOperator&& op, TDecoder&& dec, Instruction inst)
     SetRegister(destReg, op(lhs, rhs));
 }
 
-template <typename TOperator, typename TOverflow, typename TDecoder>
-void R3000A::ExecuteTrappingALU(TOperator&& op, TOverflow&& overflowHandler, TDecoder&& dec, Instruction inst)
+// <op> computes the result and returns true if it overflowed
+template <typename TOperator, typename TDecoder>
+void R3000A::ExecuteTrappingALU(TOperator&& op, TDecoder&& dec, Instruction inst)
 {
     const auto& [destReg, lhs, rhs] = dec(m_registers, inst);
 
-    // Check for overflow.
-    if (WouldOverflow(lhs, rhs, overflowHandler))
+    int32_t result;
+    if (op(lhs, rhs, result))
     {
+        // The destination register isn't modified when an overflow occurs
         TriggerException(ExceptionCause::OVERFLOW);
+        return;
     }
 
-    SetRegister(destReg, op(lhs, rhs));
+    SetRegister(destReg, result);
 }
 
 template <typename TComparator>
@@ -205,23 +292,26 @@ void R3000A::ExecuteBranch(TComparator&& comp, Instruction inst)
 template <typename TComparator>
 void R3000A::ExecuteBranchAndLink(TComparator&& comp, Instruction inst)
 {
-    // Store return address in the RA register
-    SetRegister(31, m_pc);
-
+    // The condition must be evaluated before RA is overwritten.
+    // Execution resumes after the delay slot.
+    const uint32_t returnAddress = m_nextPC;
     ExecuteBranch(std::forward<TComparator>(comp), inst);
+
+    // Store return address in the RA register
+    SetRegister(31, returnAddress);
 }
 
 template <typename TLoad, typename TExtension>
 void R3000A::ExecuteLoad(Instruction inst)
 {
-    uint32_t address = m_registers[inst.GetRs()] + inst.GetImmSe();
-
-    // TODO: Subtle bug here and in all memory related operations
-    //       The problem is that a load/store shouldn't be completed
-    //       if an exception is triggered
-    TExtension value = Load<TLoad>(address); 
+    const uint32_t address = m_registers[inst.GetRs()] + inst.GetImmSe();
+    const TExtension value = Load<TLoad>(address); 
 
-    m_pendingLoad = {{inst.GetRt()}, value};
+    // A load raising an address error leaves its register alone
+    if (address % sizeof(TLoad) == 0)
+    {
+        SetRegisterDelayed(inst.GetRt(), static_cast<uint32_t>(value));
+    }
 }
 
 template <typename TSize>
@@ -0,0 +1,197 @@
+#include "rewind.h"
+
+#include "r3000a.h"
+
+#include <cassert>
+#include <cstring>
+
+using namespace PSEmu;
+
+RewindBuffer::RewindBuffer(size_t capacity, size_t maxBytes)
+    : m_snapshots(capacity), m_first{ 0 }, m_count{ 0 }, m_maxBytes{ maxBytes }, m_usedBytes{ 0 },
+      m_ramShadow{}, m_vramShadow{}
+{
+    assert(capacity > 0);
+}
+
+void RewindBuffer::Capture(R3000A& cpu)
+{
+    Interconnect& interconnect = cpu.GetInterconnect();
+
+    if (m_count == m_snapshots.size())
+    {
+        DropOldest();
+    }
+
+    // There is nothing to undo before the oldest snapshot
+    Snapshot& snapshot = GetSnapshot(m_count);
+    snapshot.m_ram.Clear();
+    snapshot.m_vram.Clear();
+
+    CaptureMemory(interconnect.GetRAM(), m_ramShadow, m_count > 0 ? &snapshot.m_ram : nullptr);
+    CaptureMemory(interconnect.GetGPU().GetVRAM(), m_vramShadow, m_count > 0 ? &snapshot.m_vram : nullptr);
+
+    cpu.SaveState(snapshot.m_state, false);
+
+    ++m_count;
+    m_usedBytes += snapshot.GetSize();
+
+    while (m_usedBytes > m_maxBytes && m_count > 1)
+    {
+        DropOldest();
+    }
+}
+
+bool RewindBuffer::Rewind(R3000A& cpu)
+{
+    if (m_count == 0)
+    {
+        return false;
+    }
+
+    Interconnect& interconnect = cpu.GetInterconnect();
+    Snapshot& snapshot = GetSnapshot(m_count - 1);
+
+    RestoreMemory(interconnect.GetRAM(), m_ramShadow);
+    RestoreMemory(interconnect.GetGPU().GetVRAM(), m_vramShadow);
+
+    [[maybe_unused]] const bool loaded = cpu.LoadState(snapshot.m_state.data(), snapshot.m_state.size(), false);
+    assert(loaded && "Snapshot rejected by the CPU");
+
+    UndoMemory(interconnect.GetRAM(), m_ramShadow, snapshot.m_ram);
+    UndoMemory(interconnect.GetGPU().GetVRAM(), m_vramShadow, snapshot.m_vram);
+
+    m_usedBytes -= snapshot.GetSize();
+    --m_count;
+
+    return true;
+}
+
+// The next capture copies the whole memories again, e.g. after the machine was reset
+void RewindBuffer::Clear()
+{
+    m_first = 0;
+    m_count = 0;
+    m_usedBytes = 0;
+    m_ramShadow.m_data.clear();
+    m_vramShadow.m_data.clear();
+}
+
+size_t RewindBuffer::GetCount() const
+{
+    return m_count;
+}
+
+size_t RewindBuffer::GetMemoryUsage() const
+{
+    return m_usedBytes + m_ramShadow.m_data.size() + m_vramShadow.m_data.size();
+}
+
+void RewindBuffer::PageDelta::Clear()
+{
+    m_pages.clear();
+    m_undoData.clear();
+}
+
+size_t RewindBuffer::PageDelta::GetSize() const
+{
+    return m_pages.size() * sizeof(uint32_t) + m_undoData.size();
+}
+
+size_t RewindBuffer::Snapshot::GetSize() const
+{
+    return m_state.size() + m_ram.GetSize() + m_vram.GetSize();
+}
+
+// Bring <shadow> up to date with <memory>, keeping the pages it had in <delta> if any.
+// The shadow still matches the memory outside of the pages written once the history is emptied.
+// Pages written with the same content don't need to be undone.
+template <typename TMemory>
+void RewindBuffer::CaptureMemory(TMemory& memory, Shadow& shadow, PageDelta* delta)
+{
+    constexpr uint32_t PAGE_SIZE = TMemory::DIRTY_PAGE_SIZE;
+    const uint32_t pageCount = memory.GetPageCount();
+
+    if (shadow.m_data.empty())
+    {
+        shadow.m_data.assign(memory.GetData(), memory.GetData() + pageCount * PAGE_SIZE);
+    }
+    else
+    {
+        for (uint32_t page = 0; page < pageCount; ++page)
+        {
+            uint8_t* shadowPage = shadow.m_data.data() + page * PAGE_SIZE;
+            const uint8_t* currentPage = memory.GetData() + page * PAGE_SIZE;
+
+            if (memory.IsPageWrittenSince(page, shadow.m_epoch) && std::memcmp(shadowPage, currentPage, PAGE_SIZE) != 0)
+            {
+                if (delta != nullptr)
+                {
+                    delta->m_pages.push_back(page);
+                    delta->m_undoData.insert(delta->m_undoData.end(), shadowPage, shadowPage + PAGE_SIZE);
+                }
+                std::memcpy(shadowPage, currentPage, PAGE_SIZE);
+            }
+        }
+    }
+
+    shadow.m_epoch = memory.StartWriteEpoch();
+}
+
+// Undo the writes since the shadow was last brought up to date.
+// Restoring a RAM page invalidates the code decoded from it.
+template <typename TMemory>
+void RewindBuffer::RestoreMemory(TMemory& memory, Shadow& shadow)
+{
+    constexpr uint32_t PAGE_SIZE = TMemory::DIRTY_PAGE_SIZE;
+
+    for (uint32_t page = 0; page < memory.GetPageCount(); ++page)
+    {
+        const uint8_t* shadowPage = shadow.m_data.data() + page * PAGE_SIZE;
+
+        if (memory.IsPageWrittenSince(page, shadow.m_epoch) &&
+            std::memcmp(shadowPage, memory.GetData() + page * PAGE_SIZE, PAGE_SIZE) != 0)
+        {
+            memory.WritePage(page, shadowPage);
+        }
+    }
+
+    shadow.m_epoch = memory.StartWriteEpoch();
+}
+
+// The shadow goes back to the previous snapshot: the pages it undoes now differ from the memory
+template <typename TMemory>
+void RewindBuffer::UndoMemory(TMemory& memory, Shadow& shadow, const PageDelta& delta)
+{
+    constexpr uint32_t PAGE_SIZE = TMemory::DIRTY_PAGE_SIZE;
+
+    for (size_t iPage = 0; iPage < delta.m_pages.size(); ++iPage)
+    {
+        const uint32_t page = delta.m_pages[iPage];
+        std::memcpy(shadow.m_data.data() + page * PAGE_SIZE, delta.m_undoData.data() + iPage * PAGE_SIZE, PAGE_SIZE);
+        memory.MarkPageWritten(page);
+    }
+}
+
+// <index> counts from the oldest snapshot
+RewindBuffer::Snapshot& RewindBuffer::GetSnapshot(size_t index)
+{
+    return m_snapshots[(m_first + index) % m_snapshots.size()];
+}
+
+void RewindBuffer::DropOldest()
+{
+    m_usedBytes -= GetSnapshot(0).GetSize();
+    m_first = (m_first + 1) % m_snapshots.size();
+    --m_count;
+
+    // The oldest snapshot can't be undone any further
+    if (m_count > 0)
+    {
+        Snapshot& oldest = GetSnapshot(0);
+        m_usedBytes -= oldest.GetSize();
+        oldest.m_ram.Clear();
+        oldest.m_vram.Clear();
+        m_usedBytes += oldest.GetSize();
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace PSEmu
+{
+
+class R3000A;
+
+// History of the machine kept as a ring of snapshots, e.g. one per frame, to step back in time.
+// A snapshot holds the state of the CPU and devices without the memories, plus the previous
+// content of the RAM and VRAM pages written since the snapshot before it: applying those pages
+// undoes the writes. The memories are only copied whole by the first capture.
+class RewindBuffer
+{
+public:
+    // Keeps up to <capacity> snapshots, dropping the oldest ones beyond <maxBytes>
+    RewindBuffer(size_t capacity, size_t maxBytes);
+
+    // It should not be possible to copy an instance of this class
+    RewindBuffer(const RewindBuffer&) = delete;
+    RewindBuffer& operator=(const RewindBuffer&) = delete;
+
+    // But it should be possible to move it
+    RewindBuffer(RewindBuffer&&) = default;
+    RewindBuffer& operator=(RewindBuffer&&) = default;
+
+public:
+    void Capture(R3000A& cpu);
+
+    // Restore the most recent snapshot and remove it from the history.
+    // Returns false when the history is empty.
+    bool Rewind(R3000A& cpu);
+
+    void Clear();
+
+    size_t GetCount() const;
+    size_t GetMemoryUsage() const;
+
+private:
+    // Pages of a memory which changed since the previous snapshot
+    struct PageDelta
+    {
+        std::vector<uint32_t> m_pages;
+        std::vector<uint8_t> m_undoData;    /**< Content of these pages at the previous snapshot */
+
+        void Clear();
+        size_t GetSize() const;
+    };
+
+    struct Snapshot
+    {
+        std::vector<uint8_t> m_state;       /**< CPU and devices, without the memories */
+        PageDelta m_ram;
+        PageDelta m_vram;
+
+        size_t GetSize() const;
+    };
+
+    // Copy of a memory at the most recent snapshot, or the last one rewound to
+    struct Shadow
+    {
+        std::vector<uint8_t> m_data;
+        uint64_t m_epoch = 0;               /**< Write epoch of the memory started with the copy */
+    };
+
+private:
+    template <typename TMemory>
+    static void CaptureMemory(TMemory& memory, Shadow& shadow, PageDelta* delta);
+
+    template <typename TMemory>
+    static void RestoreMemory(TMemory& memory, Shadow& shadow);
+
+    template <typename TMemory>
+    static void UndoMemory(TMemory& memory, Shadow& shadow, const PageDelta& delta);
+
+    Snapshot& GetSnapshot(size_t index);
+    void DropOldest();
+
+private:
+    std::vector<Snapshot> m_snapshots;  /**< Ring buffer. Dropped snapshots keep their buffers for reuse */
+    size_t m_first;                     /**< Index of the oldest snapshot */
+    size_t m_count;
+    size_t m_maxBytes;
+    size_t m_usedBytes;
+
+    Shadow m_ramShadow;
+    Shadow m_vramShadow;
+};
+
+}   // end namespace PSEmu
+
+#endif // REWIND_H
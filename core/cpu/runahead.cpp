@@ -0,0 +1,50 @@
+#include "runahead.h"
+
+#include "r3000a.h"
+
+#include <limits>
+
+using namespace PSEmu;
+
+// A single snapshot is ever kept: it doesn't need a budget
+RunAhead::RunAhead(uint32_t frames) : m_frames{ frames }, m_checkpoint{ 1, std::numeric_limits<size_t>::max() } { }
+
+void RunAhead::RunFrame(R3000A& cpu)
+{
+    if (m_frames == 0)
+    {
+        RunSingleFrame(cpu);
+        return;
+    }
+
+    // The real frame is replaced by the one ahead
+    cpu.SetOutputEnabled(false);
+    RunSingleFrame(cpu);
+    m_checkpoint.Capture(cpu);
+
+    for (uint32_t iFrame = 1; iFrame < m_frames; ++iFrame)
+    {
+        RunSingleFrame(cpu);
+    }
+
+    cpu.SetOutputEnabled(true);
+    RunSingleFrame(cpu);
+
+    m_checkpoint.Rewind(cpu);
+}
+
+uint32_t RunAhead::GetFrames() const
+{
+    return m_frames;
+}
+
+void RunAhead::RunSingleFrame(R3000A& cpu)
+{
+    GPU& gpu = cpu.GetInterconnect().GetGPU();
+
+    const uint64_t endFrame = gpu.GetFrameCount() + 1;
+    while (gpu.GetFrameCount() < endFrame)
+    {
+        cpu.Run(gpu.GetCyclesPerFrame());
+    }
+}
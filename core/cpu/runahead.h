@@ -0,0 +1,37 @@
+#ifndef RUN_AHEAD_H
+#define RUN_AHEAD_H
+
+#include "rewind.h"
+
+#include <cstdint>
+
+namespace PSEmu
+{
+
+class R3000A;
+
+// Hides the frames of lag games have between reading the input and showing its effect.
+// Each frame is emulated for real without output, then the machine runs ahead with the
+// same input and only the last frame ahead is output before going back to the real one.
+class RunAhead
+{
+public:
+    explicit RunAhead(uint32_t frames);
+
+public:
+    // Emulate one frame and output the one <frames> later
+    void RunFrame(R3000A& cpu);
+
+    uint32_t GetFrames() const;
+
+private:
+    static void RunSingleFrame(R3000A& cpu);
+
+private:
+    uint32_t m_frames;
+    RewindBuffer m_checkpoint;  /**< Real frame to go back to */
+};
+
+}   // end namespace PSEmu
+
+#endif // RUN_AHEAD_H
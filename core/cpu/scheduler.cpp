@@ -0,0 +1,172 @@
+#include "scheduler.h"
+
+#include <algorithm>
+#include <cassert>
+
+using namespace PSEmu;
+
+namespace
+{
+
+size_t ToIndex(EventType type)
+{
+    return static_cast<size_t>(type);
+}
+
+}   // end anonymous namespace
+
+Scheduler::Scheduler() 
+    : m_cycles{ 0 }, m_nextDeadline{ NO_DEADLINE }, m_events{}, 
+      m_activeSequences{}, m_nextSequence{ 1 }, m_handlers{} { }
+
+void Scheduler::SetHandler(EventType type, EventHandler handler)
+{
+    m_handlers[ToIndex(type)] = std::move(handler);
+}
+
+// Schedule <type> <delay> cycles from now, replacing any previous deadline
+void Scheduler::Schedule(EventType type, uint64_t delay)
+{
+    ScheduleAt(type, m_cycles + delay);
+}
+
+// Schedule <type> at the absolute <cycle>, replacing any previous deadline
+void Scheduler::ScheduleAt(EventType type, uint64_t cycle)
+{
+    const uint64_t sequence = m_nextSequence++;
+    m_activeSequences[ToIndex(type)] = sequence;
+
+    m_events.push_back({cycle, sequence, type});
+    std::push_heap(m_events.begin(), m_events.end(), IsLater);
+
+    m_nextDeadline = std::min(m_nextDeadline, cycle);
+}
+
+void Scheduler::Cancel(EventType type)
+{
+    // The stale entry is dropped from the heap when it reaches the front
+    m_activeSequences[ToIndex(type)] = 0;
+}
+
+bool Scheduler::IsScheduled(EventType type) const
+{
+    return m_activeSequences[ToIndex(type)] != 0;
+}
+
+// Call the handlers of all the events whose deadline is reached.
+// Handlers are free to schedule events, including the one being handled.
+void Scheduler::RunEvents()
+{
+    while (!m_events.empty() && m_events.front().m_cycle <= m_cycles)
+    {
+        std::pop_heap(m_events.begin(), m_events.end(), IsLater);
+        const Event event = m_events.back();
+        m_events.pop_back();
+
+        uint64_t& activeSequence = m_activeSequences[ToIndex(event.m_type)];
+        if (activeSequence != event.m_sequence)
+        {
+            continue;
+        }
+
+        activeSequence = 0;
+
+        const EventHandler& handler = m_handlers[ToIndex(event.m_type)];
+        assert(handler && "No handler registered for event");
+        handler(event.m_cycle);
+    }
+
+    UpdateNextDeadline();
+}
+
+void Scheduler::Reset()
+{
+    m_cycles = 0;
+    m_events.clear();
+    m_activeSequences.fill(0);
+    m_nextDeadline = NO_DEADLINE;
+}
+
+void Scheduler::Save(Utils::StateWriter& writer) const
+{
+    writer.Write(m_cycles);
+    writer.Write(m_nextDeadline);
+
+    writer.Write(static_cast<uint32_t>(m_events.size()));
+    for (const Event& event : m_events)
+    {
+        writer.Write(event.m_cycle);
+        writer.Write(event.m_sequence);
+        writer.Write(event.m_type);
+    }
+
+    for (uint64_t sequence : m_activeSequences)
+    {
+        writer.Write(sequence);
+    }
+    writer.Write(m_nextSequence);
+}
+
+void Scheduler::Load(Utils::StateReader& reader)
+{
+    reader.Read(m_cycles);
+    reader.Read(m_nextDeadline);
+
+    // Stale entries are kept: the heap is restored as it was.
+    // A count larger than what's left of the state can only come from a corrupted one.
+    constexpr size_t EVENT_STATE_SIZE = sizeof(Event::m_cycle) + sizeof(Event::m_sequence) + sizeof(Event::m_type);
+    const uint32_t eventCount = reader.Read<uint32_t>();
+    m_events.clear();
+    if (eventCount > reader.GetRemainingSize() / EVENT_STATE_SIZE)
+    {
+        reader.Fail();
+    }
+    else
+    {
+        m_events.resize(eventCount);
+    }
+
+    for (Event& event : m_events)
+    {
+        reader.Read(event.m_cycle);
+        reader.Read(event.m_sequence);
+        reader.Read(event.m_type);
+
+        // The type indexes the handlers
+        if (ToIndex(event.m_type) >= ToIndex(EventType::COUNT))
+        {
+            reader.Fail();
+            m_events.clear();
+            break;
+        }
+    }
+
+    for (uint64_t& sequence : m_activeSequences)
+    {
+        reader.Read(sequence);
+    }
+    reader.Read(m_nextSequence);
+}
+
+bool Scheduler::IsLater(const Event& lhs, const Event& rhs)
+{
+    if (lhs.m_cycle != rhs.m_cycle)
+    {
+        return lhs.m_cycle > rhs.m_cycle;
+    }
+
+    return lhs.m_sequence > rhs.m_sequence;
+}
+
+void Scheduler::UpdateNextDeadline()
+{
+    // Drop the stale entries at the front so that they don't trigger needless calls to RunEvents
+    while (!m_events.empty() && 
+           m_activeSequences[ToIndex(m_events.front().m_type)] != m_events.front().m_sequence)
+    {
+        std::pop_heap(m_events.begin(), m_events.end(), IsLater);
+        m_events.pop_back();
+    }
+
+    m_nextDeadline = m_events.empty() ? NO_DEADLINE : m_events.front().m_cycle;
+}
@@ -0,0 +1,109 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "../utils/state.h"
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+namespace PSEmu
+{
+
+// Things happening at a given point in time, independently of the instructions executed by the CPU.
+// Each type of event is either scheduled once or not at all.
+enum class EventType
+{
+    VBLANK,         // The GPU reached the end of a frame
+    DMA_COMPLETE,   // A DMA channel finished its transfer
+    TIMER_0,        // Root counter 0 reached its target or 0xFFFF
+    TIMER_1,        // Root counter 1 reached its target or 0xFFFF
+    TIMER_2,        // Root counter 2 reached its target or 0xFFFF
+    INTERRUPT,      // The interrupt line to the CPU went up or the CPU started accepting interrupts
+    COUNT
+};
+
+// Keeps track of the time elapsed in CPU cycles and calls the handler of
+// each event when its deadline is reached. Devices schedule their events
+// instead of being polled after every instruction: the only per instruction
+// cost is a comparison against the nearest deadline.
+class Scheduler
+{
+public:
+    // Called with the cycle at which the event was scheduled, 
+    // which may be a little earlier than the current cycle
+    using EventHandler = std::function<void(uint64_t)>;
+
+    static constexpr uint64_t NO_DEADLINE = std::numeric_limits<uint64_t>::max();
+
+public:
+    Scheduler();
+
+    // It should not be possible to copy an instance of this class
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // But it should be possible to move it
+    Scheduler(Scheduler&&) = default;
+    Scheduler& operator=(Scheduler&&) = default;
+
+public:
+    void SetHandler(EventType type, EventHandler handler);
+
+    void Schedule(EventType type, uint64_t delay);
+    void ScheduleAt(EventType type, uint64_t cycle);
+    void Cancel(EventType type);
+    bool IsScheduled(EventType type) const;
+
+    void RunEvents();
+    void Reset();
+
+    // Handlers aren't part of the state: they're set once by the devices
+    void Save(Utils::StateWriter& writer) const;
+    void Load(Utils::StateReader& reader);
+
+public:
+    uint64_t GetCycles() const { return m_cycles; }
+    void AddCycles(uint32_t cycles) { m_cycles += cycles; }
+    void SkipTo(uint64_t cycle) { m_cycles = cycle > m_cycles ? cycle : m_cycles; }
+
+    uint64_t GetNextDeadline() const { return m_nextDeadline; }
+    bool IsEventPending() const { return m_cycles >= m_nextDeadline; }
+
+private:
+    struct Event
+    {
+        uint64_t m_cycle;
+        uint64_t m_sequence;    /**< Keeps events due at the same cycle in scheduling order */
+        EventType m_type;
+    };
+
+    // Order for std::push_heap/std::pop_heap: the earliest event ends up at the front
+    static bool IsLater(const Event& lhs, const Event& rhs);
+
+    void UpdateNextDeadline();
+
+private:
+    // Absolute time in CPU cycles since the last reset
+    uint64_t m_cycles;
+
+    // Deadline of the earliest event in the heap. Might belong to a canceled event.
+    uint64_t m_nextDeadline;
+
+    // Min-heap of scheduled events. Rescheduled and canceled events 
+    // are left in the heap and skipped when they reach the front.
+    std::vector<Event> m_events;
+
+    // Sequence of the valid entry for each type of event, 0 if it isn't scheduled
+    std::array<uint64_t, static_cast<size_t>(EventType::COUNT)> m_activeSequences;
+
+    uint64_t m_nextSequence;
+
+    std::array<EventHandler, static_cast<size_t>(EventType::COUNT)> m_handlers;
+};
+
+}   // end namespace PSEmu
+
+#endif // SCHEDULER_H
@@ -27,6 +27,11 @@ void Debugger::DeleteBreakpoint(uint32_t address)
     }
 }
 
+bool Debugger::HasBreakpoints() const
+{
+    return !m_breakpoints.empty();
+}
+
 // Add a breakpoint that will trigger when the CPU attempts to read from <address>
 void Debugger::AddReadWatch(uint32_t address)
 {
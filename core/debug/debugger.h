@@ -14,6 +14,7 @@ class Debugger
 public:
     void AddBreakpoint(uint32_t address);
     void DeleteBreakpoint(uint32_t address);
+    bool HasBreakpoints() const;
 
     void AddReadWatch(uint32_t address);
     void DeleteReadWatch(uint32_t address);
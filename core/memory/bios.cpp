@@ -1,34 +1,296 @@
 #include "bios.h"
 
+#include "memorymap.h"
+#include "../utils/hash.h"
+
 #include <cassert>
+#include <cstring>
 #include <fstream>
 #include <iterator>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PSEMU_HAS_MMAP
+#endif
 
 using namespace PSEmu;
 
-BIOS::BIOS() = default;
+class BIOS::Image
+{
+public:
+    // Image copied in memory
+    explicit Image(std::vector<uint8_t> data) 
+        : m_buffer{ std::move(data) }, m_file{ -1 }, m_mapping{ nullptr }, m_data{ m_buffer.data() }, m_size{ m_buffer.size() }, m_hash{ 0 } { }
+
+    // Image mapped from <file>, unmapped and closed on destruction.
+    // The file stays open so that it can be mapped again (see FastMem).
+    Image(int file, void* mapping, size_t size) 
+        : m_buffer{}, m_file{ file }, m_mapping{ mapping }, m_data{ static_cast<const uint8_t*>(mapping) }, m_size{ size }, m_hash{ 0 } { }
 
-bool BIOS::Init(const std::string& absoluteFilePath)
+    ~Image()
+    {
+#if defined(PSEMU_HAS_MMAP)
+        if (m_mapping != nullptr)
+        {
+            munmap(m_mapping, m_size);
+        }
+
+        if (m_file != -1)
+        {
+            close(m_file);
+        }
+#endif
+    }
+
+    // It should not be possible to copy or move this class
+    Image(const Image&) = delete;
+    Image& operator=(const Image&) = delete;
+
+    Image(Image&&) = delete;
+    Image& operator=(Image&&) = delete;
+
+public:
+    const uint8_t* GetData() const { return m_data; }
+    size_t GetSize() const { return m_size; }
+    int GetFile() const { return m_file; }
+
+    uint64_t GetHash() const { return m_hash; }
+    void SetHash(uint64_t hash) { m_hash = hash; }
+
+private:
+    std::vector<uint8_t> m_buffer;
+    int m_file;
+    void* m_mapping;
+
+    const uint8_t* m_data;
+    size_t m_size;
+
+    uint64_t m_hash;
+};
+
+namespace
+{
+
+// Identifies the content of a file without reading it: device, inode, size and modification time
+using FileKey = std::tuple<uint64_t, uint64_t, uint64_t, int64_t, int64_t>;
+
+// Images currently loaded in the process and hashes of the files this process has seen so far.
+// Within the process, a file which didn't change since it was hashed isn't hashed again;
+// nothing is kept across runs, so the first load of each file always hashes it.
+struct ImageRegistry
+{
+    std::mutex m_mutex;
+    std::map<FileKey, std::weak_ptr<const BIOS::Image>> m_images;
+    std::map<FileKey, uint64_t> m_hashes;
+};
+
+ImageRegistry& GetRegistry()
+{
+    static ImageRegistry registry;
+    return registry;
+}
+
+#if defined(PSEMU_HAS_MMAP)
+
+std::shared_ptr<const BIOS::Image> MapImage(const std::string& absoluteFilePath)
 {
-    std::ifstream biosStream{ absoluteFilePath };
+    const int fd = open(absoluteFilePath.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        return nullptr;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || static_cast<uint64_t>(fileStat.st_size) != BIOS_SIZE)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+#if defined(__APPLE__)
+    const auto& modificationTime = fileStat.st_mtimespec;
+#else
+    const auto& modificationTime = fileStat.st_mtim;
+#endif
+
+    const FileKey key{ fileStat.st_dev, fileStat.st_ino, fileStat.st_size, 
+                       modificationTime.tv_sec, modificationTime.tv_nsec };
+
+    ImageRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock{ registry.m_mutex };
+
+    auto imageIt = registry.m_images.find(key);
+    if (imageIt != registry.m_images.end())
+    {
+        if (auto image = imageIt->second.lock())
+        {
+            close(fd);
+            return image;
+        }
+    }
 
-    if(biosStream)
+    void* mapping = mmap(nullptr, BIOS_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED)
     {
-        m_data.assign(std::istreambuf_iterator<char>{biosStream},
-                      std::istreambuf_iterator<char>{});
+        close(fd);
+        return nullptr;
+    }
+
+    auto image = std::make_shared<BIOS::Image>(fd, mapping, BIOS_SIZE);
 
-        return true;
+    auto hashIt = registry.m_hashes.find(key);
+    if (hashIt != registry.m_hashes.end())
+    {
+        image->SetHash(hashIt->second);
     }
+    else
+    {
+        const uint64_t hash = Utils::HashFNV1a(image->GetData(), image->GetSize());
+        image->SetHash(hash);
+        registry.m_hashes.emplace(key, hash);
+    }
+
+    registry.m_images[key] = image;
 
-    return false;
+    return image;
+}
+
+#else
+
+std::shared_ptr<const BIOS::Image> MapImage(const std::string& absoluteFilePath)
+{
+    std::ifstream biosStream{ absoluteFilePath, std::ios::binary };
+    if (!biosStream)
+    {
+        return nullptr;
+    }
+
+    std::vector<uint8_t> data(std::istreambuf_iterator<char>{biosStream},
+                              std::istreambuf_iterator<char>{});
+
+    if (data.size() != BIOS_SIZE)
+    {
+        return nullptr;
+    }
+
+    auto image = std::make_shared<BIOS::Image>(std::move(data));
+    image->SetHash(Utils::HashFNV1a(image->GetData(), image->GetSize()));
+
+    return image;
+}
+
+#endif
+
+// Images built in memory are kept in a memory file where available, so that they can be mapped again like files
+std::shared_ptr<BIOS::Image> CreateImage(std::vector<uint8_t> data)
+{
+#if defined(__linux__)
+    const size_t size = data.size();
+    const int file = (size != 0) ? memfd_create("psemu_bios", 0) : -1;
+    if (file != -1)
+    {
+        void* mapping = (ftruncate(file, size) == 0) ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0) : MAP_FAILED;
+        if (mapping != MAP_FAILED)
+        {
+            std::memcpy(mapping, data.data(), size);
+            if (mprotect(mapping, size, PROT_READ) == 0)
+            {
+                return std::make_shared<BIOS::Image>(file, mapping, size);
+            }
+            munmap(mapping, size);
+        }
+        close(file);
+    }
+#endif
+
+    return std::make_shared<BIOS::Image>(std::move(data));
+}
+
+}   // end anonymous namespace
+
+BIOS::BIOS() : m_image{}, m_data{ nullptr }, m_size{ 0 } { }
+
+// Map the BIOS image stored at <absoluteFilePath>.
+// Instances loading the same unchanged file share a single read-only mapping.
+bool BIOS::Init(const std::string& absoluteFilePath)
+{
+    auto image = MapImage(absoluteFilePath);
+    if (!image)
+    {
+        return false;
+    }
+
+    m_image = std::move(image);
+    m_data = m_image->GetData();
+    m_size = static_cast<uint32_t>(m_image->GetSize());
+
+    return true;
+}
+
+// Use an image built in memory (e.g. for tests or when no BIOS dump is available)
+bool BIOS::Init(std::vector<uint8_t> data)
+{
+    if (data.size() > BIOS_SIZE)
+    {
+        return false;
+    }
+
+    auto image = CreateImage(std::move(data));
+    image->SetHash(Utils::HashFNV1a(image->GetData(), image->GetSize()));
+
+    m_image = std::move(image);
+    m_data = m_image->GetData();
+    m_size = static_cast<uint32_t>(m_image->GetSize());
+
+    return true;
 }
 
 void BIOS::Reset()
 {
-    m_data.clear();
+    m_image.reset();
+    m_data = nullptr;
+    m_size = 0;
+}
+
+const uint8_t* BIOS::GetData() const
+{
+    return m_data;
 }
 
-std::vector<uint8_t>& BIOS::GetData() 
+uint32_t BIOS::GetSize() const
 {
-    return m_data; 
+    return m_size;
+}
+
+// File holding the image, -1 when it isn't backed by one
+int BIOS::GetFile() const
+{
+    return m_image ? m_image->GetFile() : -1;
+}
+
+// Hash of the content of the image, 0 when no image is loaded
+uint64_t BIOS::GetHash() const
+{
+    return m_image ? m_image->GetHash() : 0;
+}
+
+// Copy <size> bytes starting at <offset> to <dst>
+void BIOS::ReadSpan(uint32_t offset, uint8_t* dst, uint32_t size) const
+{
+    // Nothing is mapped when running the HLE kernel without an image
+    if (m_size == 0)
+    {
+        std::memset(dst, 0, size);
+        return;
+    }
+
+    assert(offset <= m_size && size <= (m_size - offset));
+
+    std::memcpy(dst, m_data + offset, size);
 }
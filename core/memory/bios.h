@@ -1,8 +1,11 @@
 #ifndef BIOS_H
 #define BIOS_H
 
+#include "../utils/endian.h"
+
 #include <cassert>
 #include <cstdint>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <vector>
@@ -25,38 +28,47 @@ public:
 
 public:
     bool Init(const std::string& absoluteFilePath);
+    bool Init(std::vector<uint8_t> data);
     void Reset();
 
-    std::vector<uint8_t>& GetData();
+    const uint8_t* GetData() const;
+    uint32_t GetSize() const;
+    int GetFile() const;
+    uint64_t GetHash() const;
 
 public:
     template <typename TSize>
     TSize Load(uint32_t offset) const
     {
         static_assert(std::is_integral_v<TSize>);
+        static_assert((sizeof(TSize) == 1) || (sizeof(TSize) == 2) || (sizeof(TSize) == 4));
 
-        constexpr auto nbByteToLoad = sizeof(TSize);
-
-        // TODO: Replace this assert by having some explicit template instantiations
-        //       for byte, halfword and word?
-        static_assert((nbByteToLoad == 1) || (nbByteToLoad == 2) || (nbByteToLoad == 4));
+        // Accesses are aligned by the CPU so they can't go past the end of the BIOS
+        assert((offset % sizeof(TSize)) == 0);
 
-        TSize value = 0;
-
-        // Don't forget the PSX is a little endian machine!
-        for(int iByte = nbByteToLoad - 1; iByte >= 0; --iByte)
+        // Nothing is mapped when running the HLE kernel without an image
+        if (offset >= m_size)
         {
-            assert((offset + iByte) < m_data.size());
-            value |= static_cast<uint32_t>(m_data[offset + iByte]) << (iByte * 8);
+            return 0;
         }
 
-        return value;
+        return Utils::LoadLittleEndian<TSize>(m_data + offset);
     }
 
+    void ReadSpan(uint32_t offset, uint8_t* dst, uint32_t size) const;
+
+public:
+    // Read-only content of a BIOS, shared by all the instances using the same file
+    class Image;
+
 private:
-    std::vector<uint8_t> m_data;
+    std::shared_ptr<const Image> m_image;
+
+    // Cached from the image to keep loads a single indirection away
+    const uint8_t* m_data;
+    uint32_t m_size;
 };
 
 } // end namespace PSEmu
 
-#endif // BIOS_H
\ No newline at end of file
+#endif // BIOS_H
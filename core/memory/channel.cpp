@@ -4,7 +4,10 @@
 
 using namespace PSEmu;
 
-Channel::Channel() = default;
+Channel::Channel() 
+    : m_enable{ false }, m_direction{ Direction::TO_RAM }, m_step{ Step::INCREMENT }, m_sync{ Sync::MANUAL }, 
+      m_trigger{ false }, m_chop{ false }, m_chopDMASize{ 0 }, m_chopCPUSize{ 0 }, m_unknown{ 0 }, 
+      m_base{ 0 }, m_blockSize{ 0 }, m_blockCount{ 0 } { }
 
 uint32_t Channel::GetControl() const
 {
@@ -134,3 +137,35 @@ std::optional<uint32_t> Channel::GetTransferSize() const
             return std::nullopt;
     }
 }
+
+void Channel::Save(Utils::StateWriter& writer) const
+{
+    writer.Write(m_enable);
+    writer.Write(m_direction);
+    writer.Write(m_step);
+    writer.Write(m_sync);
+    writer.Write(m_trigger);
+    writer.Write(m_chop);
+    writer.Write(m_chopDMASize);
+    writer.Write(m_chopCPUSize);
+    writer.Write(m_unknown);
+    writer.Write(m_base);
+    writer.Write(m_blockSize);
+    writer.Write(m_blockCount);
+}
+
+void Channel::Load(Utils::StateReader& reader)
+{
+    reader.Read(m_enable);
+    reader.Read(m_direction);
+    reader.Read(m_step);
+    reader.Read(m_sync);
+    reader.Read(m_trigger);
+    reader.Read(m_chop);
+    reader.Read(m_chopDMASize);
+    reader.Read(m_chopCPUSize);
+    reader.Read(m_unknown);
+    reader.Read(m_base);
+    reader.Read(m_blockSize);
+    reader.Read(m_blockCount);
+}
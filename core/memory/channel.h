@@ -1,6 +1,8 @@
 #ifndef CHANNEL_H
 #define CHANNEL_H
 
+#include "../utils/state.h"
+
 #include <cstdint>
 #include <optional>
 
@@ -54,6 +56,9 @@ public:
 
     std::optional<uint32_t> GetTransferSize() const;
 
+    void Save(Utils::StateWriter& writer) const;
+    void Load(Utils::StateReader& reader);
+
 private:
     bool m_enable;
     Direction m_direction;
@@ -1,8 +1,11 @@
 #include "dma.h"
 
+#include "../cpu/scheduler.h"
 #include "../video/gpu.h"
+#include "interruptcontroller.h"
 #include "ram.h"
 
+#include <algorithm>
 #include <cassert>
 
 using namespace PSEmu;
@@ -23,10 +26,70 @@ uint32_t PortToIndex(Port port)
 
 }   // end anonymous namespace
 
-DMA::DMA(GPU& gpu, RAM& ram) 
+DMA::DMA() 
     : m_control{ 0x7654321 }, m_IRQEnable{}, m_channelIRQEnable{}, 
       m_channelIRQFlags{}, m_forceIRQ{}, m_dummy{}, m_channels{}, 
-      m_ram{ ram }, m_gpu{ gpu } { }
+      m_completionCycles{}, m_ram{ nullptr }, m_gpu{ nullptr }, m_scheduler{ nullptr }, 
+      m_interruptController{ nullptr }
+{
+    m_completionCycles.fill(Scheduler::NO_DEADLINE);
+}
+
+// Devices are owned by the interconnect, which calls this again whenever they move
+void DMA::Connect(GPU& gpu, RAM& ram, Scheduler& scheduler, InterruptController& interruptController)
+{
+    m_gpu = &gpu;
+    m_ram = &ram;
+    m_scheduler = &scheduler;
+    m_interruptController = &interruptController;
+
+    m_scheduler->SetHandler(EventType::DMA_COMPLETE, [this](uint64_t cycle) { OnTransferComplete(cycle); });
+}
+
+void DMA::Reset()
+{
+    m_control = 0x7654321;
+    m_IRQEnable = false;
+    m_channelIRQEnable = 0;
+    m_channelIRQFlags = 0;
+    m_forceIRQ = false;
+    m_dummy = 0;
+    m_channels = {};
+    m_completionCycles.fill(Scheduler::NO_DEADLINE);
+}
+
+void DMA::Save(Utils::StateWriter& writer) const
+{
+    writer.Write(m_control);
+    writer.Write(m_IRQEnable);
+    writer.Write(m_channelIRQEnable);
+    writer.Write(m_channelIRQFlags);
+    writer.Write(m_forceIRQ);
+    writer.Write(m_dummy);
+
+    for (uint32_t iChannel = 0; iChannel < m_channels.size(); ++iChannel)
+    {
+        m_channels[iChannel].Save(writer);
+        writer.Write(m_completionCycles[iChannel]);
+    }
+}
+
+// The DMA_COMPLETE event is part of the state of the scheduler
+void DMA::Load(Utils::StateReader& reader)
+{
+    reader.Read(m_control);
+    reader.Read(m_IRQEnable);
+    reader.Read(m_channelIRQEnable);
+    reader.Read(m_channelIRQFlags);
+    reader.Read(m_forceIRQ);
+    reader.Read(m_dummy);
+
+    for (uint32_t iChannel = 0; iChannel < m_channels.size(); ++iChannel)
+    {
+        m_channels[iChannel].Load(reader);
+        reader.Read(m_completionCycles[iChannel]);
+    }
+}
 
 uint32_t DMA::RegisterRead(uint32_t offset) const
 {
@@ -35,7 +98,7 @@ uint32_t DMA::RegisterRead(uint32_t offset) const
 
     uint32_t value = 0;
 
-    if(0 < major && major < 7)
+    if (major < 7)
     {
         const Channel& chan = GetChannel(IndexToPort(major));
         switch (minor)
@@ -75,9 +138,10 @@ void DMA::RegisterWrite(uint32_t offset, uint32_t value)
     const uint32_t major = (offset & 0x70) >> 4;
     const uint32_t minor = offset & 0xF;
 
-    if (0 < major && major < 7)
+    if (major < 7)
     {
-        Channel& chan = GetChannel(IndexToPort(major));
+        const Port port = IndexToPort(major);
+        Channel& chan = GetChannel(port);
         switch (minor)
         {
             case 0:
@@ -88,9 +152,13 @@ void DMA::RegisterWrite(uint32_t offset, uint32_t value)
                 break;
             case 8:
                 chan.SetControl(value);
+                if (chan.IsActive())
+                {
+                    StartTransfer(port);
+                }
                 break;
             default:
-                assert(false && "Unhandled DMA read");
+                assert(false && "Unhandled DMA write");
         }
     }
     else if (major == 7)
@@ -105,11 +173,9 @@ void DMA::RegisterWrite(uint32_t offset, uint32_t value)
                 SetInterrupt(value);
                 break;
             default:
-                assert(false && "Unhandled DMA read");    
+                assert(false && "Unhandled DMA write");    
         }
     }
-    
-    assert(false && "Unhandled DMA read");
 }
 
 
@@ -144,6 +210,8 @@ uint32_t DMA::GetInterrupt() const
 
 void DMA::SetInterrupt(uint32_t value)
 {
+    const bool wasActive = GetIRQ();
+
     m_dummy = (value & 0x3F);
     m_forceIRQ = ((value >> 15) & 1) != 0;
     m_channelIRQEnable = ((value >> 16) & 0x7F);
@@ -151,7 +219,9 @@ void DMA::SetInterrupt(uint32_t value)
 
     // Writing 1 to a flag resets it
     const uint8_t ack = (value >> 24) & 0x3F;
-    m_channelIRQFlags &= !ack;
+    m_channelIRQFlags &= ~ack;
+
+    UpdateIRQ(wasActive);
 }
 
 Channel& DMA::GetChannel(Port port)
@@ -164,21 +234,80 @@ const Channel& DMA::GetChannel(Port port) const
     return m_channels[PortToIndex(port)];
 }
 
-void DMA::DoMemoryTransfer(Port port)
+// The data is moved right away but the channel only reports the end 
+// of the transfer once the time it would have taken has elapsed
+void DMA::StartTransfer(Port port)
+{
+    const uint32_t wordCount = DoMemoryTransfer(port);
+
+    // Roughly one word is transferred per cycle
+    m_completionCycles[PortToIndex(port)] = m_scheduler->GetCycles() + wordCount;
+    ScheduleCompletion();
+}
+
+void DMA::OnTransferComplete(uint64_t cycle)
+{
+    const bool wasActive = GetIRQ();
+
+    for (uint32_t iChannel = 0; iChannel < m_channels.size(); ++iChannel)
+    {
+        if (m_completionCycles[iChannel] > cycle)
+        {
+            continue;
+        }
+
+        m_completionCycles[iChannel] = Scheduler::NO_DEADLINE;
+        m_channels[iChannel].SetDone();
+
+        if ((m_channelIRQEnable & (1 << iChannel)) != 0)
+        {
+            m_channelIRQFlags |= (1 << iChannel);
+        }
+    }
+
+    UpdateIRQ(wasActive);
+    ScheduleCompletion();
+}
+
+// Schedule the completion of the channel finishing first, if any
+void DMA::ScheduleCompletion()
+{
+    const uint64_t nextCompletion = *std::min_element(m_completionCycles.cbegin(), m_completionCycles.cend());
+    if (nextCompletion != Scheduler::NO_DEADLINE)
+    {
+        m_scheduler->ScheduleAt(EventType::DMA_COMPLETE, nextCompletion);
+    }
+    else
+    {
+        m_scheduler->Cancel(EventType::DMA_COMPLETE);
+    }
+}
+
+// The interrupt controller is notified on the rising edge of the IRQ signal
+void DMA::UpdateIRQ(bool wasActive)
+{
+    if (!wasActive && GetIRQ())
+    {
+        m_interruptController->Request(Interrupt::DMA);
+    }
+}
+
+// Returns the number of words transferred
+uint32_t DMA::DoMemoryTransfer(Port port)
 {
     const Channel& chan = GetChannel(port);
     
     if (chan.GetSync() == Sync::LINKED_LIST)
     {
-        DoLinkedListCopy(port);
+        return DoLinkedListCopy(port);
     }
     else
     {
-        DoMemoryBlockCopy(port);
+        return DoMemoryBlockCopy(port);
     }
 }
 
-void DMA::DoMemoryBlockCopy(Port port)
+uint32_t DMA::DoMemoryBlockCopy(Port port)
 {
     Channel& chan = GetChannel(port);
 
@@ -189,7 +318,7 @@ void DMA::DoMemoryBlockCopy(Port port)
     if (transferSize == std::nullopt)
     {
         assert(false && "Couldn't figure out DMA block transfer size");
-        return;
+        return 0;
     }
 
     uint32_t remainingSize = *transferSize;
@@ -200,7 +329,17 @@ void DMA::DoMemoryBlockCopy(Port port)
 
         if (chan.GetDirection() == Direction::FROM_RAM)
         {
-            //const uint32_t srcWord = m_ram.LoadWord(curAddr);
+            const uint32_t srcWord = m_ram->Load<uint32_t>(curAddr);
+
+            if (port == Port::GPU)
+            {
+                m_gpu->SetGP0(srcWord);
+            }
+            else
+            {
+                assert(false && "Unhandled DMA destination port");
+                return *transferSize - remainingSize;
+            }
         }
         else    // Direction::TO_RAM
         {
@@ -221,20 +360,20 @@ void DMA::DoMemoryBlockCopy(Port port)
             else
             {
                 assert(false && "Unhandled DMA source port");
-                return;
+                return *transferSize - remainingSize;
             }
             
-            m_ram.Store<uint32_t>(curAddr, srcWord);
+            m_ram->Store<uint32_t>(curAddr, srcWord);
         }
 
         address += increment;
         --remainingSize;
     }
 
-    chan.SetDone();
+    return *transferSize;
 }
 
-void DMA::DoLinkedListCopy(Port port)
+uint32_t DMA::DoLinkedListCopy(Port port)
 {
     Channel& chan = GetChannel(port);
 
@@ -243,39 +382,46 @@ void DMA::DoLinkedListCopy(Port port)
     if (chan.GetDirection() == Direction::TO_RAM)
     {
         assert(false && "Invalid DMA direction for linked list mode");
-        return;
+        return 0;
     }
 
     if (port != Port::GPU)
     {
         assert(false && "Attempted linked list DMA on incorrect port");
-        return;
+        return 0;
     }
 
+    uint32_t wordCount = 0;
+
     for(;;)
     {
         // In linked list mode, each entry starts with a
         // *header* word. The high byte contains the number
         // of words in the *packet* (not counting the header word)
-        uint32_t header = m_ram.Load<uint32_t>(address);
+        const uint32_t header = m_ram->Load<uint32_t>(address & 0x1FFFFC);
+        uint32_t remainingSize = header >> 24;
 
-        while (header & 0x800000)
-        {
-            uint32_t remainingSize = header >> 24;
+        wordCount += remainingSize + 1;
 
-            while (remainingSize > 0)
-            {
-                address = (address + 4) & 0x1FFFFC;
-                const uint32_t command = m_ram.Load<uint32_t>(address);
+        while (remainingSize > 0)
+        {
+            address = (address + 4) & 0x1FFFFC;
+            const uint32_t command = m_ram->Load<uint32_t>(address);
 
-                m_gpu.SetGP0(command);
+            m_gpu->SetGP0(command);
 
-                --remainingSize;
-            }
+            --remainingSize;
+        }
 
-            address = header & 0x1FFFFC;
+        // The end of the list is marked by the 0xFFFFFF address. 
+        // Only bit 23 is checked by the hardware.
+        if ((header & 0x800000) != 0)
+        {
+            break;
         }
+
+        address = header & 0x1FFFFC;
     }
 
-    chan.SetDone();
-}
\ No newline at end of file
+    return wordCount;
+}
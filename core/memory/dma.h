@@ -10,7 +10,9 @@ namespace PSEmu
 {
 
 class GPU;
+class InterruptController;
 class RAM;
+class Scheduler;
 
 enum class Port
 {
@@ -33,7 +35,7 @@ enum class Port
 class DMA
 {
 public:
-    DMA(GPU& gpu, RAM& ram);
+    DMA();
 
     // It should not be possible to copy an instance of this class
     DMA(const DMA&) = delete;
@@ -44,6 +46,12 @@ public:
     DMA& operator=(DMA&&) = default;
 
 public:
+    void Connect(GPU& gpu, RAM& ram, Scheduler& scheduler, InterruptController& interruptController);
+    void Reset();
+
+    void Save(Utils::StateWriter& writer) const;
+    void Load(Utils::StateReader& reader);
+
     uint32_t RegisterRead(uint32_t offset) const;
     void RegisterWrite(uint32_t offset, uint32_t value);
 
@@ -58,9 +66,15 @@ public:
     Channel& GetChannel(Port port);
     const Channel& GetChannel(Port port) const;
 
-    void DoMemoryTransfer(Port port);
-    void DoMemoryBlockCopy(Port port);
-    void DoLinkedListCopy(Port port);
+private:
+    void StartTransfer(Port port);
+    void OnTransferComplete(uint64_t cycle);
+    void ScheduleCompletion();
+    void UpdateIRQ(bool wasActive);
+
+    uint32_t DoMemoryTransfer(Port port);
+    uint32_t DoMemoryBlockCopy(Port port);
+    uint32_t DoLinkedListCopy(Port port);
 
 private:
     // DMA control register
@@ -85,10 +99,14 @@ private:
     // The 7 channel instances
     std::array<Channel, 7> m_channels; 
 
-    RAM& m_ram;
+    // Cycle at which each channel is done with its current transfer
+    std::array<uint64_t, 7> m_completionCycles;
 
-    // 
-    GPU& m_gpu;
+    // Devices the DMA transfers data between. Set by Connect.
+    RAM* m_ram;
+    GPU* m_gpu;
+    Scheduler* m_scheduler;
+    InterruptController* m_interruptController;
 };
 
 }   // end namespace PSEmu
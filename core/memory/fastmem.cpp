@@ -0,0 +1,126 @@
+#include "fastmem.h"
+
+#include "memorymap.h"
+#include "pagetable.h"
+#include "scratchpad.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace PSEmu;
+
+namespace
+{
+
+// Size of the region reserved for the physical address space. Matches what the page table covers.
+constexpr size_t REGION_SIZE = static_cast<size_t>(PageTable::PAGE_COUNT) * PageTable::PAGE_SIZE;
+
+// The RAM is mirrored four times in the first 8MB of the address space
+constexpr uint32_t RAM_MIRROR_COUNT = 4;
+
+}   // end anonymous namespace
+
+std::unique_ptr<FastMem> FastMem::Create(int biosFile, uint32_t biosSize)
+{
+    std::unique_ptr<FastMem> fastMem{ new FastMem };
+    if (!fastMem->Init(biosFile, biosSize))
+    {
+        return nullptr;
+    }
+
+    return fastMem;
+}
+
+FastMem::FastMem() : m_base{ nullptr }, m_ramFile{ -1 } { }
+
+FastMem::~FastMem()
+{
+#if defined(__linux__)
+    if (m_base != nullptr)
+    {
+        munmap(m_base, REGION_SIZE);
+    }
+
+    if (m_ramFile != -1)
+    {
+        close(m_ramFile);
+    }
+#endif
+}
+
+uint8_t* FastMem::GetBase() const
+{
+    return m_base;
+}
+
+uint8_t* FastMem::GetRAM() const
+{
+    return m_base + RAM_ADDRESS;
+}
+
+uint8_t* FastMem::GetScratchpad() const
+{
+    return m_base + SCRATCHPAD_ADDRESS;
+}
+
+bool FastMem::Init(int biosFile, uint32_t biosSize)
+{
+#if defined(__linux__)
+    // Reserve the whole region without backing it with memory:
+    // any access outside of the mappings below will fault
+    void* region = mmap(nullptr, REGION_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (region == MAP_FAILED)
+    {
+        return false;
+    }
+    m_base = static_cast<uint8_t*>(region);
+
+    m_ramFile = memfd_create("psemu_ram", 0);
+    if (m_ramFile == -1 || ftruncate(m_ramFile, RAM_SIZE) != 0)
+    {
+        return false;
+    }
+
+    // All the mirrors share the same pages so a write through
+    // one of them is seen through all the others
+    for (uint32_t iMirror = 0; iMirror < RAM_MIRROR_COUNT; ++iMirror)
+    {
+        void* mirror = mmap(m_base + RAM_ADDRESS + iMirror * RAM_SIZE, RAM_SIZE, PROT_READ | PROT_WRITE, 
+                            MAP_SHARED | MAP_FIXED, m_ramFile, 0);
+        if (mirror == MAP_FAILED)
+        {
+            return false;
+        }
+    }
+
+    void* scratchpad = mmap(m_base + SCRATCHPAD_ADDRESS, Scratchpad::STORAGE_SIZE, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    if (scratchpad == MAP_FAILED)
+    {
+        return false;
+    }
+
+    // The BIOS is a ROM: its pages are the ones of the image, not a copy
+    if (biosSize != 0)
+    {
+        if (biosFile == -1)
+        {
+            return false;
+        }
+
+        void* bios = mmap(m_base + BIOS_ADDRESS, biosSize, PROT_READ, MAP_SHARED | MAP_FIXED, biosFile, 0);
+        if (bios == MAP_FAILED)
+        {
+            return false;
+        }
+    }
+
+    return true;
+#else
+    static_cast<void>(biosFile);
+    static_cast<void>(biosSize);
+    return false;
+#endif
+}
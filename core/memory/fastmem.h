@@ -0,0 +1,54 @@
+#ifndef FASTMEM_H
+#define FASTMEM_H
+
+#include <cstdint>
+#include <memory>
+
+namespace PSEmu
+{
+
+// Host virtual memory region laid out like the PSX physical address space:
+// the host address of any directly accessible guest location is simply
+// GetBase() + physical address. RAM is backed by a single memory file
+// mapped at each of its mirrors, the BIOS file shared by its instances
+// (see BIOS) is mapped read-only and the scratchpad gets a page of its own.
+// Everything else is left inaccessible.
+//
+// The interpreter keeps looking the pages up in the page table, which then points into
+// this region: it has no way to resume a C++ load or store which faulted on an I/O port,
+// so it can't skip the lookup. A recompiler can, by patching the faulting access.
+//
+// Only available on Linux. Create returns nullptr when the region can't be set up,
+// e.g. when the BIOS isn't backed by a file.
+class FastMem
+{
+public:
+    static std::unique_ptr<FastMem> Create(int biosFile, uint32_t biosSize);
+
+    ~FastMem();
+
+    // It should not be possible to copy or move this class
+    FastMem(const FastMem&) = delete;
+    FastMem& operator=(const FastMem&) = delete;
+
+    FastMem(FastMem&&) = delete;
+    FastMem& operator=(FastMem&&) = delete;
+
+public:
+    uint8_t* GetBase() const;
+    uint8_t* GetRAM() const;
+    uint8_t* GetScratchpad() const;
+
+private:
+    FastMem();
+
+    bool Init(int biosFile, uint32_t biosSize);
+
+private:
+    uint8_t* m_base;    /**< Start of the reserved region */
+    int m_ramFile;      /**< Memory file holding the content of the RAM */
+};
+
+}   // end namespace PSEmu
+
+#endif // FASTMEM_H
@@ -0,0 +1,86 @@
+#include "interruptcontroller.h"
+
+#include "../cpu/scheduler.h"
+
+using namespace PSEmu;
+
+namespace
+{
+
+// Only 11 interrupt sources exist
+constexpr uint16_t INTERRUPT_BITS = 0x7FF;
+
+}   // end anonymous namespace
+
+InterruptController::InterruptController() : m_status{ 0 }, m_mask{ 0 }, m_pending{ false }, m_scheduler{ nullptr } { }
+
+// The interconnect owning the controller calls this again whenever it moves
+void InterruptController::Connect(Scheduler& scheduler)
+{
+    m_scheduler = &scheduler;
+}
+
+void InterruptController::Reset()
+{
+    m_status = 0;
+    m_mask = 0;
+    m_pending = false;
+}
+
+void InterruptController::Save(Utils::StateWriter& writer) const
+{
+    writer.Write(m_status);
+    writer.Write(m_mask);
+    writer.Write(m_pending);
+}
+
+// The INTERRUPT event is part of the state of the scheduler:
+// nothing has to be scheduled here
+void InterruptController::Load(Utils::StateReader& reader)
+{
+    reader.Read(m_status);
+    reader.Read(m_mask);
+    reader.Read(m_pending);
+}
+
+void InterruptController::Request(Interrupt interrupt)
+{
+    m_status |= 1 << static_cast<uint32_t>(interrupt);
+    UpdatePending();
+}
+
+uint32_t InterruptController::GetStatus() const
+{
+    return m_status;
+}
+
+// Writing 0 to a bit of I_STAT acknowledges the interrupt, writing 1 leaves it unchanged
+void InterruptController::Acknowledge(uint32_t value)
+{
+    m_status &= value;
+    UpdatePending();
+}
+
+uint32_t InterruptController::GetMask() const
+{
+    return m_mask;
+}
+
+void InterruptController::SetMask(uint32_t value)
+{
+    m_mask = value & INTERRUPT_BITS;
+    UpdatePending();
+}
+
+void InterruptController::UpdatePending()
+{
+    const bool pending = (m_status & m_mask) != 0;
+
+    // Let the CPU check whether it accepts the interrupt once the current instruction completes
+    if (pending && !m_pending)
+    {
+        m_scheduler->Schedule(EventType::INTERRUPT, 0);
+    }
+
+    m_pending = pending;
+}
@@ -0,0 +1,77 @@
+#ifndef INTERRUPT_CONTROLLER_H
+#define INTERRUPT_CONTROLLER_H
+
+#include "../utils/state.h"
+
+#include <cstdint>
+
+namespace PSEmu
+{
+
+class Scheduler;
+
+// Interrupt sources, in the order of their I_STAT/I_MASK bits
+enum class Interrupt
+{
+    VBLANK,
+    GPU,
+    CDROM,
+    DMA,
+    TIMER_0,
+    TIMER_1,
+    TIMER_2,
+    CONTROLLER,
+    SIO,
+    SPU,
+    LIGHTPEN,
+};
+
+// Gathers the interrupt requests of the devices into the single line 
+// connected to the CPU (bit 10 of the COP0 CAUSE register).
+// The state of the line is cached and the CPU is only notified, through an 
+// INTERRUPT event, when it goes up: nothing has to be checked between instructions.
+class InterruptController
+{
+public:
+    InterruptController();
+
+    // It should not be possible to copy an instance of this class
+    InterruptController(const InterruptController&) = delete;
+    InterruptController& operator=(const InterruptController&) = delete;
+
+    // But it should be possible to move it
+    InterruptController(InterruptController&&) = default;
+    InterruptController& operator=(InterruptController&&) = default;
+
+public:
+    void Connect(Scheduler& scheduler);
+    void Reset();
+
+    void Save(Utils::StateWriter& writer) const;
+    void Load(Utils::StateReader& reader);
+
+    void Request(Interrupt interrupt);
+
+    uint32_t GetStatus() const;
+    void Acknowledge(uint32_t value);
+
+    uint32_t GetMask() const;
+    void SetMask(uint32_t value);
+
+    bool IsPending() const { return m_pending; }
+
+private:
+    void UpdatePending();
+
+private:
+    uint16_t m_status;  /**< I_STAT: requested interrupts, cleared by writing 0 */
+    uint16_t m_mask;    /**< I_MASK: interrupts allowed to reach the CPU */
+    bool m_pending;     /**< Cached (m_status & m_mask) != 0 */
+
+    // Set by Connect
+    Scheduler* m_scheduler;
+};
+
+}   // end namespace PSEmu
+
+#endif // INTERRUPT_CONTROLLER_H
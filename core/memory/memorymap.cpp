@@ -7,6 +7,7 @@ const uint32_t BIOS_ADDRESS{0x1FC00000};
 const uint32_t EXPANSION_MAPPING_ADDRESS{0x1F801000};
 const uint32_t RAM_SIZE_ADDRESS{0x1F801060};
 const uint32_t RAM_ADDRESS{0x00000000};
+const uint32_t SCRATCHPAD_ADDRESS{0x1F800000};
 const uint32_t CACHE_CONTROL_ADDRESS{0xFFFE0130};
 const uint32_t SPU_ADDRESS{0x1F801C00};
 const uint32_t EXPANSION_1_ADDRESS{0x1F000000};
@@ -18,10 +19,13 @@ const uint32_t GPU_ADDRESS{0x1F801810};
 
 const uint32_t BIOS_SIZE{512 * 1024};
 const uint32_t RAM_SIZE{2 * 1024 * 1024};
+const uint32_t SCRATCHPAD_SIZE{1024};
 
 const Utils::Range BIOS_RANGE{BIOS_ADDRESS, BIOS_SIZE};
 const Utils::Range MEMCONTROL_RANGE{EXPANSION_MAPPING_ADDRESS, 36};
 const Utils::Range RAM_RANGE{RAM_ADDRESS, RAM_SIZE};
+const Utils::Range RAM_MIRRORS_RANGE{RAM_ADDRESS, 4 * RAM_SIZE}; // The 2MB of RAM are mirrored 4 times
+const Utils::Range SCRATCHPAD_RANGE{SCRATCHPAD_ADDRESS, SCRATCHPAD_SIZE};
 const Utils::Range RAM_SIZE_RANGE{RAM_SIZE_ADDRESS, 4};
 const Utils::Range CACHE_CONTROL_RANGE{CACHE_CONTROL_ADDRESS, 4}; // Ignored for now
 const Utils::Range SPU_RANGE{SPU_ADDRESS, 640};
@@ -29,7 +33,7 @@ const Utils::Range EXPANSION_1_RANGE{EXPANSION_1_ADDRESS, 8 * 1024 * 1024};
 const Utils::Range EXPANSION_2_RANGE{EXPANSION_2_ADDRESS, 66};
 const Utils::Range IRQ_CONTROL_RANGE{IRQ_CONTROL_ADDRESS, 8};
 const Utils::Range TIMERS_RANGE{TIMERS_ADDRESS, 0x80};
-const Utils::Range DMA_RANGE{DMA_ADDRESS, 0x74};
+const Utils::Range DMA_RANGE{DMA_ADDRESS, 0x78};
 const Utils::Range GPU_RANGE{GPU_ADDRESS, 0x8};
 
 const std::array<uint32_t, 8> REGION_MASK{
@@ -43,4 +47,7 @@ const std::array<uint32_t, 8> REGION_MASK{
     0xFFFFFFFF, 0xFFFFFFFF
 };
 
+// The BIOS jumps there to start the shell once the kernel is initialized
+const uint32_t SHELL_ENTRY_ADDRESS{0x80030000};
+
 } // end namespace PSEmu
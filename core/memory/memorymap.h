@@ -12,7 +12,9 @@ namespace PSEmu
 // Reserved addresses
 extern const uint32_t BIOS_ADDRESS;
 extern const uint32_t EXPANSION_MAPPING_ADDRESS;
+extern const uint32_t RAM_ADDRESS;
 extern const uint32_t RAM_SIZE_ADDRESS;
+extern const uint32_t SCRATCHPAD_ADDRESS;
 extern const uint32_t CACHE_CONTROL_ADDRESS;
 extern const uint32_t SPU_ADDRESS;
 extern const uint32_t EXPANSION_1_ADDRESS;
@@ -25,11 +27,14 @@ extern const uint32_t GPU_ADDRESS;
 // Memory segments' sizes
 extern const uint32_t BIOS_SIZE;
 extern const uint32_t RAM_SIZE;
+extern const uint32_t SCRATCHPAD_SIZE;
 
 // Reserved ranges
 extern const Utils::Range BIOS_RANGE;
 extern const Utils::Range MEMCONTROL_RANGE;
 extern const Utils::Range RAM_RANGE;
+extern const Utils::Range RAM_MIRRORS_RANGE;
+extern const Utils::Range SCRATCHPAD_RANGE;
 extern const Utils::Range CACHE_CONTROL_RANGE;
 extern const Utils::Range SPU_RANGE;
 extern const Utils::Range EXPANSION_1_RANGE;
@@ -41,6 +46,7 @@ extern const Utils::Range GPU_RANGE;
 
 // Other
 extern const std::array<uint32_t, 8> REGION_MASK;
+extern const uint32_t SHELL_ENTRY_ADDRESS;
 
 } // end namespace PSEmu
 
@@ -0,0 +1,21 @@
+#include "pagetable.h"
+
+using namespace PSEmu;
+
+PageTable::PageTable() : m_pages(PAGE_COUNT, nullptr) { }
+
+// Map <size> bytes of host memory starting at <hostMemory> to the physical
+// addresses starting at <physAddr>. Only whole pages are mapped, what's left
+// over at the end goes through the slow path.
+void PageTable::Map(uint32_t physAddr, const uint8_t* hostMemory, uint32_t size)
+{
+    for (uint32_t offset = 0; offset + PAGE_SIZE <= size; offset += PAGE_SIZE)
+    {
+        m_pages[(physAddr + offset) / PAGE_SIZE] = hostMemory + offset;
+    }
+}
+
+void PageTable::Clear()
+{
+    m_pages.assign(PAGE_COUNT, nullptr);
+}
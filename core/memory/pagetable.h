@@ -0,0 +1,49 @@
+#ifndef PAGE_TABLE_H
+#define PAGE_TABLE_H
+
+#include <cstdint>
+#include <vector>
+
+namespace PSEmu
+{
+
+// Maps pages of the physical address space directly to host memory.
+// Pages without a mapping (memory mapped I/O, unused regions) must be
+// handled by the caller.
+class PageTable
+{
+public:
+    // Small enough for the scratchpad not to share its page with the I/O ports
+    static constexpr uint32_t PAGE_SIZE = 4 * 1024;
+
+    // Only the first 512MB of the physical address space are covered
+    // since it's where everything except the cache control register lives
+    static constexpr uint32_t PAGE_COUNT = 0x20000000 / PAGE_SIZE;
+
+public:
+    PageTable();
+
+public:
+    void Map(uint32_t physAddr, const uint8_t* hostMemory, uint32_t size);
+    void Clear();
+
+    // Returns the host address backing <physAddr> or nullptr if it isn't directly mapped
+    const uint8_t* GetHostPointer(uint32_t physAddr) const
+    {
+        const uint32_t page = physAddr / PAGE_SIZE;
+        if (page >= PAGE_COUNT || m_pages[page] == nullptr)
+        {
+            return nullptr;
+        }
+
+        return m_pages[page] + (physAddr % PAGE_SIZE);
+    }
+
+private:
+    // Host address of the start of each page. Kept on the heap: the table is 1MB.
+    std::vector<const uint8_t*> m_pages;
+};
+
+}   // end namespace PSEmu
+
+#endif // PAGE_TABLE_H
@@ -0,0 +1,114 @@
+#include "psxexe.h"
+
+#include "memorymap.h"
+#include "ram.h"
+#include "../utils/endian.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace PSEmu;
+
+namespace
+{
+
+constexpr size_t HEADER_SIZE = 0x800;
+constexpr char MAGIC[] = "PS-X EXE";
+
+// Offsets of the header fields
+constexpr size_t INITIAL_PC_OFFSET   = 0x10;
+constexpr size_t INITIAL_GP_OFFSET   = 0x14;
+constexpr size_t DESTINATION_OFFSET  = 0x18;
+constexpr size_t TEXT_SIZE_OFFSET    = 0x1C;
+constexpr size_t BSS_ADDRESS_OFFSET  = 0x28;
+constexpr size_t BSS_SIZE_OFFSET     = 0x2C;
+constexpr size_t STACK_BASE_OFFSET   = 0x30;
+constexpr size_t STACK_OFFSET_OFFSET = 0x34;
+
+// Offset in RAM of a KSEG0/KSEG1/KUSEG address
+uint32_t ToRAMOffset(uint32_t address)
+{
+    return address & 0x1FFFFF;
+}
+
+}   // end anonymous namespace
+
+PsxExe::PsxExe() 
+    : m_initialPC{}, m_initialGP{}, m_destination{}, m_bssAddress{}, m_bssSize{},
+      m_stackBase{}, m_stackOffset{}, m_text{} { }
+
+bool PsxExe::Init(const std::string& absoluteFilePath)
+{
+    std::ifstream exeStream{ absoluteFilePath, std::ios::binary };
+    if (!exeStream)
+    {
+        return false;
+    }
+
+    const std::vector<uint8_t> data(std::istreambuf_iterator<char>{exeStream},
+                                    std::istreambuf_iterator<char>{});
+
+    if (data.size() < HEADER_SIZE || std::memcmp(data.data(), MAGIC, sizeof(MAGIC) - 1) != 0)
+    {
+        return false;
+    }
+
+    const auto readHeader = [&data](size_t offset)
+    {
+        return Utils::LoadLittleEndian<uint32_t>(data.data() + offset);
+    };
+
+    const uint32_t textSize = readHeader(TEXT_SIZE_OFFSET);
+    const uint32_t destination = readHeader(DESTINATION_OFFSET);
+
+    // The text must be in the file and fit in RAM
+    if (textSize > data.size() - HEADER_SIZE || textSize > RAM_SIZE - ToRAMOffset(destination))
+    {
+        return false;
+    }
+
+    const uint32_t bssAddress = readHeader(BSS_ADDRESS_OFFSET);
+    const uint32_t bssSize = readHeader(BSS_SIZE_OFFSET);
+    if (bssSize > RAM_SIZE - ToRAMOffset(bssAddress))
+    {
+        return false;
+    }
+
+    m_initialPC = readHeader(INITIAL_PC_OFFSET);
+    m_initialGP = readHeader(INITIAL_GP_OFFSET);
+    m_destination = destination;
+    m_bssAddress = bssAddress;
+    m_bssSize = bssSize;
+    m_stackBase = readHeader(STACK_BASE_OFFSET);
+    m_stackOffset = readHeader(STACK_OFFSET_OFFSET);
+    m_text.assign(data.cbegin() + HEADER_SIZE, data.cbegin() + HEADER_SIZE + textSize);
+
+    return true;
+}
+
+uint32_t PsxExe::GetInitialPC() const
+{
+    return m_initialPC;
+}
+
+uint32_t PsxExe::GetInitialGP() const
+{
+    return m_initialGP;
+}
+
+uint32_t PsxExe::GetInitialSP() const
+{
+    return m_stackBase + m_stackOffset;
+}
+
+void PsxExe::CopyTo(RAM& ram) const
+{
+    ram.WriteSpan(ToRAMOffset(m_destination), m_text.data(), static_cast<uint32_t>(m_text.size()));
+
+    if (m_bssSize != 0)
+    {
+        const std::vector<uint8_t> zeroes(m_bssSize, 0);
+        ram.WriteSpan(ToRAMOffset(m_bssAddress), zeroes.data(), m_bssSize);
+    }
+}
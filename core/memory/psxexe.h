@@ -0,0 +1,51 @@
+#ifndef PSX_EXE_H
+#define PSX_EXE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PSEmu
+{
+
+class RAM;
+
+// PS-X EXE executable: a 2KB header followed by the code and data 
+// to copy in RAM before jumping to the entry point
+class PsxExe
+{
+public:
+    PsxExe();
+
+    // It should not be possible to copy an instance of this class
+    PsxExe(const PsxExe&) = delete;
+    PsxExe& operator=(const PsxExe&) = delete;
+
+    // But it should be possible to move it
+    PsxExe(PsxExe&&) = default;
+    PsxExe& operator=(PsxExe&&) = default;
+
+public:
+    bool Init(const std::string& absoluteFilePath);
+
+    uint32_t GetInitialPC() const;
+    uint32_t GetInitialGP() const;
+    uint32_t GetInitialSP() const;
+
+    void CopyTo(RAM& ram) const;
+
+private:
+    uint32_t m_initialPC;
+    uint32_t m_initialGP;
+    uint32_t m_destination;     /**< Address of the text in RAM */
+    uint32_t m_bssAddress;      /**< Address of the memory to fill with zeroes */
+    uint32_t m_bssSize;
+    uint32_t m_stackBase;       /**< Initial SP and FP. 0 if the current value should be kept */
+    uint32_t m_stackOffset;
+
+    std::vector<uint8_t> m_text;
+};
+
+}   // end namespace PSEmu
+
+#endif // PSX_EXE_H
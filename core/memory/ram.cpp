@@ -3,8 +3,122 @@
 #include "memorymap.h"
 
 #include <cassert>
+#include <cstring>
 
 using namespace PSEmu;
 
+namespace
+{
+
 // RAM contains garbage by default
-RAM::RAM() : m_data(RAM_SIZE, 0xCA) { }
+constexpr uint8_t GARBAGE = 0xCA;
+
+}   // end anonymous namespace
+
+RAM::RAM() 
+    : m_storage(RAM_SIZE, GARBAGE), m_data{ m_storage.data() }, m_codePages(RAM_SIZE / CODE_PAGE_SIZE, false), 
+      m_pageWriteEpochs(RAM_SIZE / DIRTY_PAGE_SIZE, 0), m_writeEpoch{ 0 } { }
+
+// Use the RAM_SIZE bytes at <storage> instead of allocating memory.
+// The storage must outlive this instance.
+RAM::RAM(uint8_t* storage) 
+    : m_storage{}, m_data{ storage }, m_codePages(RAM_SIZE / CODE_PAGE_SIZE, false), m_pageWriteEpochs(RAM_SIZE / DIRTY_PAGE_SIZE, 0), m_writeEpoch{ 0 }
+{
+    std::memset(m_data, GARBAGE, RAM_SIZE);
+}
+
+const uint8_t* RAM::GetData() const
+{
+    return m_data;
+}
+
+// Start tracking writes to the page containing <offset>
+void RAM::MarkCodePage(uint32_t offset)
+{
+    m_codePages[offset / CODE_PAGE_SIZE] = true;
+}
+
+void RAM::SetCodeWriteHandler(CodeWriteHandler handler)
+{
+    m_codeWriteHandler = std::move(handler);
+}
+
+// Writes from now on are told apart from the earlier ones
+uint64_t RAM::StartWriteEpoch()
+{
+    return ++m_writeEpoch;
+}
+
+uint32_t RAM::GetPageCount() const
+{
+    return RAM_SIZE / DIRTY_PAGE_SIZE;
+}
+
+// Replace the content of <page> by DIRTY_PAGE_SIZE bytes from <src>
+void RAM::WritePage(uint32_t page, const uint8_t* src)
+{
+    WriteSpan(page * DIRTY_PAGE_SIZE, src, DIRTY_PAGE_SIZE);
+}
+
+// Copy <size> bytes starting at <offset> to <dst>
+void RAM::ReadSpan(uint32_t offset, uint8_t* dst, uint32_t size) const
+{
+    assert(offset <= RAM_SIZE && size <= (RAM_SIZE - offset));
+
+    std::memcpy(dst, m_data + offset, size);
+}
+
+// Copy <size> bytes from <src> to the RAM starting at <offset>
+void RAM::WriteSpan(uint32_t offset, const uint8_t* src, uint32_t size)
+{
+    assert(offset <= RAM_SIZE && size <= (RAM_SIZE - offset));
+
+    if (size == 0)
+    {
+        return;
+    }
+
+    std::memcpy(m_data + offset, src, size);
+
+    const uint32_t lastDirtyPage = (offset + size - 1) / DIRTY_PAGE_SIZE;
+    for (uint32_t page = offset / DIRTY_PAGE_SIZE; page <= lastDirtyPage; ++page)
+    {
+        m_pageWriteEpochs[page] = m_writeEpoch;
+    }
+
+    const uint32_t lastPage = (offset + size - 1) / CODE_PAGE_SIZE;
+    for (uint32_t page = offset / CODE_PAGE_SIZE; page <= lastPage; ++page)
+    {
+        if (m_codePages[page])
+        {
+            InvalidateCodePage(page);
+        }
+    }
+}
+
+// The content is written and read back in one go
+void RAM::Save(Utils::StateWriter& writer) const
+{
+    writer.WriteBytes(m_data, RAM_SIZE);
+}
+
+void RAM::Load(Utils::StateReader& reader)
+{
+    reader.ReadBytes(m_data, RAM_SIZE);
+    m_pageWriteEpochs.assign(RAM_SIZE / DIRTY_PAGE_SIZE, m_writeEpoch);
+
+    // All the code decoded so far might have changed
+    for (uint32_t page = 0; page < m_codePages.size(); ++page)
+    {
+        if (m_codePages[page])
+        {
+            InvalidateCodePage(page);
+        }
+    }
+}
+
+void RAM::InvalidateCodePage(uint32_t page)
+{
+    m_codePages[page] = false;
+    m_codeWriteHandler(page * CODE_PAGE_SIZE);
+}
@@ -1,8 +1,13 @@
 #ifndef RAM_H
 #define RAM_H
 
+#include "memorymap.h"
+#include "../utils/endian.h"
+#include "../utils/state.h"
+
 #include <cassert>
 #include <cstdint>
+#include <functional>
 #include <vector>
 
 namespace PSEmu
@@ -10,8 +15,19 @@ namespace PSEmu
 
 class RAM
 {
+public:
+    // Granularity at which writes to memory holding code are tracked
+    static constexpr uint32_t CODE_PAGE_SIZE = 4 * 1024;
+
+    // Granularity at which writes are tracked between two snapshots
+    static constexpr uint32_t DIRTY_PAGE_SIZE = 4 * 1024;
+
+    // Called with the offset of the page when a code page gets written to
+    using CodeWriteHandler = std::function<void(uint32_t)>;
+
 public:
     RAM();
+    explicit RAM(uint8_t* storage);
 
     // It should not be possible to copy an instance of this class
     RAM(const RAM&) = delete;
@@ -21,51 +37,80 @@ public:
     RAM(RAM&&) = default;
     RAM& operator=(RAM&&) = default;
 
+public:
+    const uint8_t* GetData() const;
+
+    void MarkCodePage(uint32_t offset);
+    void SetCodeWriteHandler(CodeWriteHandler handler);
+
+    // Each page remembers the epoch in which it was last written, so that several users 
+    // (rewind, run-ahead) can each find the pages written since the epoch they started
+    uint64_t StartWriteEpoch();
+    bool IsPageWrittenSince(uint32_t page, uint64_t epoch) const { return m_pageWriteEpochs[page] >= epoch; }
+    void MarkPageWritten(uint32_t page) { m_pageWriteEpochs[page] = m_writeEpoch; }
+
+    uint32_t GetPageCount() const;
+    void WritePage(uint32_t page, const uint8_t* src);
+
 public:
     template <typename TSize>
     TSize Load(uint32_t offset) const
     {
         static_assert(std::is_integral_v<TSize>);
+        static_assert((sizeof(TSize) == 1) || (sizeof(TSize) == 2) || (sizeof(TSize) == 4));
 
-        constexpr auto nbByteToLoad = sizeof(TSize);
+        // Accesses are aligned by the CPU so they can't go past the end of the RAM
+        assert((offset % sizeof(TSize)) == 0);
+        assert(offset < RAM_SIZE);
 
-        // TODO: Replace this assert by having some explicit template instantiations
-        //       for byte, halfword and word?
-        static_assert((nbByteToLoad == 1) || (nbByteToLoad == 2) || (nbByteToLoad == 4));
-
-        TSize value = 0;
-
-        // Don't forget the PSX is a little endian machine!
-        for(int iByte = nbByteToLoad - 1; iByte >= 0; --iByte)
-        {
-            assert((offset + iByte) < m_data.size());
-            value |= static_cast<uint32_t>(m_data[offset + iByte]) << (iByte * 8);
-        }
-
-        return value;
+        return Utils::LoadLittleEndian<TSize>(m_data + offset);
     }
 
     template <typename TSize>
     void Store(uint32_t offset, TSize value)
     {
         static_assert(std::is_integral_v<TSize>);
-        
-        constexpr auto nbBytesToStore = sizeof(TSize);
+        static_assert((sizeof(TSize) == 1) || (sizeof(TSize) == 2) || (sizeof(TSize) == 4));
+
+        assert((offset % sizeof(TSize)) == 0);
+        assert(offset < RAM_SIZE);
 
-        // TODO: Replace this assert by having some explicit template instantiations
-        //       for byte, halfword and word?
-        static_assert((nbBytesToStore == 1) || (nbBytesToStore == 2) || (nbBytesToStore == 4));
+        Utils::StoreLittleEndian<TSize>(m_data + offset, value);
 
-        // Don't forget the PSX is a little endian machine!
-        for(unsigned iByte = 0; iByte < nbBytesToStore; ++iByte)
+        m_pageWriteEpochs[offset / DIRTY_PAGE_SIZE] = m_writeEpoch;
+
+        // Writing over decoded code makes it stale
+        const uint32_t page = offset / CODE_PAGE_SIZE;
+        if (m_codePages[page])
         {
-            assert((offset + iByte) < m_data.size());
-            m_data[offset + iByte] = static_cast<uint8_t>(value >> (iByte * 8));
+            InvalidateCodePage(page);
         }
     }
 
+    void ReadSpan(uint32_t offset, uint8_t* dst, uint32_t size) const;
+    void WriteSpan(uint32_t offset, const uint8_t* src, uint32_t size);
+
+    void Save(Utils::StateWriter& writer) const;
+    void Load(Utils::StateReader& reader);
+
 private:
-    std::vector<uint8_t> m_data;
+    void InvalidateCodePage(uint32_t page);
+
+private:
+    // Memory owned by this instance when no external storage is provided
+    std::vector<uint8_t> m_storage;
+
+    // Content of the RAM
+    uint8_t* m_data;
+
+    // Pages from which instructions have been decoded since they were last written
+    std::vector<bool> m_codePages;
+
+    // Epoch in which each page was last written
+    std::vector<uint64_t> m_pageWriteEpochs;
+    uint64_t m_writeEpoch;
+
+    CodeWriteHandler m_codeWriteHandler;
 };
 
 }   // end namespace PSEmu
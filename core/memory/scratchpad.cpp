@@ -0,0 +1,29 @@
+#include "scratchpad.h"
+
+#include <cstring>
+
+using namespace PSEmu;
+
+Scratchpad::Scratchpad() : m_storage(STORAGE_SIZE, 0), m_data{ m_storage.data() } { }
+
+// Use the STORAGE_SIZE bytes at <storage> instead of allocating memory.
+// The storage must outlive this instance.
+Scratchpad::Scratchpad(uint8_t* storage) : m_storage{}, m_data{ storage }
+{
+    std::memset(m_data, 0, STORAGE_SIZE);
+}
+
+const uint8_t* Scratchpad::GetData() const
+{
+    return m_data;
+}
+
+void Scratchpad::Save(Utils::StateWriter& writer) const
+{
+    writer.WriteBytes(m_data, SCRATCHPAD_SIZE);
+}
+
+void Scratchpad::Load(Utils::StateReader& reader)
+{
+    reader.ReadBytes(m_data, SCRATCHPAD_SIZE);
+}
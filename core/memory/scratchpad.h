@@ -0,0 +1,76 @@
+#ifndef SCRATCHPAD_H
+#define SCRATCHPAD_H
+
+#include "memorymap.h"
+#include "../utils/endian.h"
+#include "../utils/state.h"
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace PSEmu
+{
+
+// Data cache of the CPU used as fast RAM. It can't hold code: the CPU doesn't fetch instructions from it.
+class Scratchpad
+{
+public:
+    // Host memory backing the scratchpad, padded to a page of the page table (see Interconnect).
+    // Only the first SCRATCHPAD_SIZE bytes can be written: the rest always reads as 0.
+    static constexpr uint32_t STORAGE_SIZE = 4 * 1024;
+
+public:
+    Scratchpad();
+    explicit Scratchpad(uint8_t* storage);
+
+    // It should not be possible to copy an instance of this class
+    Scratchpad(const Scratchpad&) = delete;
+    Scratchpad& operator=(const Scratchpad&) = delete;
+
+    // But it should be possible to move it
+    Scratchpad(Scratchpad&&) = default;
+    Scratchpad& operator=(Scratchpad&&) = default;
+
+public:
+    const uint8_t* GetData() const;
+
+public:
+    template <typename TSize>
+    TSize Load(uint32_t offset) const
+    {
+        static_assert(std::is_integral_v<TSize>);
+        static_assert((sizeof(TSize) == 1) || (sizeof(TSize) == 2) || (sizeof(TSize) == 4));
+
+        assert((offset % sizeof(TSize)) == 0);
+        assert(offset < SCRATCHPAD_SIZE);
+
+        return Utils::LoadLittleEndian<TSize>(m_data + offset);
+    }
+
+    template <typename TSize>
+    void Store(uint32_t offset, TSize value)
+    {
+        static_assert(std::is_integral_v<TSize>);
+        static_assert((sizeof(TSize) == 1) || (sizeof(TSize) == 2) || (sizeof(TSize) == 4));
+
+        assert((offset % sizeof(TSize)) == 0);
+        assert(offset < SCRATCHPAD_SIZE);
+
+        Utils::StoreLittleEndian<TSize>(m_data + offset, value);
+    }
+
+    void Save(Utils::StateWriter& writer) const;
+    void Load(Utils::StateReader& reader);
+
+private:
+    // Memory owned by this instance when no external storage is provided
+    std::vector<uint8_t> m_storage;
+
+    // Content of the scratchpad
+    uint8_t* m_data;
+};
+
+}   // end namespace PSEmu
+
+#endif // SCRATCHPAD_H
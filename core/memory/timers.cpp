@@ -0,0 +1,381 @@
+#include "timers.h"
+
+#include "../cpu/scheduler.h"
+#include "interruptcontroller.h"
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+using namespace PSEmu;
+
+namespace
+{
+
+// Mode register bits
+constexpr uint16_t RESET_AT_TARGET = 1 << 3;
+constexpr uint16_t IRQ_AT_TARGET   = 1 << 4;
+constexpr uint16_t IRQ_AT_MAX      = 1 << 5;
+constexpr uint16_t IRQ_REPEAT      = 1 << 6;
+constexpr uint16_t IRQ_TOGGLE      = 1 << 7;
+constexpr uint16_t IRQ_REQUEST_N   = 1 << 10;   // Active low
+constexpr uint16_t WRITABLE_MODE   = 0x3FF;
+
+constexpr uint32_t MAX_VALUE = 0xFFFF;
+constexpr uint64_t NEVER = std::numeric_limits<uint64_t>::max();
+
+// Counter clocks in ticks per CPU cycle. The GPU clock runs 11/7 times faster than the CPU.
+// The dot clock assumes a 320 pixels wide display (8 GPU cycles per dot)
+// and the horizontal blank an NTSC display (3413 GPU cycles per line).
+struct Clock
+{
+    uint32_t m_num;
+    uint32_t m_den;
+};
+
+constexpr Clock SYSTEM_CLOCK{ 1, 1 };
+constexpr Clock SYSTEM_CLOCK_DIV8{ 1, 8 };
+constexpr Clock DOT_CLOCK{ 11, 7 * 8 };
+constexpr Clock HBLANK_CLOCK{ 11, 7 * 3413 };
+
+Clock GetClock(uint32_t index, uint16_t mode)
+{
+    const uint32_t source = (mode >> 8) & 3;
+
+    switch (index)
+    {
+        case 0: return (source & 1) != 0 ? DOT_CLOCK : SYSTEM_CLOCK;
+        case 1: return (source & 1) != 0 ? HBLANK_CLOCK : SYSTEM_CLOCK;
+        case 2: return (source & 2) != 0 ? SYSTEM_CLOCK_DIV8 : SYSTEM_CLOCK;
+        default: 
+            assert(false && "Invalid timer");
+            return SYSTEM_CLOCK;
+    }
+}
+
+EventType GetEventType(uint32_t index)
+{
+    return static_cast<EventType>(static_cast<uint32_t>(EventType::TIMER_0) + index);
+}
+
+}   // end anonymous namespace
+
+Timers::Timers() : m_counters{}, m_polled{ false }, m_scheduler{ nullptr }, m_interruptController{ nullptr }
+{
+    Reset();
+}
+
+// The interconnect owning the timers calls this again whenever it moves
+void Timers::Connect(Scheduler& scheduler, InterruptController& interruptController)
+{
+    m_scheduler = &scheduler;
+    m_interruptController = &interruptController;
+
+    for (uint32_t iCounter = 0; iCounter < m_counters.size(); ++iCounter)
+    {
+        m_scheduler->SetHandler(GetEventType(iCounter), [this, iCounter](uint64_t)
+        {
+            Sync(iCounter);
+            ScheduleIRQ(iCounter);
+        });
+    }
+}
+
+void Timers::Reset()
+{
+    const uint64_t cycle = m_scheduler != nullptr ? m_scheduler->GetCycles() : 0;
+
+    for (uint32_t iCounter = 0; iCounter < m_counters.size(); ++iCounter)
+    {
+        m_counters[iCounter] = {};
+        m_counters[iCounter].m_mode = IRQ_REQUEST_N;
+        m_counters[iCounter].m_syncCycle = cycle;
+        UpdateClock(iCounter);
+
+        if (m_scheduler != nullptr)
+        {
+            m_scheduler->Cancel(GetEventType(iCounter));
+        }
+    }
+}
+
+void Timers::Save(Utils::StateWriter& writer) const
+{
+    for (const Counter& counter : m_counters)
+    {
+        writer.Write(counter.m_value);
+        writer.Write(counter.m_mode);
+        writer.Write(counter.m_target);
+        writer.Write(counter.m_reachedTarget);
+        writer.Write(counter.m_reachedMax);
+        writer.Write(counter.m_irqFired);
+        writer.Write(counter.m_syncCycle);
+        writer.Write(counter.m_tickRemainder);
+    }
+
+    writer.Write(m_polled);
+}
+
+// The events of the next interrupts are part of the state of the scheduler.
+// The clocks are found from the modes rather than trusted from the state: a zero fraction would divide by zero.
+void Timers::Load(Utils::StateReader& reader)
+{
+    for (uint32_t iCounter = 0; iCounter < m_counters.size(); ++iCounter)
+    {
+        Counter& counter = m_counters[iCounter];
+        reader.Read(counter.m_value);
+        reader.Read(counter.m_mode);
+        reader.Read(counter.m_target);
+        reader.Read(counter.m_reachedTarget);
+        reader.Read(counter.m_reachedMax);
+        reader.Read(counter.m_irqFired);
+        reader.Read(counter.m_syncCycle);
+        reader.Read(counter.m_tickRemainder);
+
+        UpdateClock(iCounter);
+        counter.m_tickRemainder %= counter.m_ticksPerCycleDen;
+    }
+
+    reader.Read(m_polled);
+}
+
+uint32_t Timers::RegisterRead(uint32_t offset)
+{
+    const uint32_t index = offset >> 4;
+    if (index >= m_counters.size())
+    {
+        return 0;
+    }
+
+    Counter& counter = m_counters[index];
+
+    switch (offset & 0xF)
+    {
+        case 0:
+            m_polled = true;
+            Sync(index);
+            return counter.m_value;
+        case 4:
+        {
+            m_polled = true;
+            Sync(index);
+
+            uint32_t mode = counter.m_mode;
+            mode |= static_cast<uint32_t>(counter.m_reachedTarget) << 11;
+            mode |= static_cast<uint32_t>(counter.m_reachedMax) << 12;
+
+            // The *reached* flags are reset when read
+            counter.m_reachedTarget = false;
+            counter.m_reachedMax = false;
+
+            return mode;
+        }
+        case 8:
+            return counter.m_target;
+        default:
+            assert(false && "Unhandled timer read");
+            return 0;
+    }
+}
+
+bool Timers::TakePolled()
+{
+    const bool polled = m_polled;
+    m_polled = false;
+    return polled;
+}
+
+void Timers::RegisterWrite(uint32_t offset, uint32_t value)
+{
+    const uint32_t index = offset >> 4;
+    if (index >= m_counters.size())
+    {
+        return;
+    }
+
+    Counter& counter = m_counters[index];
+
+    // Bring the counter up to date before its configuration changes
+    Sync(index);
+
+    switch (offset & 0xF)
+    {
+        case 0:
+            counter.m_value = static_cast<uint16_t>(value);
+            counter.m_tickRemainder = 0;
+            break;
+        case 4:
+            // TODO: Synchronization with the blanks isn't supported, counters always run freely
+            counter.m_mode = static_cast<uint16_t>((value & WRITABLE_MODE) | IRQ_REQUEST_N);
+            counter.m_irqFired = false;
+
+            // Writing the mode resets the counter
+            counter.m_value = 0;
+            counter.m_tickRemainder = 0;
+            UpdateClock(index);
+            break;
+        case 8:
+            counter.m_target = static_cast<uint16_t>(value);
+            break;
+        default:
+            assert(false && "Unhandled timer write");
+            return;
+    }
+
+    ScheduleIRQ(index);
+}
+
+// Advance the counter by the number of ticks elapsed since it was last synchronized,
+// flag the values it went through and raise the corresponding interrupts
+void Timers::Sync(uint32_t index)
+{
+    Counter& counter = m_counters[index];
+
+    const uint64_t cycle = m_scheduler->GetCycles();
+    const uint64_t elapsed = (cycle - counter.m_syncCycle) * counter.m_ticksPerCycleNum + counter.m_tickRemainder;
+
+    counter.m_syncCycle = cycle;
+    counter.m_tickRemainder = static_cast<uint32_t>(elapsed % counter.m_ticksPerCycleDen);
+
+    uint64_t ticks = elapsed / counter.m_ticksPerCycleDen;
+    if (ticks == 0)
+    {
+        return;
+    }
+
+    const bool resetAtTarget = (counter.m_mode & RESET_AT_TARGET) != 0;
+    const uint32_t value = counter.m_value;
+    const uint32_t target = counter.m_target;
+
+    bool reachedTarget = false;
+    bool reachedMax = false;
+
+    // The counter wraps after the target if it is configured to and hasn't gone past it already
+    const uint32_t limit = (resetAtTarget && value <= target) ? target : MAX_VALUE;
+    const uint64_t ticksToWrap = limit - value + 1;
+
+    uint32_t newValue;
+    if (ticks < ticksToWrap)
+    {
+        newValue = static_cast<uint32_t>(value + ticks);
+        reachedTarget = (value < target && target <= newValue);
+        reachedMax = (newValue == MAX_VALUE);
+    }
+    else
+    {
+        reachedTarget = (value < target && target <= limit);
+        reachedMax = (limit == MAX_VALUE && value < MAX_VALUE);
+
+        // From 0, the counter keeps going through the same period
+        ticks -= ticksToWrap;
+
+        const uint32_t steadyLimit = resetAtTarget ? target : MAX_VALUE;
+        const uint64_t period = static_cast<uint64_t>(steadyLimit) + 1;
+        if (ticks >= period)
+        {
+            reachedTarget = true;
+            reachedMax |= (steadyLimit == MAX_VALUE);
+            ticks %= period;
+        }
+
+        newValue = static_cast<uint32_t>(ticks);
+        reachedTarget |= (target <= newValue);
+        reachedMax |= (newValue == MAX_VALUE);
+    }
+
+    counter.m_value = static_cast<uint16_t>(newValue);
+    counter.m_reachedTarget |= reachedTarget;
+    counter.m_reachedMax |= reachedMax;
+
+    if ((reachedTarget && (counter.m_mode & IRQ_AT_TARGET) != 0) ||
+        (reachedMax && (counter.m_mode & IRQ_AT_MAX) != 0))
+    {
+        RaiseIRQ(index);
+    }
+}
+
+// Schedule an event for the next time the counter goes through a value raising an interrupt.
+// Must be called right after Sync.
+void Timers::ScheduleIRQ(uint32_t index)
+{
+    const Counter& counter = m_counters[index];
+    const EventType eventType = GetEventType(index);
+
+    const bool oneShotDone = (counter.m_mode & IRQ_REPEAT) == 0 && counter.m_irqFired;
+    if (oneShotDone || (counter.m_mode & (IRQ_AT_TARGET | IRQ_AT_MAX)) == 0)
+    {
+        m_scheduler->Cancel(eventType);
+        return;
+    }
+
+    const bool resetAtTarget = (counter.m_mode & RESET_AT_TARGET) != 0;
+    const uint32_t value = counter.m_value;
+    const uint32_t target = counter.m_target;
+
+    const uint32_t limit = (resetAtTarget && value <= target) ? target : MAX_VALUE;
+    const uint64_t ticksToWrap = limit - value + 1;
+
+    uint64_t ticks = NEVER;
+
+    if ((counter.m_mode & IRQ_AT_TARGET) != 0)
+    {
+        ticks = (value < target) ? target - value : ticksToWrap + target;
+    }
+
+    if ((counter.m_mode & IRQ_AT_MAX) != 0)
+    {
+        if (value < MAX_VALUE && limit == MAX_VALUE)
+        {
+            ticks = std::min<uint64_t>(ticks, MAX_VALUE - value);
+        }
+        else if (!resetAtTarget || target == MAX_VALUE)
+        {
+            ticks = std::min<uint64_t>(ticks, ticksToWrap + MAX_VALUE);
+        }
+    }
+
+    if (ticks == NEVER)
+    {
+        m_scheduler->Cancel(eventType);
+        return;
+    }
+
+    // First cycle at which at least <ticks> ticks have elapsed
+    const uint64_t fractions = ticks * counter.m_ticksPerCycleDen - counter.m_tickRemainder;
+    const uint64_t cycles = (fractions + counter.m_ticksPerCycleNum - 1) / counter.m_ticksPerCycleNum;
+
+    m_scheduler->ScheduleAt(eventType, counter.m_syncCycle + cycles);
+}
+
+void Timers::RaiseIRQ(uint32_t index)
+{
+    Counter& counter = m_counters[index];
+
+    if ((counter.m_mode & IRQ_REPEAT) == 0 && counter.m_irqFired)
+    {
+        return;
+    }
+
+    counter.m_irqFired = true;
+
+    if ((counter.m_mode & IRQ_TOGGLE) != 0)
+    {
+        // The request bit goes back and forth, only the falling edge is an interrupt
+        counter.m_mode ^= IRQ_REQUEST_N;
+        if ((counter.m_mode & IRQ_REQUEST_N) != 0)
+        {
+            return;
+        }
+    }
+
+    m_interruptController->Request(static_cast<Interrupt>(static_cast<uint32_t>(Interrupt::TIMER_0) + index));
+}
+
+void Timers::UpdateClock(uint32_t index)
+{
+    Counter& counter = m_counters[index];
+
+    const Clock clock = GetClock(index, counter.m_mode);
+    counter.m_ticksPerCycleNum = clock.m_num;
+    counter.m_ticksPerCycleDen = clock.m_den;
+}
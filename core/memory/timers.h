@@ -0,0 +1,80 @@
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#include "../utils/state.h"
+
+#include <array>
+#include <cstdint>
+
+namespace PSEmu
+{
+
+class InterruptController;
+class Scheduler;
+
+// The three root counters.
+// Counters aren't incremented as time goes by: their value is derived from the
+// number of cycles elapsed since they were last looked at, and the only events
+// scheduled are the ones for the next interrupt.
+class Timers
+{
+public:
+    Timers();
+
+    // It should not be possible to copy an instance of this class
+    Timers(const Timers&) = delete;
+    Timers& operator=(const Timers&) = delete;
+
+    // But it should be possible to move it
+    Timers(Timers&&) = default;
+    Timers& operator=(Timers&&) = default;
+
+public:
+    void Connect(Scheduler& scheduler, InterruptController& interruptController);
+    void Reset();
+
+    void Save(Utils::StateWriter& writer) const;
+    void Load(Utils::StateReader& reader);
+
+    uint32_t RegisterRead(uint32_t offset);
+    void RegisterWrite(uint32_t offset, uint32_t value);
+
+    // Tells if a value changing with time was read since the last call
+    bool TakePolled();
+
+private:
+    struct Counter
+    {
+        uint16_t m_value;           /**< Counter value at m_syncCycle */
+        uint16_t m_mode;            /**< Mode register, without the value of the *reached* flags */
+        uint16_t m_target;
+
+        bool m_reachedTarget;       /**< Set when the value reaches the target, cleared when the mode is read */
+        bool m_reachedMax;          /**< Set when the value reaches 0xFFFF, cleared when the mode is read */
+        bool m_irqFired;            /**< Set after the first interrupt in one-shot mode */
+
+        uint64_t m_syncCycle;       /**< Last cycle at which m_value was brought up to date */
+        uint32_t m_ticksPerCycleNum;/**< Counter clock relative to the CPU clock, as a fraction */
+        uint32_t m_ticksPerCycleDen;
+        uint32_t m_tickRemainder;   /**< Fraction of tick elapsed at m_syncCycle, in 1/m_ticksPerCycleDen */
+    };
+
+    void Sync(uint32_t index);
+    void ScheduleIRQ(uint32_t index);
+    void RaiseIRQ(uint32_t index);
+    void UpdateClock(uint32_t index);
+
+private:
+    std::array<Counter, 3> m_counters;
+
+    // Set when a counter value or mode is read
+    bool m_polled;
+
+    // Set by Connect
+    Scheduler* m_scheduler;
+    InterruptController* m_interruptController;
+};
+
+}   // end namespace PSEmu
+
+#endif // TIMERS_H
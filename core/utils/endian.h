@@ -0,0 +1,57 @@
+#ifndef ENDIAN_H
+#define ENDIAN_H
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace Utils
+{
+
+// Read a little endian value of type <T> from <src>.
+// The PSX is a little endian machine so this is a plain copy on most hosts.
+template <typename T>
+T LoadLittleEndian(const uint8_t* src)
+{
+    static_assert(std::is_integral_v<T>);
+
+    T value;
+    std::memcpy(&value, src, sizeof(T));
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    if constexpr (sizeof(T) == 2)
+    {
+        value = __builtin_bswap16(value);
+    }
+    else if constexpr (sizeof(T) == 4)
+    {
+        value = __builtin_bswap32(value);
+    }
+#endif
+
+    return value;
+}
+
+// Write <value> to <dst> in little endian order
+template <typename T>
+void StoreLittleEndian(uint8_t* dst, T value)
+{
+    static_assert(std::is_integral_v<T>);
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    if constexpr (sizeof(T) == 2)
+    {
+        value = __builtin_bswap16(value);
+    }
+    else if constexpr (sizeof(T) == 4)
+    {
+        value = __builtin_bswap32(value);
+    }
+#endif
+
+    std::memcpy(dst, &value, sizeof(T));
+}
+
+}   // end namespace Utils
+
+#endif // ENDIAN_H
@@ -0,0 +1,14 @@
+#include "hash.h"
+
+uint64_t Utils::HashFNV1a(const uint8_t* data, size_t size, uint64_t seed)
+{
+    constexpr uint64_t PRIME = 0x100000001B3;
+
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ data[i]) * PRIME;
+    }
+
+    return hash;
+}
@@ -0,0 +1,16 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Utils
+{
+
+// 64 bits FNV-1a hash of <size> bytes starting at <data>.
+// Not cryptographic, only meant to tell memory images apart.
+uint64_t HashFNV1a(const uint8_t* data, size_t size, uint64_t seed = 0xCBF29CE484222325);
+
+}   // end namespace Utils
+
+#endif // HASH_H
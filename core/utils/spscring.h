@@ -0,0 +1,89 @@
+#ifndef SPSCRING_H
+#define SPSCRING_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+namespace Utils
+{
+
+// Lock-free queue between a single producer thread and a single consumer thread.
+// Blocks of items are written and read whole: the consumer never sees part of a block.
+template <typename T>
+class SPSCRing
+{
+public:
+    // <capacity> must be a power of two
+    explicit SPSCRing(size_t capacity) : m_items(capacity), m_writeIndex{ 0 }, m_readIndex{ 0 }
+    {
+        assert(capacity != 0 && (capacity & (capacity - 1)) == 0);
+    }
+
+    // It should not be possible to copy or move this class: the threads keep using it
+    SPSCRing(const SPSCRing&) = delete;
+    SPSCRing& operator=(const SPSCRing&) = delete;
+
+    SPSCRing(SPSCRing&&) = delete;
+    SPSCRing& operator=(SPSCRing&&) = delete;
+
+public:
+    // Producer side. Returns false when there isn't enough room for the <count> items.
+    bool TryWrite(const T* items, size_t count)
+    {
+        // The indices grow forever and are wrapped when accessing the items
+        const size_t writeIndex = m_writeIndex.load(std::memory_order_relaxed);
+        if (count > m_items.size() - (writeIndex - m_readIndex.load(std::memory_order_acquire)))
+        {
+            return false;
+        }
+
+        for (size_t iItem = 0; iItem < count; ++iItem)
+        {
+            m_items[(writeIndex + iItem) & (m_items.size() - 1)] = items[iItem];
+        }
+
+        m_writeIndex.store(writeIndex + count, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false when fewer than <count> items were written.
+    bool TryRead(T* items, size_t count)
+    {
+        const size_t readIndex = m_readIndex.load(std::memory_order_relaxed);
+        if (count > m_writeIndex.load(std::memory_order_acquire) - readIndex)
+        {
+            return false;
+        }
+
+        for (size_t iItem = 0; iItem < count; ++iItem)
+        {
+            items[iItem] = m_items[(readIndex + iItem) & (m_items.size() - 1)];
+        }
+
+        m_readIndex.store(readIndex + count, std::memory_order_release);
+        return true;
+    }
+
+    bool IsEmpty() const
+    {
+        return m_writeIndex.load(std::memory_order_acquire) == m_readIndex.load(std::memory_order_acquire);
+    }
+
+    size_t GetCapacity() const
+    {
+        return m_items.size();
+    }
+
+private:
+    std::vector<T> m_items;
+
+    // On separate cache lines so that the threads don't invalidate each other's
+    alignas(64) std::atomic<size_t> m_writeIndex;   /**< Written by the producer only */
+    alignas(64) std::atomic<size_t> m_readIndex;    /**< Written by the consumer only */
+};
+
+}   // end namespace Utils
+
+#endif // SPSCRING_H
@@ -0,0 +1,135 @@
+#include "state.h"
+
+#include <fstream>
+#include <iterator>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define PSEMU_HAS_MMAP
+#endif
+
+using namespace Utils;
+
+StateWriter::StateWriter(std::vector<uint8_t>& buffer) : m_buffer{ buffer }
+{
+    m_buffer.clear();
+}
+
+void StateWriter::WriteBytes(const void* src, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(src);
+    m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+}
+
+size_t StateWriter::GetSize() const
+{
+    return m_buffer.size();
+}
+
+StateReader::StateReader(const uint8_t* data, size_t size)
+    : m_data{ data }, m_size{ size }, m_offset{ 0 }, m_failed{ false } { }
+
+void StateReader::ReadBytes(void* dst, size_t size)
+{
+    if (m_failed || size > m_size - m_offset)
+    {
+        m_failed = true;
+        std::memset(dst, 0, size);
+        return;
+    }
+
+    std::memcpy(dst, m_data + m_offset, size);
+    m_offset += size;
+}
+
+void StateReader::Fail()
+{
+    m_failed = true;
+}
+
+bool StateReader::HasFailed() const
+{
+    return m_failed;
+}
+
+bool StateReader::IsAtEnd() const
+{
+    return m_offset == m_size;
+}
+
+size_t StateReader::GetRemainingSize() const
+{
+    return m_failed ? 0 : m_size - m_offset;
+}
+
+bool Utils::WriteStateFile(const std::string& path, const std::vector<uint8_t>& state)
+{
+    std::ofstream file{ path, std::ios::binary | std::ios::trunc };
+    file.write(reinterpret_cast<const char*>(state.data()), static_cast<std::streamsize>(state.size()));
+    return file.good();
+}
+
+StateFile::~StateFile()
+{
+    Close();
+}
+
+bool StateFile::Open(const std::string& path)
+{
+    Close();
+
+#if defined(PSEMU_HAS_MMAP)
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat fileStat{};
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+    {
+        void* mapping = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            m_mapping = mapping;
+            m_data = static_cast<const uint8_t*>(mapping);
+            m_size = static_cast<size_t>(fileStat.st_size);
+        }
+    }
+    close(fd);
+
+    if (m_mapping != nullptr)
+    {
+        return true;
+    }
+#endif
+
+    std::ifstream file{ path, std::ios::binary };
+    if (!file)
+    {
+        return false;
+    }
+
+    m_buffer.assign(std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{});
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+    return true;
+}
+
+void StateFile::Close()
+{
+#if defined(PSEMU_HAS_MMAP)
+    if (m_mapping != nullptr)
+    {
+        munmap(m_mapping, m_size);
+    }
+#endif
+
+    m_buffer.clear();
+    m_mapping = nullptr;
+    m_data = nullptr;
+    m_size = 0;
+}
@@ -0,0 +1,118 @@
+#ifndef STATE_H
+#define STATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace Utils
+{
+
+// Appends the state of the emulated devices to a buffer, in host byte order.
+// The buffer is cleared but keeps its capacity so that saving again doesn't allocate.
+class StateWriter
+{
+public:
+    explicit StateWriter(std::vector<uint8_t>& buffer);
+
+    // It should not be possible to copy an instance of this class
+    StateWriter(const StateWriter&) = delete;
+    StateWriter& operator=(const StateWriter&) = delete;
+
+public:
+    template <typename T>
+    void Write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        WriteBytes(&value, sizeof(T));
+    }
+
+    // Large blobs (memories) go through a single copy
+    void WriteBytes(const void* src, size_t size);
+
+    size_t GetSize() const;
+
+private:
+    std::vector<uint8_t>& m_buffer;
+};
+
+// Reads back what a StateWriter wrote, straight from the source memory.
+// Reading past the end fails the whole reader: the values read are then zeroes.
+class StateReader
+{
+public:
+    StateReader(const uint8_t* data, size_t size);
+
+    // It should not be possible to copy an instance of this class
+    StateReader(const StateReader&) = delete;
+    StateReader& operator=(const StateReader&) = delete;
+
+public:
+    template <typename T>
+    void Read(T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        ReadBytes(&value, sizeof(T));
+    }
+
+    template <typename T>
+    T Read()
+    {
+        T value{};
+        Read(value);
+        return value;
+    }
+
+    void ReadBytes(void* dst, size_t size);
+
+    // Called by the devices on values they can't use: the state is rejected
+    void Fail();
+
+    bool HasFailed() const;
+    bool IsAtEnd() const;
+    size_t GetRemainingSize() const;
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_offset;
+    bool m_failed;
+};
+
+// Writes a whole state to <path> with a single write
+bool WriteStateFile(const std::string& path, const std::vector<uint8_t>& state);
+
+// State file mapped in memory when the platform allows it, so that a StateReader
+// copies the devices state straight from the page cache
+class StateFile
+{
+public:
+    StateFile() = default;
+    ~StateFile();
+
+    // It should not be possible to copy an instance of this class
+    StateFile(const StateFile&) = delete;
+    StateFile& operator=(const StateFile&) = delete;
+
+public:
+    bool Open(const std::string& path);
+
+    const uint8_t* GetData() const { return m_data; }
+    size_t GetSize() const { return m_size; }
+
+private:
+    void Close();
+
+private:
+    std::vector<uint8_t> m_buffer;  /**< File content when it can't be mapped */
+    void* m_mapping = nullptr;
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+}   // end namespace Utils
+
+#endif // STATE_H
@@ -0,0 +1,141 @@
+#include "threadpool.h"
+
+#include <cassert>
+
+using namespace Utils;
+
+ThreadPool::ThreadPool(size_t threadCount)
+    : m_queues{ std::make_unique<Queue[]>(threadCount) }, m_queueCount{ threadCount }, m_task{ nullptr },
+      m_remainingTasks{ 0 }, m_mutex{}, m_wakeUp{}, m_done{}, m_batch{ 0 }, m_stopping{ false }, m_workers{}
+{
+    assert(threadCount > 0);
+
+    // Queue 0 belongs to the thread running the batches
+    for (size_t iWorker = 1; iWorker < threadCount; ++iWorker)
+    {
+        m_workers.emplace_back(&ThreadPool::RunWorker, this, iWorker);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{ m_mutex };
+        m_stopping = true;
+    }
+    m_wakeUp.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::Run(size_t count, const std::function<void(size_t)>& task)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Not worth waking up the workers
+    if (count == 1 || m_queueCount == 1)
+    {
+        for (size_t iTask = 0; iTask < count; ++iTask)
+        {
+            task(iTask);
+        }
+        return;
+    }
+
+    // Set before the tasks are queued: workers still looking for tasks of the previous batch can take them
+    m_task.store(&task);
+    m_remainingTasks.store(count);
+
+    for (size_t iTask = 0; iTask < count; ++iTask)
+    {
+        Queue& queue = m_queues[iTask % m_queueCount];
+        std::lock_guard<std::mutex> lock{ queue.m_mutex };
+        queue.m_tasks.push_back(iTask);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{ m_mutex };
+        ++m_batch;
+    }
+    m_wakeUp.notify_all();
+
+    RunTasks(0);
+
+    std::unique_lock<std::mutex> lock{ m_mutex };
+    m_done.wait(lock, [this]() { return m_remainingTasks.load() == 0; });
+}
+
+size_t ThreadPool::GetThreadCount() const
+{
+    return m_queueCount;
+}
+
+void ThreadPool::RunWorker(size_t index)
+{
+    uint64_t batch = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock{ m_mutex };
+            m_wakeUp.wait(lock, [this, batch]() { return m_stopping || m_batch != batch; });
+
+            if (m_stopping)
+            {
+                return;
+            }
+            batch = m_batch;
+        }
+
+        RunTasks(index);
+    }
+}
+
+void ThreadPool::RunTasks(size_t index)
+{
+    size_t task = 0;
+    while (TakeTask(index, task))
+    {
+        (*m_task.load())(task);
+
+        if (m_remainingTasks.fetch_sub(1) == 1)
+        {
+            std::lock_guard<std::mutex> lock{ m_mutex };
+            m_done.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::TakeTask(size_t index, size_t& task)
+{
+    {
+        Queue& queue = m_queues[index];
+        std::lock_guard<std::mutex> lock{ queue.m_mutex };
+        if (!queue.m_tasks.empty())
+        {
+            task = queue.m_tasks.front();
+            queue.m_tasks.pop_front();
+            return true;
+        }
+    }
+
+    for (size_t iOffset = 1; iOffset < m_queueCount; ++iOffset)
+    {
+        Queue& victim = m_queues[(index + iOffset) % m_queueCount];
+        std::lock_guard<std::mutex> lock{ victim.m_mutex };
+        if (!victim.m_tasks.empty())
+        {
+            task = victim.m_tasks.back();
+            victim.m_tasks.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,70 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Utils
+{
+
+// Threads running batches of tasks in parallel. The tasks of a batch are dealt to a queue per thread:
+// each thread takes the tasks from the front of its own queue, then steals from the back of the others.
+class ThreadPool
+{
+public:
+    // The thread running a batch counts as one of the <threadCount>
+    explicit ThreadPool(size_t threadCount);
+    ~ThreadPool();
+
+    // It should not be possible to copy or move this class: the threads keep using it
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+public:
+    // Calls <task> with each index in [0, <count>) and waits for all the calls to return
+    void Run(size_t count, const std::function<void(size_t)>& task);
+
+    size_t GetThreadCount() const;
+
+private:
+    struct Queue
+    {
+        std::mutex m_mutex;
+        std::deque<size_t> m_tasks;
+    };
+
+private:
+    void RunWorker(size_t index);
+    void RunTasks(size_t index);
+    bool TakeTask(size_t index, size_t& task);
+
+private:
+    std::unique_ptr<Queue[]> m_queues;
+    size_t m_queueCount;
+
+    std::atomic<const std::function<void(size_t)>*> m_task;
+    std::atomic<size_t> m_remainingTasks;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::condition_variable m_done;
+    uint64_t m_batch;       /**< Incremented by each batch, to wake up the workers */
+    bool m_stopping;
+
+    std::vector<std::thread> m_workers;
+};
+
+}   // end namespace Utils
+
+#endif // THREADPOOL_H
@@ -1,5 +1,7 @@
 #include "commandbuffer.h"
 
+#include <algorithm>
+
 using namespace PSEmu;
 
 CommandBuffer::CommandBuffer()
@@ -24,3 +26,24 @@ uint32_t CommandBuffer::operator[](uint32_t index) const
 {
     return m_buffer[index];
 }
+
+void CommandBuffer::Save(Utils::StateWriter& writer) const
+{
+    writer.Write(m_len);
+    for (uint32_t word : m_buffer)
+    {
+        writer.Write(word);
+    }
+}
+
+void CommandBuffer::Load(Utils::StateReader& reader)
+{
+    reader.Read(m_len);
+    for (uint32_t& word : m_buffer)
+    {
+        reader.Read(word);
+    }
+
+    // Never trust the length enough to write out of bounds
+    m_len = std::min<uint8_t>(m_len, m_buffer.size());
+}
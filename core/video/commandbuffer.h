@@ -1,6 +1,8 @@
 #ifndef COMMAND_BUFFER_H
 #define COMMAND_BUFFER_H
 
+#include "../utils/state.h"
+
 #include <array>
 #include <cstdint>
 
@@ -17,6 +19,9 @@ public:
     void PushWord(uint32_t word);
     uint32_t operator[](uint32_t index) const;
 
+    void Save(Utils::StateWriter& writer) const;
+    void Load(Utils::StateReader& reader);
+
 private:
     // Command buffer. The longest possible command is GP0(0x3E)
     // which takes 12 parameters
@@ -1,15 +1,322 @@
 #include "gpu.h"
 
+#include "../cpu/scheduler.h"
+#include "../memory/interruptcontroller.h"
+
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <cstring>
 #include <functional>
+#include <type_traits>
 
 using namespace PSEmu;
 
-GPU::GPU() : m_GP0Command{}, m_GP0WordsRemaining{}
+namespace
+{
+
+// Frame length in GPU cycles: lines per frame times cycles per line
+constexpr uint32_t NTSC_GPU_CYCLES_PER_FRAME = 263 * 3413;
+constexpr uint32_t PAL_GPU_CYCLES_PER_FRAME = 314 * 3406;
+
+// The GPU clock runs 11/7 times faster than the CPU clock
+constexpr uint32_t ToCPUCycles(uint32_t gpuCycles)
+{
+    return static_cast<uint32_t>(static_cast<uint64_t>(gpuCycles) * 7 / 11);
+}
+
+constexpr uint16_t MASK_BIT = 0x8000;
+
+// Vertex coordinates are 11 bits two's complement signed values
+int32_t SignExtend11(uint32_t value)
+{
+    return static_cast<int16_t>(static_cast<uint16_t>(value << 5)) >> 5;
+}
+
+// 15 bit pixel from a 24 bit BGR color
+uint16_t ToPixel(uint32_t color)
+{
+    return static_cast<uint16_t>(((color >> 3) & 0x1F) | (((color >> 11) & 0x1F) << 5) | (((color >> 19) & 0x1F) << 10));
+}
+
+// Records of the VRAM work of the GP0 commands, with the state they are executed with
+
+enum class RenderRecord : uint32_t
+{
+    PRIMITIVE,
+    FILL_RECTANGLE,
+    IMAGE,
+    FLUSH
+};
+
+struct PrimitiveRecord
+{
+    static constexpr RenderRecord TYPE = RenderRecord::PRIMITIVE;
+
+    Primitive m_primitive;
+};
+
+struct FillRecord
+{
+    static constexpr RenderRecord TYPE = RenderRecord::FILL_RECTANGLE;
+
+    uint16_t m_x;
+    uint16_t m_y;
+    uint16_t m_width;
+    uint16_t m_height;
+    uint16_t m_pixel;
+};
+
+// Consecutive pixels of a line of an image being loaded
+struct ImageRecord
+{
+    static constexpr RenderRecord TYPE = RenderRecord::IMAGE;
+
+    uint16_t m_x;
+    uint16_t m_y;
+    uint16_t m_pixelCount;
+    bool m_forceSetMaskBit;
+    bool m_preserveMaskedPixels;
+    std::array<uint16_t, GPU::IMAGE_BATCH_SIZE> m_pixels;
+};
+
+static_assert(sizeof(ImageRecord) <= RenderThread::MAX_PAYLOAD_SIZE);
+
+// Draws the primitives held by the tile rasterizer
+struct FlushRecord
+{
+    static constexpr RenderRecord TYPE = RenderRecord::FLUSH;
+};
+
+// What the records are executed with
+struct RenderTarget
+{
+    VRAM& m_vram;
+    Rasterizer& m_rasterizer;
+    TextureCache& m_textureCache;
+    TileRasterizer* m_tileRasterizer;   /**< Draws the primitives when there's one */
+};
+
+void Execute(const PrimitiveRecord& record, const RenderTarget& target)
+{
+    if (target.m_tileRasterizer != nullptr)
+    {
+        target.m_tileRasterizer->Draw(record.m_primitive);
+    }
+    else
+    {
+        Primitive primitive = record.m_primitive;
+        target.m_textureCache.Prepare(target.m_vram, primitive);
+        target.m_rasterizer.Draw(target.m_vram, primitive);
+        target.m_textureCache.StartBatch();
+    }
+}
+
+// Fills regardless of the drawing area and mask settings
+void Execute(const FillRecord& record, const RenderTarget& target)
+{
+    if (target.m_tileRasterizer != nullptr)
+    {
+        target.m_tileRasterizer->Flush();
+    }
+
+    for (uint32_t row = 0; row < record.m_height; ++row)
+    {
+        uint16_t* line = target.m_vram.GetLineForWrite((record.m_y + row) % VRAM::HEIGHT);
+        for (uint32_t column = 0; column < record.m_width; ++column)
+        {
+            line[(record.m_x + column) % VRAM::WIDTH] = record.m_pixel;
+        }
+    }
+}
+
+// The pixels wrap around the right edge of VRAM
+void Execute(const ImageRecord& record, const RenderTarget& target)
+{
+    if (target.m_tileRasterizer != nullptr)
+    {
+        target.m_tileRasterizer->Flush();
+    }
+
+    const uint16_t maskBit = record.m_forceSetMaskBit ? MASK_BIT : 0;
+
+    uint16_t* line = target.m_vram.GetLineForWrite(record.m_y);
+    for (uint32_t iPixel = 0; iPixel < record.m_pixelCount; ++iPixel)
+    {
+        uint16_t& pixel = line[(record.m_x + iPixel) % VRAM::WIDTH];
+        if (!record.m_preserveMaskedPixels || (pixel & MASK_BIT) == 0)
+        {
+            pixel = record.m_pixels[iPixel] | maskBit;
+        }
+    }
+}
+
+void Execute(const FlushRecord&, const RenderTarget& target)
+{
+    if (target.m_tileRasterizer != nullptr)
+    {
+        target.m_tileRasterizer->Flush();
+    }
+}
+
+template <typename TRecord>
+void ExecutePayload(const uint32_t* payload, const RenderTarget& target)
+{
+    // The records are trivially copyable, though not trivial because of the default values of their members
+    TRecord record;
+    std::memcpy(static_cast<void*>(&record), payload, sizeof(record));
+    Execute(record, target);
+}
+
+// Called on the render thread
+void ExecuteRecord(uint32_t type, const uint32_t* payload, const RenderTarget& target)
+{
+    switch (static_cast<RenderRecord>(type))
+    {
+        case RenderRecord::PRIMITIVE: ExecutePayload<PrimitiveRecord>(payload, target); break;
+        case RenderRecord::FILL_RECTANGLE: ExecutePayload<FillRecord>(payload, target); break;
+        case RenderRecord::IMAGE: ExecutePayload<ImageRecord>(payload, target); break;
+        case RenderRecord::FLUSH: ExecutePayload<FlushRecord>(payload, target); break;
+        default:
+            assert(false && "Unknown render record");
+    }
+}
+
+}   // end anonymous namespace
+
+GPU::GPU() 
+    : m_GP0Command{}, m_GP0WordsRemaining{}, m_frameCount{ 0 }, m_frameHandler{}, m_outputEnabled{ true }, 
+      m_vram{}, m_rasterizer{}, m_textureCache{}, m_imageX{ 0 }, m_imageY{ 0 }, m_imageWidth{ 0 }, m_imageHeight{ 0 }, m_imagePixelsLoaded{ 0 },
+      m_imageBatch{}, m_imageBatchSize{ 0 },
+      m_scheduler{ nullptr }, m_interruptController{ nullptr }, m_tileRasterizer{}, m_renderThread{}
 {
     Reset();
 }
 
+// The interconnect owning the GPU calls this again whenever it moves
+void GPU::Connect(Scheduler& scheduler, InterruptController& interruptController)
+{
+    assert(!m_renderThread && !m_tileRasterizer && "The GPU moved while its threads run");
+
+    m_scheduler = &scheduler;
+    m_interruptController = &interruptController;
+    m_scheduler->SetHandler(EventType::VBLANK, [this](uint64_t cycle) { OnVBlank(cycle); });
+}
+
+uint32_t GPU::GetCyclesPerFrame() const
+{
+    return ToCPUCycles(m_vMode == VMode::NTSC ? NTSC_GPU_CYCLES_PER_FRAME : PAL_GPU_CYCLES_PER_FRAME);
+}
+
+uint64_t GPU::GetFrameCount() const
+{
+    return m_frameCount;
+}
+
+void GPU::SetFrameHandler(FrameHandler handler)
+{
+    m_frameHandler = std::move(handler);
+}
+
+void GPU::SetOutputEnabled(bool enabled)
+{
+    m_outputEnabled = enabled;
+}
+
+void GPU::SetRenderThreadEnabled(bool enabled)
+{
+    if (!enabled)
+    {
+        // Completes the pending work first
+        m_renderThread.reset();
+    }
+    else if (!m_renderThread)
+    {
+        m_renderThread = std::make_unique<RenderThread>([this](uint32_t type, const uint32_t* payload)
+        {
+            ExecuteRecord(type, payload, RenderTarget{ m_vram, m_rasterizer, m_textureCache, m_tileRasterizer.get() });
+        });
+    }
+}
+
+void GPU::SetRasterizerThreadCount(size_t count)
+{
+    Sync();
+
+    m_tileRasterizer.reset();
+    if (count > 1)
+    {
+        m_tileRasterizer = std::make_unique<TileRasterizer>(m_vram, m_rasterizer, m_textureCache, count);
+    }
+}
+
+VRAM& GPU::GetVRAM()
+{
+    Sync();
+    return m_vram;
+}
+
+const VRAM& GPU::GetVRAM() const
+{
+    Sync();
+    return m_vram;
+}
+
+Rasterizer& GPU::GetRasterizer()
+{
+    Sync();
+    return m_rasterizer;
+}
+
+template <typename TRecord>
+void GPU::Submit(const TRecord& record)
+{
+    static_assert(std::is_trivially_copyable_v<TRecord> && sizeof(TRecord) <= RenderThread::MAX_PAYLOAD_SIZE);
+
+    if (m_renderThread)
+    {
+        m_renderThread->Submit(static_cast<uint32_t>(TRecord::TYPE), &record, sizeof(record));
+    }
+    else
+    {
+        Execute(record, RenderTarget{ m_vram, m_rasterizer, m_textureCache, m_tileRasterizer.get() });
+    }
+}
+
+void GPU::Sync() const
+{
+    if (m_renderThread)
+    {
+        if (m_tileRasterizer)
+        {
+            const FlushRecord record{};
+            m_renderThread->Submit(static_cast<uint32_t>(FlushRecord::TYPE), &record, sizeof(record));
+        }
+        m_renderThread->Sync();
+    }
+    else if (m_tileRasterizer)
+    {
+        m_tileRasterizer->Flush();
+    }
+}
+
+void GPU::OnVBlank(uint64_t cycle)
+{
+    ++m_frameCount;
+
+    if (m_outputEnabled && m_frameHandler)
+    {
+        // The frame is complete in VRAM
+        Sync();
+        m_frameHandler(*this);
+    }
+
+    m_interruptController->Request(Interrupt::VBLANK);
+
+    // Schedule from the deadline rather than from the current cycle so that frames don't drift
+    m_scheduler->ScheduleAt(EventType::VBLANK, cycle + GetCyclesPerFrame());
+}
+
 uint32_t GPU::GetStatus() const
 {
     uint32_t status = 0;
@@ -67,69 +374,89 @@ uint32_t GPU::GetStatus() const
     return status;
 }
 
+// Point m_GP0CommandMethod to the implementation of the command <opcode>.
+// Returns the number of words of the command.
+uint8_t GPU::SelectGP0Command(uint32_t opcode)
+{
+    uint8_t len = 0;
+    switch (opcode)
+    {
+        case 0x00:
+            m_GP0CommandMethod = &GPU::GP0NOP;
+            len = 1;
+            break;
+        case 0x01:
+            m_GP0CommandMethod = &GPU::GP0ClearCache;
+            len = 1;
+            break;
+        case 0x02:
+            m_GP0CommandMethod = &GPU::GP0FillRectangle;
+            len = 3;
+            break;
+        case 0x1F:
+            m_GP0CommandMethod = &GPU::GP0RequestIRQ;
+            len = 1;
+            break;
+        case 0x28:
+            m_GP0CommandMethod = &GPU::GP0DrawQuadMonoOpaque;
+            len = 5;
+            break;
+        case 0x2C:
+            m_GP0CommandMethod = &GPU::GP0DrawQuadTextureBlendOpaque;
+            len = 9;
+            break;
+        case 0x30:
+            m_GP0CommandMethod = &GPU::GP0DrawTriShadedOpaque;
+            len = 6;
+            break;
+        case 0x38:
+            m_GP0CommandMethod = &GPU::GP0DrawQuadShadedOpaque;
+            len = 8;
+            break;
+        case 0xA0:
+            m_GP0CommandMethod = &GPU::GP0LoadImage;
+            len = 3;
+            break;
+        case 0xE1:
+            m_GP0CommandMethod = &GPU::GP0SetDrawMode;
+            len = 1;
+            break;
+        case 0xE2:
+            m_GP0CommandMethod = &GPU::GP0SetTextureWindow;
+            len = 1;
+            break;
+        case 0xE3:
+            m_GP0CommandMethod = &GPU::GP0SetDrawingAreaTopLeft;
+            len = 1;
+            break;
+        case 0xE4:
+            m_GP0CommandMethod = &GPU::GP0SetDrawingAreaBottomRight;
+            len = 1;
+            break;
+        case 0xE5:
+            m_GP0CommandMethod = &GPU::GP0SetDrawingOffset;
+            len = 1;
+            break;
+        case 0xE6:
+            m_GP0CommandMethod = &GPU::GP0SetMaskBitSetting;
+            len = 1;
+            break;
+        default:
+            // Skipped like a NOP so that the following words are still decoded as commands
+            assert(false && "Unhandled GP0 command");
+            m_GP0CommandMethod = &GPU::GP0NOP;
+            len = 1;
+    }
+
+    return len;
+}
+
 void GPU::SetGP0(uint32_t value)
 {
     if(m_GP0WordsRemaining == 0)
     {
         // We start a new command
-        const uint32_t opcode = ((value >> 24) & 0xFF);
-
-        uint8_t len = 0;
-        switch (opcode)
-        {
-            case 0x00:
-                m_GP0CommandMethod = &GPU::GP0NOP;
-                len = 1;
-                break;
-            case 0x28:
-                m_GP0CommandMethod = &GPU::GP0DrawQuadMonoOpaque;
-                len = 5;
-                break;
-            case 0x2C:
-                m_GP0CommandMethod = &GPU::GP0DrawQuadTextureBlendOpaque;
-                len = 9;
-                break;
-            case 0x30:
-                m_GP0CommandMethod = &GPU::GP0DrawTriShadedOpaque;
-                len = 6;
-                break;
-            case 0x38:
-                m_GP0CommandMethod = &GPU::GP0DrawQuadShadedOpaque;
-                len = 8;
-                break;
-            case 0xA0:
-                m_GP0CommandMethod = &GPU::GP0LoadImage;
-                len = 3;
-                break;
-            case 0xE1:
-                m_GP0CommandMethod = &GPU::GP0SetDrawMode;
-                len = 1;
-                break;
-            case 0xE2:
-                m_GP0CommandMethod = &GPU::GP0SetTextureWindow;
-                len = 1;
-                break;
-            case 0xE3:
-                m_GP0CommandMethod = &GPU::GP0SetDrawingAreaTopLeft;
-                len = 1;
-                break;
-            case 0xE4:
-                m_GP0CommandMethod = &GPU::GP0SetDrawingAreaBottomRight;
-                len = 1;
-                break;
-            case 0xE5:
-                m_GP0CommandMethod = &GPU::GP0SetDrawingOffset;
-                len = 1;
-                break;
-            case 0xE6:
-                m_GP0CommandMethod = &GPU::GP0SetMaskBitSetting;
-                len = 1;
-                break;
-            default:
-                assert(false && "Unhandled GP0 command");
-        }
-
-        m_GP0WordsRemaining = len;
+        m_GP0WordsRemaining = SelectGP0Command((value >> 24) & 0xFF);
         m_GP0Command.Clear();
     }
 
@@ -147,6 +474,10 @@ void GPU::SetGP0(uint32_t value)
     }
     else    // GP0Mode::IMAGE_LOAD
     {
+        // Each word holds two pixels
+        WriteImagePixel(value & 0xFFFF);
+        WriteImagePixel(value >> 16);
+
         if(m_GP0WordsRemaining == 0)
         {
             // Load done, switch back to command mode
@@ -161,17 +492,27 @@ void GPU::SetGP1(uint32_t value)
 
     switch (opcode)
     {
-        case 0x00:  // NOP
+        case 0x00:
+            Reset();
+            GP1ResetCommandBuffer();
             break;
+        case 0x01: GP1ResetCommandBuffer(); break;
+        case 0x02: GP1AcknowledgeIRQ(); break;
+        case 0x03: GP1SetDisplayEnabled(value); break;
+        case 0x04: GP1SetDMADirection(value); break;
+        case 0x05: GP1DisplayVRAMStart(value); break;
+        case 0x06: GP1SetDisplayHorizontalRange(value); break;
+        case 0x07: GP1SetDisplayVerticalRange(value); break;
+        case 0x08: GP1SetDisplayMode(value); break;
         default:
-            assert(false && "Unhandled GP0 command");
+            assert(false && "Unhandled GP1 command");
     }
 }
 
 // Retrieve value of the "read" register
 uint32_t GPU::GetRead() const
 {
-    // TODO: Implement it
+    // TODO: Implement it. Reading VRAM back must Sync with the render thread first.
     return 0;
 }
 
@@ -241,6 +582,147 @@ void GPU::Reset()
     m_GP0Mode = GP0Mode::COMMAND;
 }
 
+void GPU::Save(Utils::StateWriter& writer, bool includeVRAM) const
+{
+    writer.Write(m_pageBaseX);
+    writer.Write(m_pageBaseY);
+    writer.Write(m_semiTransparency);
+    writer.Write(m_textureDepth);
+    writer.Write(m_dithering);
+    writer.Write(m_allowToDisplay);
+    writer.Write(m_forceSetMaskBit);
+    writer.Write(m_preserveMaskedPixels);
+    writer.Write(m_field);
+    writer.Write(m_disableTexture);
+    writer.Write(m_hRes);
+    writer.Write(m_vRes);
+    writer.Write(m_vMode);
+    writer.Write(m_displayDepth);
+    writer.Write(m_interlaced);
+    writer.Write(m_displayDisabled);
+    writer.Write(m_interrupt);
+    writer.Write(m_dmaDirection);
+    writer.Write(m_rectangleTextureFlipX);
+    writer.Write(m_rectangleTextureFlipY);
+    writer.Write(m_textureWindowMaskX);
+    writer.Write(m_textureWindowMaskY);
+    writer.Write(m_textureWindowOffsetX);
+    writer.Write(m_textureWindowOffsetY);
+    writer.Write(m_drawingAreaLeft);
+    writer.Write(m_drawingAreaTop);
+    writer.Write(m_drawingAreaRight);
+    writer.Write(m_drawingAreaBottom);
+    writer.Write(m_drawingOffsetX);
+    writer.Write(m_drawingOffsetY);
+    writer.Write(m_displayVRAMStartX);
+    writer.Write(m_displayVRAMStartY);
+    writer.Write(m_displayHorizStart);
+    writer.Write(m_displayHorizEnd);
+    writer.Write(m_displayLineStart);
+    writer.Write(m_displayLineEnd);
+
+    m_GP0Command.Save(writer);
+    writer.Write(m_GP0WordsRemaining);
+    writer.Write(m_GP0Mode);
+    writer.Write(m_frameCount);
+
+    writer.Write(m_imageX);
+    writer.Write(m_imageY);
+    writer.Write(m_imageWidth);
+    writer.Write(m_imageHeight);
+    writer.Write(m_imagePixelsLoaded);
+    writer.Write(m_imageBatch);
+    writer.Write(m_imageBatchSize);
+
+    if (includeVRAM)
+    {
+        Sync();
+        m_vram.Save(writer);
+    }
+}
+
+void GPU::Load(Utils::StateReader& reader, bool includeVRAM)
+{
+    // The pending work belongs to the state replaced
+    Sync();
+
+    reader.Read(m_pageBaseX);
+    reader.Read(m_pageBaseY);
+    reader.Read(m_semiTransparency);
+    reader.Read(m_textureDepth);
+    reader.Read(m_dithering);
+    reader.Read(m_allowToDisplay);
+    reader.Read(m_forceSetMaskBit);
+    reader.Read(m_preserveMaskedPixels);
+    reader.Read(m_field);
+    reader.Read(m_disableTexture);
+    reader.Read(m_hRes);
+    reader.Read(m_vRes);
+    reader.Read(m_vMode);
+    reader.Read(m_displayDepth);
+    reader.Read(m_interlaced);
+    reader.Read(m_displayDisabled);
+    reader.Read(m_interrupt);
+    reader.Read(m_dmaDirection);
+    reader.Read(m_rectangleTextureFlipX);
+    reader.Read(m_rectangleTextureFlipY);
+    reader.Read(m_textureWindowMaskX);
+    reader.Read(m_textureWindowMaskY);
+    reader.Read(m_textureWindowOffsetX);
+    reader.Read(m_textureWindowOffsetY);
+    reader.Read(m_drawingAreaLeft);
+    reader.Read(m_drawingAreaTop);
+    reader.Read(m_drawingAreaRight);
+    reader.Read(m_drawingAreaBottom);
+    reader.Read(m_drawingOffsetX);
+    reader.Read(m_drawingOffsetY);
+    reader.Read(m_displayVRAMStartX);
+    reader.Read(m_displayVRAMStartY);
+    reader.Read(m_displayHorizStart);
+    reader.Read(m_displayHorizEnd);
+    reader.Read(m_displayLineStart);
+    reader.Read(m_displayLineEnd);
+
+    m_GP0Command.Load(reader);
+    reader.Read(m_GP0WordsRemaining);
+    reader.Read(m_GP0Mode);
+    reader.Read(m_frameCount);
+
+    reader.Read(m_imageX);
+    reader.Read(m_imageY);
+    reader.Read(m_imageWidth);
+    reader.Read(m_imageHeight);
+    reader.Read(m_imagePixelsLoaded);
+    reader.Read(m_imageBatch);
+    reader.Read(m_imageBatchSize);
+
+    // Never trust the size enough to read out of bounds
+    m_imageBatchSize = static_cast<uint16_t>(std::min<uint32_t>({ m_imageBatchSize, IMAGE_BATCH_SIZE, m_imagePixelsLoaded }));
+
+    // The pixels of an image being loaded are placed by dividing by its size
+    const bool isImageLoad = m_GP0Mode == GP0Mode::IMAGE_LOAD;
+    if ((m_GP0Mode != GP0Mode::COMMAND && !isImageLoad) ||
+        (isImageLoad && (m_imageWidth == 0 || m_imageWidth > VRAM::WIDTH || m_imageHeight == 0 || m_imageHeight > VRAM::HEIGHT)))
+    {
+        reader.Fail();
+        m_GP0Mode = GP0Mode::COMMAND;
+        m_GP0WordsRemaining = 0;
+        m_imageBatchSize = 0;
+        return;
+    }
+
+    if (includeVRAM)
+    {
+        m_vram.Load(reader);
+    }
+
+    // The method of a partially received command is found from its opcode
+    if (m_GP0Mode == GP0Mode::COMMAND && m_GP0WordsRemaining != 0)
+    {
+        SelectGP0Command((m_GP0Command[0] >> 24) & 0xFF);
+    }
+}
+
 void GPU::GP1SetDisplayMode(uint32_t value)
 {
     const uint8_t hr1 = value & 3;
@@ -345,23 +827,45 @@ void GPU::GP1SetDisplayVerticalRange(uint32_t value)
 
 void GPU::GP0NOP() { }
 
-void GPU::GP0DrawQuadMonoOpaque() { }
+void GPU::GP0DrawQuadMonoOpaque()
+{
+    PrimitiveRecord record{};
+    Primitive& primitive = record.m_primitive;
+    primitive.m_vertexCount = 4;
+    primitive.m_settings = GetDrawSettings();
+
+    for (uint32_t iVertex = 0; iVertex < primitive.m_vertexCount; ++iVertex)
+    {
+        primitive.m_vertices[iVertex] = GetVertex(iVertex + 1);
+        primitive.m_vertices[iVertex].m_color = m_GP0Command[0] & 0xFFFFFF;
+    }
+
+    Submit(record);
+}
 
 void GPU::GP0LoadImage()
 {
-    // Parameter 2 contains the image resolution
+    // Parameter 1 contains the destination of the image
+    const uint32_t destination = m_GP0Command[1];
+
+    m_imageX = destination & 0x3FF;
+    m_imageY = (destination >> 16) & 0x1FF;
+
+    // Parameter 2 contains the image resolution. 0 stands for the whole VRAM
     const uint32_t resolution = m_GP0Command[2];
 
-    const uint32_t width = resolution & 0xFFFF;
-    const uint32_t height = resolution >> 16;
+    m_imageWidth = static_cast<uint16_t>((((resolution & 0xFFFF) - 1) & 0x3FF) + 1);
+    m_imageHeight = static_cast<uint16_t>((((resolution >> 16) - 1) & 0x1FF) + 1);
+    m_imagePixelsLoaded = 0;
+    m_imageBatchSize = 0;
 
     // Size of the image in 16bit pixels
-    uint32_t imageSize = width * height;
+    uint32_t imageSize = static_cast<uint32_t>(m_imageWidth) * m_imageHeight;
 
     // If we have an odd number of pixels we must round it up
     // since we transfer 32 bits at a time. There'll be
     // 16 bits of padding in the last word.
-    imageSize = (imageSize + 1) & !1;
+    imageSize = (imageSize + 1) & ~1u;
 
     // Store number of words expected for this image
     m_GP0WordsRemaining = imageSize / 2;
@@ -384,11 +888,182 @@ void GPU::GP0StoreImage()
     //const uint32_t height = resolution >> 16;
 }
 
-void GPU::GP0DrawQuadShadedOpaque() { }
+void GPU::GP0DrawQuadShadedOpaque()
+{
+    PrimitiveRecord record{};
+    Primitive& primitive = record.m_primitive;
+    primitive.m_shading = Rasterizer::Shading::GOURAUD;
+    primitive.m_vertexCount = 4;
+    primitive.m_settings = GetDrawSettings();
+
+    for (uint32_t iVertex = 0; iVertex < primitive.m_vertexCount; ++iVertex)
+    {
+        primitive.m_vertices[iVertex] = GetVertex(iVertex * 2 + 1);
+        primitive.m_vertices[iVertex].m_color = m_GP0Command[iVertex * 2] & 0xFFFFFF;
+    }
+
+    Submit(record);
+}
+
+void GPU::GP0DrawTriShadedOpaque()
+{
+    PrimitiveRecord record{};
+    Primitive& primitive = record.m_primitive;
+    primitive.m_shading = Rasterizer::Shading::GOURAUD;
+    primitive.m_vertexCount = 3;
+    primitive.m_settings = GetDrawSettings();
+
+    for (uint32_t iVertex = 0; iVertex < primitive.m_vertexCount; ++iVertex)
+    {
+        primitive.m_vertices[iVertex] = GetVertex(iVertex * 2 + 1);
+        primitive.m_vertices[iVertex].m_color = m_GP0Command[iVertex * 2] & 0xFFFFFF;
+    }
+
+    Submit(record);
+}
+
+void GPU::GP0DrawQuadTextureBlendOpaque()
+{
+    // Each vertex is followed by its texture coordinates. The upper halves of the
+    // first two hold the palette and the texture page.
+    PrimitiveRecord record{};
+    Primitive& primitive = record.m_primitive;
+    primitive.m_texturing = Rasterizer::Texturing::BLENDED;
+    primitive.m_vertexCount = 4;
+
+    for (uint32_t iVertex = 0; iVertex < primitive.m_vertexCount; ++iVertex)
+    {
+        const uint32_t texCoord = m_GP0Command[iVertex * 2 + 2];
+
+        Vertex& vertex = primitive.m_vertices[iVertex];
+        vertex = GetVertex(iVertex * 2 + 1);
+        vertex.m_color = m_GP0Command[0] & 0xFFFFFF;
+        vertex.m_u = texCoord & 0xFF;
+        vertex.m_v = (texCoord >> 8) & 0xFF;
+    }
+
+    const uint32_t clut = m_GP0Command[2] >> 16;
+    const uint32_t page = m_GP0Command[4] >> 16;
+
+    // The texture page of the primitive replaces the one of the draw mode
+    m_pageBaseX = page & 0xF;
+    m_pageBaseY = (page >> 4) & 1;
+    m_semiTransparency = (page >> 5) & 3;
+    switch ((page >> 7) & 3)
+    {
+        case 0: m_textureDepth = TextureDepth::T4BIT; break;
+        case 1: m_textureDepth = TextureDepth::T8BIT; break;
+        default: m_textureDepth = TextureDepth::T15BIT; break;
+    }
+
+    primitive.m_settings = GetDrawSettings();
+
+    TextureSettings& texture = primitive.m_texture;
+    texture.m_pageX = m_pageBaseX * 64u;
+    texture.m_pageY = m_pageBaseY * 256u;
+    texture.m_depth = m_textureDepth;
+    texture.m_clutX = (clut & 0x3F) * 16;
+    texture.m_clutY = (clut >> 6) & 0x1FF;
+    texture.m_windowMaskX = m_textureWindowMaskX;
+    texture.m_windowMaskY = m_textureWindowMaskY;
+    texture.m_windowOffsetX = m_textureWindowOffsetX;
+    texture.m_windowOffsetY = m_textureWindowOffsetY;
+
+    Submit(record);
+}
 
-void GPU::GP0DrawTriShadedOpaque() { }
+// The GPU texture cache isn't emulated
+void GPU::GP0ClearCache() { }
 
-void GPU::GP0DrawQuadTextureBlendOpaque() { }
+// Raises the GPU interrupt, until GP1(02h) acknowledges it.
+// Requested again while still raised, it isn't seen by the interrupt controller.
+void GPU::GP0RequestIRQ()
+{
+    if (!m_interrupt)
+    {
+        m_interrupt = true;
+        m_interruptController->Request(Interrupt::GPU);
+    }
+}
+
+// Fills a rectangle of VRAM with a color
+void GPU::GP0FillRectangle()
+{
+    // The position and the width are in steps of 16 pixels
+    const uint32_t position = m_GP0Command[1];
+    const uint32_t size = m_GP0Command[2];
+
+    FillRecord record{};
+    record.m_x = position & 0x3F0;
+    record.m_y = (position >> 16) & 0x1FF;
+    record.m_width = ((size & 0x3FF) + 0xF) & ~0xFu;
+    record.m_height = (size >> 16) & 0x1FF;
+    record.m_pixel = ToPixel(m_GP0Command[0]);
+
+    Submit(record);
+}
+
+// Vertex coordinates found in the word <position> of the current command
+Vertex GPU::GetVertex(uint32_t position) const
+{
+    const uint32_t value = m_GP0Command[position];
+
+    Vertex vertex;
+    vertex.m_x = SignExtend11(value & 0x7FF) + static_cast<int16_t>(m_drawingOffsetX);
+    vertex.m_y = SignExtend11((value >> 16) & 0x7FF) + static_cast<int16_t>(m_drawingOffsetY);
+
+    return vertex;
+}
+
+DrawSettings GPU::GetDrawSettings() const
+{
+    DrawSettings settings;
+    settings.m_areaLeft = m_drawingAreaLeft;
+    settings.m_areaTop = m_drawingAreaTop;
+    settings.m_areaRight = m_drawingAreaRight;
+    settings.m_areaBottom = m_drawingAreaBottom;
+    settings.m_dithering = m_dithering;
+    settings.m_forceSetMaskBit = m_forceSetMaskBit;
+    settings.m_preserveMaskedPixels = m_preserveMaskedPixels;
+
+    return settings;
+}
+
+// Store the next pixel of the image being loaded. The padding of odd sized images is dropped.
+// Pixels are batched until their line of the image is complete, so that each line takes as few records as possible.
+void GPU::WriteImagePixel(uint16_t pixel)
+{
+    const uint32_t imageSize = static_cast<uint32_t>(m_imageWidth) * m_imageHeight;
+    if (m_imagePixelsLoaded >= imageSize)
+    {
+        return;
+    }
+
+    m_imageBatch[m_imageBatchSize++] = pixel;
+    ++m_imagePixelsLoaded;
+
+    if (m_imageBatchSize == IMAGE_BATCH_SIZE || (m_imagePixelsLoaded % m_imageWidth) == 0)
+    {
+        SubmitImageBatch();
+    }
+}
+
+void GPU::SubmitImageBatch()
+{
+    // Position of the first pixel of the batch, which never spans two lines of the image
+    const uint32_t firstPixel = m_imagePixelsLoaded - m_imageBatchSize;
+
+    ImageRecord record{};
+    record.m_x = (m_imageX + firstPixel % m_imageWidth) % VRAM::WIDTH;
+    record.m_y = (m_imageY + firstPixel / m_imageWidth) % VRAM::HEIGHT;
+    record.m_pixelCount = m_imageBatchSize;
+    record.m_forceSetMaskBit = m_forceSetMaskBit;
+    record.m_preserveMaskedPixels = m_preserveMaskedPixels;
+    std::copy_n(m_imageBatch.begin(), m_imageBatchSize, record.m_pixels.begin());
+    m_imageBatchSize = 0;
+
+    Submit(record);
+}
 
 void GPU::GP1AcknowledgeIRQ()
 {
@@ -400,4 +1075,5 @@ void GPU::GP1ResetCommandBuffer()
     m_GP0Command.Clear();
     m_GP0WordsRemaining = 0;
     m_GP0Mode = GP0Mode::COMMAND;
+    m_imageBatchSize = 0;
 }
@@ -2,20 +2,21 @@
 #define GPU_H
 
 #include "commandbuffer.h"
-
+#include "rasterizer.h"
+#include "renderthread.h"
+#include "texturecache.h"
+#include "tilerasterizer.h"
+#include "vram.h"
+#include "../utils/state.h"
+
+#include <array>
 #include <cstdint>
+#include <functional>
+#include <memory>
 
 namespace PSEmu
 {
 
-// Depth of the pixel values in a texture page
-enum class TextureDepth
-{
-    T4BIT,  // 4 bits per pixel
-    T8BIT,  // 8 bits per pixel
-    T15BIT  // 15 bits per pixel
-}; 
-
 // Interlaced output splits each frame in two fields
 enum class Field
 {
@@ -78,19 +79,60 @@ enum class GP0Mode
     IMAGE_LOAD
 };
 
+class InterruptController;
+class Scheduler;
+
 class GPU
 {
+public:
+    // Called at the end of each frame sent to the display
+    using FrameHandler = std::function<void(const GPU&)>;
+
+    // Most pixels of an image being loaded passed to the VRAM at once, filling a render record
+    static constexpr uint16_t IMAGE_BATCH_SIZE = 124;
+
 public:
     GPU();
 
 public:
+    void Connect(Scheduler& scheduler, InterruptController& interruptController);
+
+    uint32_t GetCyclesPerFrame() const;
+    uint64_t GetFrameCount() const;
+
+    void SetFrameHandler(FrameHandler handler);
+
+    // Frames emulated with the output disabled aren't sent to the display (see RunAhead)
+    void SetOutputEnabled(bool enabled);
+
+    // The GP0 commands are decoded as they are written, but their VRAM work runs on a thread of its own.
+    // The registers stay on the calling thread, so that reading GPUSTAT doesn't wait for the rendering:
+    // only the accesses to the VRAM do. The GPU must not move while the thread runs.
+    void SetRenderThreadEnabled(bool enabled);
+
+    // Primitives are drawn in parallel by <count> threads, including the one executing the GP0 commands.
+    // Like the render thread, the GPU must not move while they run.
+    void SetRasterizerThreadCount(size_t count);
+
     uint32_t GetStatus() const;
     void SetGP0(uint32_t value);
     void SetGP1(uint32_t value);
     uint32_t GetRead() const;
 
+    // Wait for the render thread to complete the commands written so far
+    VRAM& GetVRAM();
+    const VRAM& GetVRAM() const;
+
+    Rasterizer& GetRasterizer();
+
+    // The VRAM content can be left to the caller (see RewindBuffer)
+    void Save(Utils::StateWriter& writer, bool includeVRAM = true) const;
+    void Load(Utils::StateReader& reader, bool includeVRAM = true);
+
 private:    // GP0 commands
     void GP0ClearCache();
+    void GP0RequestIRQ();
+    void GP0FillRectangle();
     void GP0DrawQuadMonoOpaque();
     void GP0DrawQuadShadedOpaque();
     void GP0DrawQuadTextureBlendOpaque();
@@ -118,6 +160,18 @@ private:    // GP1 commands
 private:    // Utilities
     uint32_t Read() const { return 0; }
     void Reset();
+    uint8_t SelectGP0Command(uint32_t opcode);
+    Vertex GetVertex(uint32_t position) const;
+    DrawSettings GetDrawSettings() const;
+    void WriteImagePixel(uint16_t pixel);
+    void SubmitImageBatch();
+
+    // VRAM work is passed to the render thread as records, or executed right away without it
+    template <typename TRecord>
+    void Submit(const TRecord& record);
+    void Sync() const;
+
+    void OnVBlank(uint64_t cycle);
 
 private:
     // Texture page base X coordinate (4 bits, 64 byte increment)
@@ -241,6 +295,38 @@ private:
 
     // Current mode of the GP0 register
     GP0Mode m_GP0Mode;
+
+    // Number of frames output since power on
+    uint64_t m_frameCount;
+
+    FrameHandler m_frameHandler;
+    bool m_outputEnabled;
+
+    VRAM m_vram;
+    Rasterizer m_rasterizer;
+    TextureCache m_textureCache;
+
+    // Destination of the image being loaded in VRAM
+    uint16_t m_imageX;
+    uint16_t m_imageY;
+    uint16_t m_imageWidth;
+    uint16_t m_imageHeight;
+
+    // Number of pixels of the image loaded so far
+    uint32_t m_imagePixelsLoaded;
+
+    // Pixels loaded but not passed to the VRAM yet, like the words of a command being received
+    std::array<uint16_t, IMAGE_BATCH_SIZE> m_imageBatch;
+    uint16_t m_imageBatchSize;
+
+    // Set by Connect
+    Scheduler* m_scheduler;
+    InterruptController* m_interruptController;
+
+    // Both only touch the VRAM, the rasterizer and the texture cache, so they are stopped before them.
+    // The render thread uses the tile rasterizer, so it is stopped first.
+    std::unique_ptr<TileRasterizer> m_tileRasterizer;
+    std::unique_ptr<RenderThread> m_renderThread;
 };
 
 }   // end namespace PSEmu
@@ -0,0 +1,361 @@
+#include "rasterizer.h"
+
+#include "spankernels.h"
+#include "vram.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+using namespace PSEmu;
+
+namespace
+{
+
+// The GPU skips primitives larger than this
+constexpr int32_t MAX_PRIMITIVE_WIDTH = 1023;
+constexpr int32_t MAX_PRIMITIVE_HEIGHT = 511;
+
+// Interpolated values are 16.16 fixed point numbers
+constexpr int32_t FIXED_POINT_SHIFT = 16;
+constexpr int64_t FIXED_POINT_HALF = int64_t{ 1 } << (FIXED_POINT_SHIFT - 1);
+
+// Offsets added to the 8 bit color components before they are truncated to 5 bits.
+// Without dithering, nothing is added.
+constexpr std::array<DitherRow, 4> DITHER_MATRIX = {{
+    { -4,  0, -3,  1 },
+    {  2, -2,  3, -1 },
+    { -3,  1, -4,  0 },
+    {  3, -1,  2, -2 }
+}};
+constexpr DitherRow NO_DITHER = { 0, 0, 0, 0 };
+
+// Rounds towards minus infinity, unlike the division operator. <den> must be positive.
+int64_t FloorDiv(int64_t num, int64_t den)
+{
+    const int64_t quotient = num / den;
+    return ((num % den) != 0 && num < 0) ? quotient - 1 : quotient;
+}
+
+int64_t CeilDiv(int64_t num, int64_t den)
+{
+    return -FloorDiv(-num, den);
+}
+
+// Twice the signed area of the triangle <a>, <b>, <c>: positive when the vertices go clockwise on screen
+int64_t GetDoubleArea(const Vertex& a, const Vertex& b, const Vertex& c)
+{
+    return static_cast<int64_t>(b.m_x - a.m_x) * (c.m_y - a.m_y) - static_cast<int64_t>(b.m_y - a.m_y) * (c.m_x - a.m_x);
+}
+
+// E(x, y) = a * x + b * y + c is 0 on the edge and positive on the side of the triangle
+struct Edge
+{
+    int64_t m_a;
+    int64_t m_b;
+    int64_t m_c;
+
+    // Pixels exactly on the edge are only drawn for top and left edges, so that
+    // triangles sharing an edge don't draw it twice
+    int64_t m_threshold;
+};
+
+Edge MakeEdge(const Vertex& from, const Vertex& to)
+{
+    Edge edge;
+    edge.m_a = from.m_y - to.m_y;
+    edge.m_b = to.m_x - from.m_x;
+    edge.m_c = -edge.m_a * from.m_x - edge.m_b * from.m_y;
+    edge.m_threshold = (edge.m_a > 0 || (edge.m_a == 0 && edge.m_b > 0)) ? 0 : 1;
+
+    return edge;
+}
+
+// Shrink [<xMin>, <xMax>] to the pixels of the line <y> on the inside of <edge>
+void ClipSpan(const Edge& edge, int32_t y, int64_t& xMin, int64_t& xMax)
+{
+    // Solve a * x + k >= threshold
+    const int64_t k = edge.m_b * y + edge.m_c;
+
+    if (edge.m_a > 0)
+    {
+        xMin = std::max(xMin, CeilDiv(edge.m_threshold - k, edge.m_a));
+    }
+    else if (edge.m_a < 0)
+    {
+        xMax = std::min(xMax, FloorDiv(k - edge.m_threshold, -edge.m_a));
+    }
+    else if (k < edge.m_threshold)
+    {
+        xMax = xMin - 1;
+    }
+}
+
+// Plane interpolating a value given at each vertex: value(x, y) = origin + dx * x + dy * y
+struct Gradient
+{
+    int64_t m_origin;
+    int32_t m_dx;
+    int32_t m_dy;
+
+    int32_t At(int32_t x, int32_t y) const
+    {
+        return static_cast<int32_t>(m_origin + static_cast<int64_t>(m_dx) * x + static_cast<int64_t>(m_dy) * y);
+    }
+};
+
+// Fixed point step of <delta> / <area>. The steps of slivers, a few pixels in area and hundreds long,
+// can be too steep for 32 bits: they are clamped.
+int32_t MakeStep(int64_t delta, int64_t area)
+{
+    const int64_t step = delta * (int64_t{ 1 } << FIXED_POINT_SHIFT) / area;
+    return static_cast<int32_t>(std::clamp<int64_t>(step, std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max()));
+}
+
+Gradient MakeGradient(const std::array<Vertex, 3>& vertices, int64_t area, int32_t value0, int32_t value1, int32_t value2)
+{
+    const Vertex& v0 = vertices[0];
+    const Vertex& v1 = vertices[1];
+    const Vertex& v2 = vertices[2];
+
+    const int64_t delta1 = value1 - value0;
+    const int64_t delta2 = value2 - value0;
+
+    Gradient gradient;
+    gradient.m_dx = MakeStep(delta1 * (v2.m_y - v0.m_y) - delta2 * (v1.m_y - v0.m_y), area);
+    gradient.m_dy = MakeStep(delta2 * (v1.m_x - v0.m_x) - delta1 * (v2.m_x - v0.m_x), area);
+
+    // Rounded to the nearest so that the values stay within the ones of the vertices
+    gradient.m_origin = (static_cast<int64_t>(value0) << FIXED_POINT_SHIFT) + FIXED_POINT_HALF -
+                        static_cast<int64_t>(gradient.m_dx) * v0.m_x - static_cast<int64_t>(gradient.m_dy) * v0.m_y;
+
+    return gradient;
+}
+
+Gradient MakeConstantGradient(int32_t value)
+{
+    return { (static_cast<int64_t>(value) << FIXED_POINT_SHIFT) + FIXED_POINT_HALF, 0, 0 };
+}
+
+uint32_t GetRed(uint32_t color) { return color & 0xFF; }
+uint32_t GetGreen(uint32_t color) { return (color >> 8) & 0xFF; }
+uint32_t GetBlue(uint32_t color) { return (color >> 16) & 0xFF; }
+
+// 15 bit pixel from a 24 bit BGR color
+uint16_t ToPixel(uint32_t color)
+{
+    return static_cast<uint16_t>((GetRed(color) >> 3) | ((GetGreen(color) >> 3) << 5) | ((GetBlue(color) >> 3) << 10));
+}
+
+}   // end anonymous namespace
+
+Rasterizer::Rasterizer() : m_spanKernels{ &SpanKernels::Get(SpanKernels::GetBestSupported()) } { }
+
+void Rasterizer::SetSpanKernels(const SpanKernels& kernels)
+{
+    m_spanKernels = &kernels;
+}
+
+template <Rasterizer::Shading TShading, Rasterizer::Texturing TTexturing>
+void Rasterizer::DrawTriangle(VRAM& vram, std::array<Vertex, 3> vertices, const DrawSettings& settings,
+                              const TextureSettings& texture)
+{
+    // The edge functions expect the vertices in clockwise order
+    int64_t area = GetDoubleArea(vertices[0], vertices[1], vertices[2]);
+    if (area == 0)
+    {
+        return;
+    }
+    else if (area < 0)
+    {
+        std::swap(vertices[1], vertices[2]);
+        area = -area;
+    }
+
+    const auto [minX, maxX] = std::minmax({ vertices[0].m_x, vertices[1].m_x, vertices[2].m_x });
+    const auto [minY, maxY] = std::minmax({ vertices[0].m_y, vertices[1].m_y, vertices[2].m_y });
+    if (maxX - minX > MAX_PRIMITIVE_WIDTH || maxY - minY > MAX_PRIMITIVE_HEIGHT)
+    {
+        return;
+    }
+
+    // Only the pixels in the drawing area are drawn
+    const int32_t left = std::max({ minX, settings.m_areaLeft, 0 });
+    const int32_t right = std::min({ maxX, settings.m_areaRight, static_cast<int32_t>(VRAM::WIDTH - 1) });
+    const int32_t top = std::max({ minY, settings.m_areaTop, 0 });
+    const int32_t bottom = std::min({ maxY, settings.m_areaBottom, static_cast<int32_t>(VRAM::HEIGHT - 1) });
+    if (left > right || top > bottom)
+    {
+        return;
+    }
+
+    const std::array<Edge, 3> edges = { MakeEdge(vertices[0], vertices[1]),
+                                        MakeEdge(vertices[1], vertices[2]),
+                                        MakeEdge(vertices[2], vertices[0]) };
+
+    auto makeColorGradient = [&](uint32_t (*getComponent)(uint32_t))
+    {
+        if constexpr (TShading == Shading::GOURAUD)
+        {
+            return MakeGradient(vertices, area, getComponent(vertices[0].m_color), getComponent(vertices[1].m_color),
+                                getComponent(vertices[2].m_color));
+        }
+        else
+        {
+            return MakeConstantGradient(getComponent(vertices[0].m_color));
+        }
+    };
+
+    const Gradient red = makeColorGradient(GetRed);
+    const Gradient green = makeColorGradient(GetGreen);
+    const Gradient blue = makeColorGradient(GetBlue);
+
+    Gradient u{};
+    Gradient v{};
+    if constexpr (TTexturing == Texturing::BLENDED)
+    {
+        u = MakeGradient(vertices, area, vertices[0].m_u, vertices[1].m_u, vertices[2].m_u);
+        v = MakeGradient(vertices, area, vertices[0].m_v, vertices[1].m_v, vertices[2].m_v);
+    }
+
+    const uint16_t flatPixel = ToPixel(vertices[0].m_color);
+
+    for (int32_t y = top; y <= bottom; ++y)
+    {
+        int64_t spanStart = left;
+        int64_t spanEnd = right;
+        for (const Edge& edge : edges)
+        {
+            ClipSpan(edge, y, spanStart, spanEnd);
+        }
+
+        if (spanStart > spanEnd)
+        {
+            continue;
+        }
+
+        const int32_t x = static_cast<int32_t>(spanStart);
+        const int32_t count = static_cast<int32_t>(spanEnd - spanStart + 1);
+        uint16_t* dst = vram.GetLineForWrite(y) + x;
+
+        // Flat primitives aren't dithered
+        const DitherRow& dither = settings.m_dithering ? DITHER_MATRIX[y & 3] : NO_DITHER;
+        const ColorStep color = { red.At(x, y), green.At(x, y), blue.At(x, y), red.m_dx, green.m_dx, blue.m_dx };
+
+        if constexpr (TTexturing == Texturing::BLENDED)
+        {
+            const TexCoordStep texCoord = { u.At(x, y), v.At(x, y), u.m_dx, v.m_dx };
+            m_spanKernels->m_texture(dst, vram, x, count, color, texCoord, dither, settings, texture);
+        }
+        else if constexpr (TShading == Shading::GOURAUD)
+        {
+            m_spanKernels->m_shade(dst, x, count, color, dither, settings);
+        }
+        else
+        {
+            m_spanKernels->m_fill(dst, count, flatPixel, settings);
+        }
+    }
+}
+
+void Rasterizer::Draw(VRAM& vram, const Primitive& primitive)
+{
+    if (primitive.m_shading == Shading::FLAT)
+    {
+        if (primitive.m_texturing == Texturing::NONE)
+        {
+            DrawPrimitive<Shading::FLAT, Texturing::NONE>(vram, primitive);
+        }
+        else
+        {
+            DrawPrimitive<Shading::FLAT, Texturing::BLENDED>(vram, primitive);
+        }
+    }
+    else
+    {
+        if (primitive.m_texturing == Texturing::NONE)
+        {
+            DrawPrimitive<Shading::GOURAUD, Texturing::NONE>(vram, primitive);
+        }
+        else
+        {
+            DrawPrimitive<Shading::GOURAUD, Texturing::BLENDED>(vram, primitive);
+        }
+    }
+}
+
+template <Rasterizer::Shading TShading, Rasterizer::Texturing TTexturing>
+void Rasterizer::DrawPrimitive(VRAM& vram, const Primitive& primitive)
+{
+    const std::array<Vertex, 4>& vertices = primitive.m_vertices;
+
+    DrawTriangle<TShading, TTexturing>(vram, { vertices[0], vertices[1], vertices[2] }, primitive.m_settings,
+                                       primitive.m_texture);
+    if (primitive.m_vertexCount == 4)
+    {
+        DrawTriangle<TShading, TTexturing>(vram, { vertices[1], vertices[2], vertices[3] }, primitive.m_settings,
+                                           primitive.m_texture);
+    }
+}
+
+uint32_t TextureSettings::GetPageWidth() const
+{
+    switch (m_depth)
+    {
+        case TextureDepth::T4BIT: return PAGE_SIZE / 4;
+        case TextureDepth::T8BIT: return PAGE_SIZE / 2;
+        default: return PAGE_SIZE;
+    }
+}
+
+uint32_t TextureSettings::GetPaletteWidth() const
+{
+    switch (m_depth)
+    {
+        case TextureDepth::T4BIT: return 16;
+        case TextureDepth::T8BIT: return 256;
+        default: return 0;
+    }
+}
+
+bool Primitive::GetBounds(int32_t& left, int32_t& top, int32_t& right, int32_t& bottom) const
+{
+    const auto vertices = m_vertices.begin();
+    const auto [minX, maxX] = std::minmax_element(vertices, vertices + m_vertexCount,
+                                                  [](const Vertex& a, const Vertex& b) { return a.m_x < b.m_x; });
+    const auto [minY, maxY] = std::minmax_element(vertices, vertices + m_vertexCount,
+                                                  [](const Vertex& a, const Vertex& b) { return a.m_y < b.m_y; });
+
+    left = std::max({ minX->m_x, m_settings.m_areaLeft, 0 });
+    right = std::min({ maxX->m_x, m_settings.m_areaRight, static_cast<int32_t>(VRAM::WIDTH - 1) });
+    top = std::max({ minY->m_y, m_settings.m_areaTop, 0 });
+    bottom = std::min({ maxY->m_y, m_settings.m_areaBottom, static_cast<int32_t>(VRAM::HEIGHT - 1) });
+    return left <= right && top <= bottom;
+}
+
+// The page and the palette wrap around the right edge of the VRAM, but not the bottom one
+bool Primitive::DrawsOverTexels() const
+{
+    int32_t left = 0;
+    int32_t top = 0;
+    int32_t right = 0;
+    int32_t bottom = 0;
+    if (m_texturing == Rasterizer::Texturing::NONE || !GetBounds(left, top, right, bottom))
+    {
+        return false;
+    }
+
+    auto overlaps = [&](uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+    {
+        const int32_t areaLeft = static_cast<int32_t>(x % VRAM::WIDTH);
+        const int32_t areaRight = areaLeft + static_cast<int32_t>(width) - 1;
+        const int32_t areaTop = static_cast<int32_t>(y % VRAM::HEIGHT);
+        const int32_t areaBottom = areaTop + static_cast<int32_t>(height) - 1;
+
+        return width != 0 && top <= areaBottom && areaTop <= bottom &&
+               ((left <= areaRight && areaLeft <= right) || left <= areaRight - static_cast<int32_t>(VRAM::WIDTH));
+    };
+
+    return overlaps(m_texture.m_pageX, m_texture.m_pageY, m_texture.GetPageWidth(), TextureSettings::PAGE_SIZE) ||
+           overlaps(m_texture.m_clutX, m_texture.m_clutY, m_texture.GetPaletteWidth(), 1);
+}
@@ -0,0 +1,137 @@
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include <array>
+#include <cstdint>
+
+namespace PSEmu
+{
+
+class VRAM;
+struct SpanKernels;
+
+// Depth of the pixel values in a texture page
+enum class TextureDepth
+{
+    T4BIT,  // 4 bits per pixel
+    T8BIT,  // 8 bits per pixel
+    T15BIT  // 15 bits per pixel
+};
+
+// Vertex of a primitive, in VRAM coordinates (the drawing offset is already applied)
+struct Vertex
+{
+    int32_t m_x = 0;
+    int32_t m_y = 0;
+    uint32_t m_color = 0;   /**< 24 bit BGR color, as found in the GP0 commands */
+    uint8_t m_u = 0;        /**< Texture coordinates, in texels of the texture page */
+    uint8_t m_v = 0;
+};
+
+// Drawing state of the GPU applying to every primitive
+struct DrawSettings
+{
+    // Inclusive bounds of the drawing area
+    int32_t m_areaLeft = 0;
+    int32_t m_areaTop = 0;
+    int32_t m_areaRight = 0;
+    int32_t m_areaBottom = 0;
+
+    bool m_dithering = false;
+    bool m_forceSetMaskBit = false;
+    bool m_preserveMaskedPixels = false;
+};
+
+// Where the texels of a textured primitive come from
+struct TextureSettings
+{
+    static constexpr uint32_t PAGE_SIZE = 256;  /**< Texels on each side of a texture page */
+
+    uint32_t m_pageX = 0;           /**< Texture page, in VRAM pixels */
+    uint32_t m_pageY = 0;
+    TextureDepth m_depth = TextureDepth::T4BIT;
+    uint32_t m_clutX = 0;           /**< Palette of the 4 and 8 bit textures, in VRAM pixels */
+    uint32_t m_clutY = 0;
+
+    // Texture window, in 8 texels steps
+    uint8_t m_windowMaskX = 0;
+    uint8_t m_windowMaskY = 0;
+    uint8_t m_windowOffsetX = 0;
+    uint8_t m_windowOffsetY = 0;
+
+    // Texels of the page decoded to 15 bits, line after line, before the texture window is applied.
+    // Sampled from the VRAM when null (see TextureCache).
+    const uint16_t* m_texels = nullptr;
+
+    // VRAM pixels holding a line of the page, and the palette (0 for 15 bit textures)
+    uint32_t GetPageWidth() const;
+    uint32_t GetPaletteWidth() const;
+};
+
+struct Primitive;
+
+// Draws the GPU primitives in VRAM with the CPU.
+// Triangles are set up with edge functions which are solved for each line covered,
+// giving the span of pixels to fill. Colors and texture coordinates are interpolated
+// across the triangle in 16.16 fixed point and stepped along the spans by the span kernels.
+// Every pixel is computed from its own coordinates: drawing a primitive in several parts,
+// each clipped to a smaller drawing area, gives the same result.
+class Rasterizer
+{
+public:
+    enum class Shading
+    {
+        FLAT,       // The color of the first vertex is used for the whole primitive
+        GOURAUD     // Colors are interpolated between the vertices
+    };
+
+    enum class Texturing
+    {
+        NONE,
+        BLENDED     // Texels are modulated by the color
+    };
+
+public:
+    // Uses the fastest span kernels supported by the host CPU
+    Rasterizer();
+
+    // E.g. the scalar kernels, to compare their output
+    void SetSpanKernels(const SpanKernels& kernels);
+
+    void Draw(VRAM& vram, const Primitive& primitive);
+
+private:
+    template <Shading TShading, Texturing TTexturing>
+    void DrawTriangle(VRAM& vram, std::array<Vertex, 3> vertices, const DrawSettings& settings,
+                      const TextureSettings& texture);
+
+    template <Shading TShading, Texturing TTexturing>
+    void DrawPrimitive(VRAM& vram, const Primitive& primitive);
+
+private:
+    const SpanKernels* m_spanKernels;
+};
+
+// Primitive with the state it is drawn with, so that it can be drawn later or on another thread
+struct Primitive
+{
+    Rasterizer::Shading m_shading = Rasterizer::Shading::FLAT;
+    Rasterizer::Texturing m_texturing = Rasterizer::Texturing::NONE;
+
+    // Quads are drawn as two triangles sharing the edge between their second and third vertices
+    uint32_t m_vertexCount = 3;
+    std::array<Vertex, 4> m_vertices;
+
+    DrawSettings m_settings;
+    TextureSettings m_texture;  /**< Only used by textured primitives */
+
+    // Inclusive bounds of the pixels which can be drawn, false when there are none
+    bool GetBounds(int32_t& left, int32_t& top, int32_t& right, int32_t& bottom) const;
+
+    // Textured primitives drawing over their page or palette read pixels they drew themselves
+    bool DrawsOverTexels() const;
+};
+
+}   // end namespace PSEmu
+
+#endif // RASTERIZER_H
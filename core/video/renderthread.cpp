@@ -0,0 +1,119 @@
+#include "renderthread.h"
+
+#include <array>
+#include <cassert>
+#include <cstring>
+
+using namespace PSEmu;
+
+namespace
+{
+
+// 256 KB of records in flight
+constexpr size_t RING_CAPACITY = 64 * 1024;
+
+constexpr size_t MAX_PAYLOAD_WORDS = RenderThread::MAX_PAYLOAD_SIZE / sizeof(uint32_t);
+
+// The header of a record holds its type and the number of words of its payload
+constexpr uint32_t HEADER_TYPE_SHIFT = 16;
+constexpr uint32_t HEADER_SIZE_MASK = 0xFFFF;
+
+// Polls for records before going to sleep, as they usually come in bursts
+constexpr uint32_t SPIN_COUNT = 256;
+
+}   // end anonymous namespace
+
+RenderThread::RenderThread(RecordHandler handler)
+    : m_ring{ RING_CAPACITY }, m_handler{ std::move(handler) }, m_submittedCount{ 0 }, m_executedCount{ 0 },
+      m_mutex{}, m_wakeUp{}, m_sleeping{ false }, m_stopping{ false }, m_thread{ &RenderThread::Run, this } { }
+
+RenderThread::~RenderThread()
+{
+    m_stopping.store(true);
+    {
+        std::lock_guard<std::mutex> lock{ m_mutex };
+        m_wakeUp.notify_one();
+    }
+
+    m_thread.join();
+}
+
+void RenderThread::Submit(uint32_t type, const void* payload, size_t size)
+{
+    assert(size <= MAX_PAYLOAD_SIZE && "Render record too large");
+
+    const size_t payloadWords = (size + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    std::array<uint32_t, MAX_PAYLOAD_WORDS + 1> record{};
+    record[0] = (type << HEADER_TYPE_SHIFT) | static_cast<uint32_t>(payloadWords);
+    std::memcpy(&record[1], payload, size);
+
+    while (!m_ring.TryWrite(record.data(), payloadWords + 1))
+    {
+        std::this_thread::yield();
+    }
+    ++m_submittedCount;
+
+    // Either the render thread sees the record before going to sleep, or we see it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_sleeping.load())
+    {
+        std::lock_guard<std::mutex> lock{ m_mutex };
+        m_wakeUp.notify_one();
+    }
+}
+
+void RenderThread::Sync()
+{
+    while (m_executedCount.load(std::memory_order_acquire) != m_submittedCount)
+    {
+        std::this_thread::yield();
+    }
+}
+
+void RenderThread::Run()
+{
+    std::array<uint32_t, MAX_PAYLOAD_WORDS> payload;
+
+    while (true)
+    {
+        uint32_t header = 0;
+        if (!m_ring.TryRead(&header, 1))
+        {
+            if (m_stopping.load() && m_ring.IsEmpty())
+            {
+                return;
+            }
+
+            WaitForRecords();
+            continue;
+        }
+
+        // Records are written whole
+        [[maybe_unused]] const bool read = m_ring.TryRead(payload.data(), header & HEADER_SIZE_MASK);
+        assert(read);
+
+        m_handler(header >> HEADER_TYPE_SHIFT, payload.data());
+
+        // Publishes what the handler wrote to the threads which sync
+        m_executedCount.store(m_executedCount.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+}
+
+void RenderThread::WaitForRecords()
+{
+    for (uint32_t iSpin = 0; iSpin < SPIN_COUNT; ++iSpin)
+    {
+        if (!m_ring.IsEmpty() || m_stopping.load())
+        {
+            return;
+        }
+        std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock{ m_mutex };
+    m_sleeping.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    m_wakeUp.wait(lock, [this]() { return !m_ring.IsEmpty() || m_stopping.load(); });
+    m_sleeping.store(false);
+}
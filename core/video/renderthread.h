@@ -0,0 +1,70 @@
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include "../utils/spscring.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace PSEmu
+{
+
+// Thread executing the work submitted by the GPU, in the order it was submitted.
+// Work is passed as records through a lock-free ring: a type and a payload of words
+// which only the handler interprets. The thread sleeps while there is nothing to do.
+class RenderThread
+{
+public:
+    // Called on the render thread for each record
+    using RecordHandler = std::function<void(uint32_t type, const uint32_t* payload)>;
+
+    static constexpr size_t MAX_PAYLOAD_SIZE = 256;
+
+public:
+    explicit RenderThread(RecordHandler handler);
+
+    // Executes the records already submitted before stopping
+    ~RenderThread();
+
+    // It should not be possible to copy or move this class: the thread keeps using it
+    RenderThread(const RenderThread&) = delete;
+    RenderThread& operator=(const RenderThread&) = delete;
+
+    RenderThread(RenderThread&&) = delete;
+    RenderThread& operator=(RenderThread&&) = delete;
+
+public:
+    // <payload> is copied. Blocks while the ring is full.
+    void Submit(uint32_t type, const void* payload, size_t size);
+
+    // Waits until every record submitted was executed
+    void Sync();
+
+private:
+    void Run();
+    void WaitForRecords();
+
+private:
+    Utils::SPSCRing<uint32_t> m_ring;
+    RecordHandler m_handler;
+
+    uint64_t m_submittedCount;              /**< Only used by the submitting thread */
+    std::atomic<uint64_t> m_executedCount;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::atomic<bool> m_sleeping;
+    std::atomic<bool> m_stopping;
+
+    // Started last, once everything it uses is initialized
+    std::thread m_thread;
+};
+
+}   // end namespace PSEmu
+
+#endif // RENDERTHREAD_H
@@ -0,0 +1,623 @@
+#include "spankernels.h"
+
+#include "vram.h"
+
+#include <algorithm>
+#include <cassert>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define PSEMU_HAS_X86_SIMD
+#endif
+
+using namespace PSEmu;
+
+namespace
+{
+
+// Interpolated values are 16.16 fixed point numbers
+constexpr int32_t FIXED_POINT_SHIFT = 16;
+
+constexpr uint16_t MASK_BIT = 0x8000;
+
+// Value of a color component <steps> pixels further along a span. The fixed point values wrap
+// around like the ones stepped pixel by pixel.
+int32_t Advance(int32_t value, int32_t step, int32_t steps)
+{
+    return static_cast<int32_t>(static_cast<uint32_t>(value) + static_cast<uint32_t>(step) * static_cast<uint32_t>(steps));
+}
+
+ColorStep Advance(ColorStep color, int32_t steps)
+{
+    color.m_r = Advance(color.m_r, color.m_dr, steps);
+    color.m_g = Advance(color.m_g, color.m_dg, steps);
+    color.m_b = Advance(color.m_b, color.m_db, steps);
+    return color;
+}
+
+TexCoordStep Advance(TexCoordStep texCoord, int32_t steps)
+{
+    texCoord.m_u = Advance(texCoord.m_u, texCoord.m_du, steps);
+    texCoord.m_v = Advance(texCoord.m_v, texCoord.m_dv, steps);
+    return texCoord;
+}
+
+// 15 bit pixel from 8 bit components, the dither offset being added first
+uint16_t ToPixel(int32_t r, int32_t g, int32_t b, int32_t dither)
+{
+    const uint32_t r5 = static_cast<uint32_t>(std::clamp(r + dither, 0, 255)) >> 3;
+    const uint32_t g5 = static_cast<uint32_t>(std::clamp(g + dither, 0, 255)) >> 3;
+    const uint32_t b5 = static_cast<uint32_t>(std::clamp(b + dither, 0, 255)) >> 3;
+
+    return static_cast<uint16_t>(r5 | (g5 << 5) | (b5 << 10));
+}
+
+// Writes <pixel> unless the pixel already there is protected by its mask bit
+void PutPixel(uint16_t* dst, uint16_t pixel, const DrawSettings& settings)
+{
+    if (settings.m_preserveMaskedPixels && (*dst & MASK_BIT) != 0)
+    {
+        return;
+    }
+
+    *dst = pixel | (settings.m_forceSetMaskBit ? MASK_BIT : 0);
+}
+
+void FillSpanScalar(uint16_t* dst, int32_t count, uint16_t pixel, const DrawSettings& settings)
+{
+    if (!settings.m_preserveMaskedPixels)
+    {
+        std::fill_n(dst, count, static_cast<uint16_t>(pixel | (settings.m_forceSetMaskBit ? MASK_BIT : 0)));
+        return;
+    }
+
+    for (int32_t iPixel = 0; iPixel < count; ++iPixel)
+    {
+        PutPixel(dst + iPixel, pixel, settings);
+    }
+}
+
+void ShadeSpanScalar(uint16_t* dst, int32_t x, int32_t count, ColorStep color, const DitherRow& dither,
+                     const DrawSettings& settings)
+{
+    for (int32_t iPixel = 0; iPixel < count; ++iPixel)
+    {
+        const uint16_t pixel = ToPixel(color.m_r >> FIXED_POINT_SHIFT, color.m_g >> FIXED_POINT_SHIFT,
+                                       color.m_b >> FIXED_POINT_SHIFT, dither[(x + iPixel) & 3]);
+        PutPixel(dst + iPixel, pixel, settings);
+
+        color = Advance(color, 1);
+    }
+}
+
+uint16_t SampleTexture(const VRAM& vram, const TextureSettings& texture, uint32_t u, uint32_t v)
+{
+    u = ((u & ~(texture.m_windowMaskX * 8u)) | ((texture.m_windowOffsetX & texture.m_windowMaskX) * 8u)) & 0xFF;
+    v = ((v & ~(texture.m_windowMaskY * 8u)) | ((texture.m_windowOffsetY & texture.m_windowMaskY) * 8u)) & 0xFF;
+
+    // Decoded by the texture cache
+    if (texture.m_texels != nullptr)
+    {
+        return texture.m_texels[v * TextureSettings::PAGE_SIZE + u];
+    }
+
+    switch (texture.m_depth)
+    {
+        case TextureDepth::T4BIT:
+        {
+            const uint16_t indices = vram.GetPixel(texture.m_pageX + u / 4, texture.m_pageY + v);
+            const uint32_t index = (indices >> ((u % 4) * 4)) & 0xF;
+            return vram.GetPixel(texture.m_clutX + index, texture.m_clutY);
+        }
+        case TextureDepth::T8BIT:
+        {
+            const uint16_t indices = vram.GetPixel(texture.m_pageX + u / 2, texture.m_pageY + v);
+            const uint32_t index = (indices >> ((u % 2) * 8)) & 0xFF;
+            return vram.GetPixel(texture.m_clutX + index, texture.m_clutY);
+        }
+        default:
+            return vram.GetPixel(texture.m_pageX + u, texture.m_pageY + v);
+    }
+}
+
+// Texels are modulated by the color: 128 leaves them unchanged. Fully transparent texels (0) are skipped.
+void TextureSpan(uint16_t* dst, const VRAM& vram, int32_t x, int32_t count, ColorStep color, TexCoordStep texCoord,
+                 const DitherRow& dither, const DrawSettings& settings, const TextureSettings& texture)
+{
+    for (int32_t iPixel = 0; iPixel < count; ++iPixel)
+    {
+        const uint16_t texel = SampleTexture(vram, texture, texCoord.m_u >> FIXED_POINT_SHIFT, texCoord.m_v >> FIXED_POINT_SHIFT);
+        if (texel != 0)
+        {
+            const int32_t r = static_cast<int32_t>(((texel & 0x1F) << 3) * static_cast<uint32_t>(color.m_r >> FIXED_POINT_SHIFT)) >> 7;
+            const int32_t g = static_cast<int32_t>((((texel >> 5) & 0x1F) << 3) * static_cast<uint32_t>(color.m_g >> FIXED_POINT_SHIFT)) >> 7;
+            const int32_t b = static_cast<int32_t>((((texel >> 10) & 0x1F) << 3) * static_cast<uint32_t>(color.m_b >> FIXED_POINT_SHIFT)) >> 7;
+
+            // The mask bit of the texel is kept
+            PutPixel(dst + iPixel, ToPixel(r, g, b, dither[(x + iPixel) & 3]) | (texel & MASK_BIT), settings);
+        }
+
+        color = Advance(color, 1);
+        texCoord = Advance(texCoord, 1);
+    }
+}
+
+constexpr SpanKernels SCALAR_KERNELS = { FillSpanScalar, ShadeSpanScalar, TextureSpan };
+
+#if defined(PSEMU_HAS_X86_SIMD)
+
+// The SIMD kernels are compiled for their instruction set whatever the target of the build,
+// and only called once CPUID reported it. Each lane holds a pixel: pixels are computed
+// as 32 bit integers, then packed to 16 bits to be written.
+
+// <value>, <value> + <step>, <value> + 2 * <step>... in each lane
+__attribute__((target("sse4.1")))
+__m128i StepLanesSSE41(int32_t value, int32_t step)
+{
+    return _mm_add_epi32(_mm_set1_epi32(value), _mm_mullo_epi32(_mm_set1_epi32(step), _mm_setr_epi32(0, 1, 2, 3)));
+}
+
+// 5 bit color components from 8 bit ones, the dither offsets being added first
+__attribute__((target("sse4.1")))
+__m128i TruncateComponentsSSE41(__m128i components, __m128i dither)
+{
+    components = _mm_add_epi32(components, dither);
+    return _mm_srli_epi32(_mm_min_epi32(_mm_max_epi32(components, _mm_setzero_si128()), _mm_set1_epi32(255)), 3);
+}
+
+// 5 bit color components from 16.16 fixed point values
+__attribute__((target("sse4.1")))
+__m128i ToComponentsSSE41(__m128i values, __m128i dither)
+{
+    return TruncateComponentsSSE41(_mm_srai_epi32(values, FIXED_POINT_SHIFT), dither);
+}
+
+__attribute__((target("sse4.1")))
+__m128i ToPixelsSSE41(__m128i r, __m128i g, __m128i b, __m128i dither)
+{
+    const __m128i gb = _mm_or_si128(_mm_slli_epi32(ToComponentsSSE41(g, dither), 5),
+                                    _mm_slli_epi32(ToComponentsSSE41(b, dither), 10));
+    return _mm_or_si128(ToComponentsSSE41(r, dither), gb);
+}
+
+// Writes 8 pixels like PutPixel
+__attribute__((target("sse4.1")))
+void PutPixelsSSE41(uint16_t* dst, __m128i pixels, const DrawSettings& settings)
+{
+    pixels = _mm_or_si128(pixels, _mm_set1_epi16(static_cast<int16_t>(settings.m_forceSetMaskBit ? MASK_BIT : 0)));
+
+    if (settings.m_preserveMaskedPixels)
+    {
+        // Pixels with their mask bit set select the previous value
+        const __m128i previous = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst));
+        pixels = _mm_blendv_epi8(pixels, previous, _mm_srai_epi16(previous, 15));
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), pixels);
+}
+
+__attribute__((target("sse4.1")))
+void FillSpanSSE41(uint16_t* dst, int32_t count, uint16_t pixel, const DrawSettings& settings)
+{
+    const __m128i pixels = _mm_set1_epi16(static_cast<int16_t>(pixel));
+
+    int32_t iPixel = 0;
+    for (; iPixel + 8 <= count; iPixel += 8)
+    {
+        PutPixelsSSE41(dst + iPixel, pixels, settings);
+    }
+
+    FillSpanScalar(dst + iPixel, count - iPixel, pixel, settings);
+}
+
+__attribute__((target("sse4.1")))
+void ShadeSpanSSE41(uint16_t* dst, int32_t x, int32_t count, ColorStep color, const DitherRow& dither,
+                    const DrawSettings& settings)
+{
+    // The dither offsets repeat every 4 pixels
+    const __m128i ditherOffsets = _mm_setr_epi32(dither[x & 3], dither[(x + 1) & 3], dither[(x + 2) & 3], dither[(x + 3) & 3]);
+
+    __m128i r = StepLanesSSE41(color.m_r, color.m_dr);
+    __m128i g = StepLanesSSE41(color.m_g, color.m_dg);
+    __m128i b = StepLanesSSE41(color.m_b, color.m_db);
+
+    const __m128i rStep = _mm_set1_epi32(Advance(0, color.m_dr, 4));
+    const __m128i gStep = _mm_set1_epi32(Advance(0, color.m_dg, 4));
+    const __m128i bStep = _mm_set1_epi32(Advance(0, color.m_db, 4));
+
+    int32_t iPixel = 0;
+    for (; iPixel + 8 <= count; iPixel += 8)
+    {
+        const __m128i low = ToPixelsSSE41(r, g, b, ditherOffsets);
+        r = _mm_add_epi32(r, rStep);
+        g = _mm_add_epi32(g, gStep);
+        b = _mm_add_epi32(b, bStep);
+
+        const __m128i high = ToPixelsSSE41(r, g, b, ditherOffsets);
+        r = _mm_add_epi32(r, rStep);
+        g = _mm_add_epi32(g, gStep);
+        b = _mm_add_epi32(b, bStep);
+
+        PutPixelsSSE41(dst + iPixel, _mm_packus_epi32(low, high), settings);
+    }
+
+    ShadeSpanScalar(dst + iPixel, x + iPixel, count - iPixel, Advance(color, iPixel), dither, settings);
+}
+
+// Texture window applied to the texture coordinates of each lane, giving the indices of the decoded texels
+struct TexelIndexer
+{
+    int32_t m_maskU, m_offsetU;
+    int32_t m_maskV, m_offsetV;
+
+    explicit TexelIndexer(const TextureSettings& texture)
+        : m_maskU{ static_cast<int32_t>(~(texture.m_windowMaskX * 8u) & 0xFF) },
+          m_offsetU{ static_cast<int32_t>(((texture.m_windowOffsetX & texture.m_windowMaskX) * 8u) & 0xFF) },
+          m_maskV{ static_cast<int32_t>(~(texture.m_windowMaskY * 8u) & 0xFF) },
+          m_offsetV{ static_cast<int32_t>(((texture.m_windowOffsetY & texture.m_windowMaskY) * 8u) & 0xFF) } { }
+};
+
+__attribute__((target("sse4.1")))
+__m128i GetTexelsSSE41(const uint16_t* texels, const TexelIndexer& indexer, __m128i u, __m128i v)
+{
+    u = _mm_or_si128(_mm_and_si128(_mm_srai_epi32(u, FIXED_POINT_SHIFT), _mm_set1_epi32(indexer.m_maskU)),
+                     _mm_set1_epi32(indexer.m_offsetU));
+    v = _mm_or_si128(_mm_and_si128(_mm_srai_epi32(v, FIXED_POINT_SHIFT), _mm_set1_epi32(indexer.m_maskV)),
+                     _mm_set1_epi32(indexer.m_offsetV));
+    const __m128i indices = _mm_or_si128(_mm_slli_epi32(v, 8), u);
+
+    return _mm_setr_epi32(texels[_mm_extract_epi32(indices, 0)], texels[_mm_extract_epi32(indices, 1)],
+                          texels[_mm_extract_epi32(indices, 2)], texels[_mm_extract_epi32(indices, 3)]);
+}
+
+__attribute__((target("sse4.1")))
+__m128i ModulateComponentsSSE41(__m128i texelComponents, __m128i values, __m128i dither)
+{
+    const __m128i components = _mm_slli_epi32(_mm_and_si128(texelComponents, _mm_set1_epi32(0x1F)), 3);
+    const __m128i modulated = _mm_srai_epi32(_mm_mullo_epi32(components, _mm_srai_epi32(values, FIXED_POINT_SHIFT)), 7);
+    return TruncateComponentsSSE41(modulated, dither);
+}
+
+// Texels modulated by the colors like TextureSpan, the mask bit of the texels being kept
+__attribute__((target("sse4.1")))
+__m128i ModulateSSE41(__m128i texels, __m128i r, __m128i g, __m128i b, __m128i dither)
+{
+    const __m128i gb = _mm_or_si128(_mm_slli_epi32(ModulateComponentsSSE41(_mm_srli_epi32(texels, 5), g, dither), 5),
+                                    _mm_slli_epi32(ModulateComponentsSSE41(_mm_srli_epi32(texels, 10), b, dither), 10));
+    const __m128i rMask = _mm_or_si128(ModulateComponentsSSE41(texels, r, dither), _mm_and_si128(texels, _mm_set1_epi32(MASK_BIT)));
+    return _mm_or_si128(rMask, gb);
+}
+
+// Writes 8 pixels like PutPixel, except where the texels are fully transparent
+__attribute__((target("sse4.1")))
+void PutTexelsSSE41(uint16_t* dst, __m128i pixels, __m128i texels, const DrawSettings& settings)
+{
+    const __m128i previous = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst));
+    __m128i kept = _mm_cmpeq_epi16(texels, _mm_setzero_si128());
+    if (settings.m_preserveMaskedPixels)
+    {
+        kept = _mm_or_si128(kept, _mm_srai_epi16(previous, 15));
+    }
+
+    pixels = _mm_or_si128(pixels, _mm_set1_epi16(static_cast<int16_t>(settings.m_forceSetMaskBit ? MASK_BIT : 0)));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_blendv_epi8(pixels, previous, kept));
+}
+
+__attribute__((target("sse4.1")))
+void TextureSpanSSE41(uint16_t* dst, const VRAM& vram, int32_t x, int32_t count, ColorStep color, TexCoordStep texCoord,
+                      const DitherRow& dither, const DrawSettings& settings, const TextureSettings& texture)
+{
+    const uint16_t* texels = texture.m_texels;
+    if (texels == nullptr)
+    {
+        TextureSpan(dst, vram, x, count, color, texCoord, dither, settings, texture);
+        return;
+    }
+
+    const TexelIndexer indexer{ texture };
+    const __m128i ditherOffsets = _mm_setr_epi32(dither[x & 3], dither[(x + 1) & 3], dither[(x + 2) & 3], dither[(x + 3) & 3]);
+
+    __m128i r = StepLanesSSE41(color.m_r, color.m_dr);
+    __m128i g = StepLanesSSE41(color.m_g, color.m_dg);
+    __m128i b = StepLanesSSE41(color.m_b, color.m_db);
+    __m128i u = StepLanesSSE41(texCoord.m_u, texCoord.m_du);
+    __m128i v = StepLanesSSE41(texCoord.m_v, texCoord.m_dv);
+
+    const __m128i rStep = _mm_set1_epi32(Advance(0, color.m_dr, 4));
+    const __m128i gStep = _mm_set1_epi32(Advance(0, color.m_dg, 4));
+    const __m128i bStep = _mm_set1_epi32(Advance(0, color.m_db, 4));
+    const __m128i uStep = _mm_set1_epi32(Advance(0, texCoord.m_du, 4));
+    const __m128i vStep = _mm_set1_epi32(Advance(0, texCoord.m_dv, 4));
+
+    int32_t iPixel = 0;
+    for (; iPixel + 8 <= count; iPixel += 8)
+    {
+        const __m128i lowTexels = GetTexelsSSE41(texels, indexer, u, v);
+        const __m128i low = ModulateSSE41(lowTexels, r, g, b, ditherOffsets);
+        r = _mm_add_epi32(r, rStep);
+        g = _mm_add_epi32(g, gStep);
+        b = _mm_add_epi32(b, bStep);
+        u = _mm_add_epi32(u, uStep);
+        v = _mm_add_epi32(v, vStep);
+
+        const __m128i highTexels = GetTexelsSSE41(texels, indexer, u, v);
+        const __m128i high = ModulateSSE41(highTexels, r, g, b, ditherOffsets);
+        r = _mm_add_epi32(r, rStep);
+        g = _mm_add_epi32(g, gStep);
+        b = _mm_add_epi32(b, bStep);
+        u = _mm_add_epi32(u, uStep);
+        v = _mm_add_epi32(v, vStep);
+
+        PutTexelsSSE41(dst + iPixel, _mm_packus_epi32(low, high), _mm_packus_epi32(lowTexels, highTexels), settings);
+    }
+
+    // The last pixels are drawn in a copy, the lanes past the span being thrown away
+    if (iPixel < count)
+    {
+        uint16_t pixels[8] = {};
+        std::copy_n(dst + iPixel, count - iPixel, pixels);
+        TextureSpanSSE41(pixels, vram, x + iPixel, 8, Advance(color, iPixel), Advance(texCoord, iPixel), dither, settings,
+                         texture);
+        std::copy_n(pixels, count - iPixel, dst + iPixel);
+    }
+}
+
+__attribute__((target("avx2")))
+__m256i StepLanesAVX2(int32_t value, int32_t step)
+{
+    return _mm256_add_epi32(_mm256_set1_epi32(value),
+                            _mm256_mullo_epi32(_mm256_set1_epi32(step), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+}
+
+__attribute__((target("avx2")))
+__m256i TruncateComponentsAVX2(__m256i components, __m256i dither)
+{
+    components = _mm256_add_epi32(components, dither);
+    return _mm256_srli_epi32(_mm256_min_epi32(_mm256_max_epi32(components, _mm256_setzero_si256()), _mm256_set1_epi32(255)), 3);
+}
+
+__attribute__((target("avx2")))
+__m256i ToComponentsAVX2(__m256i values, __m256i dither)
+{
+    return TruncateComponentsAVX2(_mm256_srai_epi32(values, FIXED_POINT_SHIFT), dither);
+}
+
+__attribute__((target("avx2")))
+__m256i ToPixelsAVX2(__m256i r, __m256i g, __m256i b, __m256i dither)
+{
+    const __m256i gb = _mm256_or_si256(_mm256_slli_epi32(ToComponentsAVX2(g, dither), 5),
+                                       _mm256_slli_epi32(ToComponentsAVX2(b, dither), 10));
+    return _mm256_or_si256(ToComponentsAVX2(r, dither), gb);
+}
+
+// Writes 16 pixels like PutPixel
+__attribute__((target("avx2")))
+void PutPixelsAVX2(uint16_t* dst, __m256i pixels, const DrawSettings& settings)
+{
+    pixels = _mm256_or_si256(pixels, _mm256_set1_epi16(static_cast<int16_t>(settings.m_forceSetMaskBit ? MASK_BIT : 0)));
+
+    if (settings.m_preserveMaskedPixels)
+    {
+        const __m256i previous = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst));
+        pixels = _mm256_blendv_epi8(pixels, previous, _mm256_srai_epi16(previous, 15));
+    }
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), pixels);
+}
+
+__attribute__((target("avx2")))
+void FillSpanAVX2(uint16_t* dst, int32_t count, uint16_t pixel, const DrawSettings& settings)
+{
+    const __m256i pixels = _mm256_set1_epi16(static_cast<int16_t>(pixel));
+
+    int32_t iPixel = 0;
+    for (; iPixel + 16 <= count; iPixel += 16)
+    {
+        PutPixelsAVX2(dst + iPixel, pixels, settings);
+    }
+
+    FillSpanScalar(dst + iPixel, count - iPixel, pixel, settings);
+}
+
+__attribute__((target("avx2")))
+void ShadeSpanAVX2(uint16_t* dst, int32_t x, int32_t count, ColorStep color, const DitherRow& dither,
+                   const DrawSettings& settings)
+{
+    const __m256i ditherOffsets = _mm256_setr_epi32(dither[x & 3], dither[(x + 1) & 3], dither[(x + 2) & 3], dither[(x + 3) & 3],
+                                                    dither[x & 3], dither[(x + 1) & 3], dither[(x + 2) & 3], dither[(x + 3) & 3]);
+
+    __m256i r = StepLanesAVX2(color.m_r, color.m_dr);
+    __m256i g = StepLanesAVX2(color.m_g, color.m_dg);
+    __m256i b = StepLanesAVX2(color.m_b, color.m_db);
+
+    const __m256i rStep = _mm256_set1_epi32(Advance(0, color.m_dr, 8));
+    const __m256i gStep = _mm256_set1_epi32(Advance(0, color.m_dg, 8));
+    const __m256i bStep = _mm256_set1_epi32(Advance(0, color.m_db, 8));
+
+    int32_t iPixel = 0;
+    for (; iPixel + 16 <= count; iPixel += 16)
+    {
+        const __m256i low = ToPixelsAVX2(r, g, b, ditherOffsets);
+        r = _mm256_add_epi32(r, rStep);
+        g = _mm256_add_epi32(g, gStep);
+        b = _mm256_add_epi32(b, bStep);
+
+        const __m256i high = ToPixelsAVX2(r, g, b, ditherOffsets);
+        r = _mm256_add_epi32(r, rStep);
+        g = _mm256_add_epi32(g, gStep);
+        b = _mm256_add_epi32(b, bStep);
+
+        // Packing works within each 128 bit half: put the pixels back in order
+        const __m256i packed = _mm256_packus_epi32(low, high);
+        PutPixelsAVX2(dst + iPixel, _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0)), settings);
+    }
+
+    ShadeSpanScalar(dst + iPixel, x + iPixel, count - iPixel, Advance(color, iPixel), dither, settings);
+}
+
+// The texels are gathered 32 bits at a time, hence the texel past the end of the decoded page
+__attribute__((target("avx2")))
+__m256i GetTexelsAVX2(const uint16_t* texels, const TexelIndexer& indexer, __m256i u, __m256i v)
+{
+    u = _mm256_or_si256(_mm256_and_si256(_mm256_srai_epi32(u, FIXED_POINT_SHIFT), _mm256_set1_epi32(indexer.m_maskU)),
+                        _mm256_set1_epi32(indexer.m_offsetU));
+    v = _mm256_or_si256(_mm256_and_si256(_mm256_srai_epi32(v, FIXED_POINT_SHIFT), _mm256_set1_epi32(indexer.m_maskV)),
+                        _mm256_set1_epi32(indexer.m_offsetV));
+    const __m256i indices = _mm256_or_si256(_mm256_slli_epi32(v, 8), u);
+
+    const __m256i gathered = _mm256_i32gather_epi32(reinterpret_cast<const int*>(texels), indices, sizeof(uint16_t));
+    return _mm256_and_si256(gathered, _mm256_set1_epi32(0xFFFF));
+}
+
+__attribute__((target("avx2")))
+__m256i ModulateComponentsAVX2(__m256i texelComponents, __m256i values, __m256i dither)
+{
+    const __m256i components = _mm256_slli_epi32(_mm256_and_si256(texelComponents, _mm256_set1_epi32(0x1F)), 3);
+    const __m256i modulated = _mm256_srai_epi32(_mm256_mullo_epi32(components, _mm256_srai_epi32(values, FIXED_POINT_SHIFT)), 7);
+    return TruncateComponentsAVX2(modulated, dither);
+}
+
+__attribute__((target("avx2")))
+__m256i ModulateAVX2(__m256i texels, __m256i r, __m256i g, __m256i b, __m256i dither)
+{
+    const __m256i gb = _mm256_or_si256(_mm256_slli_epi32(ModulateComponentsAVX2(_mm256_srli_epi32(texels, 5), g, dither), 5),
+                                       _mm256_slli_epi32(ModulateComponentsAVX2(_mm256_srli_epi32(texels, 10), b, dither), 10));
+    const __m256i rMask = _mm256_or_si256(ModulateComponentsAVX2(texels, r, dither), _mm256_and_si256(texels, _mm256_set1_epi32(MASK_BIT)));
+    return _mm256_or_si256(rMask, gb);
+}
+
+// Writes 16 pixels like PutPixel, except where the texels are fully transparent
+__attribute__((target("avx2")))
+void PutTexelsAVX2(uint16_t* dst, __m256i pixels, __m256i texels, const DrawSettings& settings)
+{
+    const __m256i previous = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst));
+    __m256i kept = _mm256_cmpeq_epi16(texels, _mm256_setzero_si256());
+    if (settings.m_preserveMaskedPixels)
+    {
+        kept = _mm256_or_si256(kept, _mm256_srai_epi16(previous, 15));
+    }
+
+    pixels = _mm256_or_si256(pixels, _mm256_set1_epi16(static_cast<int16_t>(settings.m_forceSetMaskBit ? MASK_BIT : 0)));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_blendv_epi8(pixels, previous, kept));
+}
+
+__attribute__((target("avx2")))
+void TextureSpanAVX2(uint16_t* dst, const VRAM& vram, int32_t x, int32_t count, ColorStep color, TexCoordStep texCoord,
+                     const DitherRow& dither, const DrawSettings& settings, const TextureSettings& texture)
+{
+    const uint16_t* texels = texture.m_texels;
+    if (texels == nullptr)
+    {
+        TextureSpan(dst, vram, x, count, color, texCoord, dither, settings, texture);
+        return;
+    }
+
+    const TexelIndexer indexer{ texture };
+    const __m256i ditherOffsets = _mm256_setr_epi32(dither[x & 3], dither[(x + 1) & 3], dither[(x + 2) & 3], dither[(x + 3) & 3],
+                                                    dither[x & 3], dither[(x + 1) & 3], dither[(x + 2) & 3], dither[(x + 3) & 3]);
+
+    __m256i r = StepLanesAVX2(color.m_r, color.m_dr);
+    __m256i g = StepLanesAVX2(color.m_g, color.m_dg);
+    __m256i b = StepLanesAVX2(color.m_b, color.m_db);
+    __m256i u = StepLanesAVX2(texCoord.m_u, texCoord.m_du);
+    __m256i v = StepLanesAVX2(texCoord.m_v, texCoord.m_dv);
+
+    const __m256i rStep = _mm256_set1_epi32(Advance(0, color.m_dr, 8));
+    const __m256i gStep = _mm256_set1_epi32(Advance(0, color.m_dg, 8));
+    const __m256i bStep = _mm256_set1_epi32(Advance(0, color.m_db, 8));
+    const __m256i uStep = _mm256_set1_epi32(Advance(0, texCoord.m_du, 8));
+    const __m256i vStep = _mm256_set1_epi32(Advance(0, texCoord.m_dv, 8));
+
+    int32_t iPixel = 0;
+    for (; iPixel + 16 <= count; iPixel += 16)
+    {
+        const __m256i lowTexels = GetTexelsAVX2(texels, indexer, u, v);
+        const __m256i low = ModulateAVX2(lowTexels, r, g, b, ditherOffsets);
+        r = _mm256_add_epi32(r, rStep);
+        g = _mm256_add_epi32(g, gStep);
+        b = _mm256_add_epi32(b, bStep);
+        u = _mm256_add_epi32(u, uStep);
+        v = _mm256_add_epi32(v, vStep);
+
+        const __m256i highTexels = GetTexelsAVX2(texels, indexer, u, v);
+        const __m256i high = ModulateAVX2(highTexels, r, g, b, ditherOffsets);
+        r = _mm256_add_epi32(r, rStep);
+        g = _mm256_add_epi32(g, gStep);
+        b = _mm256_add_epi32(b, bStep);
+        u = _mm256_add_epi32(u, uStep);
+        v = _mm256_add_epi32(v, vStep);
+
+        // Packing works within each 128 bit half: put the pixels back in order
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(low, high), _MM_SHUFFLE(3, 1, 2, 0));
+        const __m256i packedTexels = _mm256_permute4x64_epi64(_mm256_packus_epi32(lowTexels, highTexels), _MM_SHUFFLE(3, 1, 2, 0));
+        PutTexelsAVX2(dst + iPixel, packed, packedTexels, settings);
+    }
+
+    // The last pixels are drawn in a copy, the lanes past the span being thrown away
+    if (iPixel < count)
+    {
+        uint16_t pixels[16] = {};
+        std::copy_n(dst + iPixel, count - iPixel, pixels);
+        TextureSpanAVX2(pixels, vram, x + iPixel, 16, Advance(color, iPixel), Advance(texCoord, iPixel), dither, settings,
+                        texture);
+        std::copy_n(pixels, count - iPixel, dst + iPixel);
+    }
+}
+
+constexpr SpanKernels SSE41_KERNELS = { FillSpanSSE41, ShadeSpanSSE41, TextureSpanSSE41 };
+constexpr SpanKernels AVX2_KERNELS = { FillSpanAVX2, ShadeSpanAVX2, TextureSpanAVX2 };
+
+#endif
+
+}   // end anonymous namespace
+
+bool SpanKernels::IsSupported(InstructionSet set)
+{
+#if defined(PSEMU_HAS_X86_SIMD)
+    __builtin_cpu_init();
+#endif
+
+    switch (set)
+    {
+        case InstructionSet::SCALAR:
+            return true;
+#if defined(PSEMU_HAS_X86_SIMD)
+        case InstructionSet::SSE41:
+            return __builtin_cpu_supports("sse4.1");
+        case InstructionSet::AVX2:
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return false;
+    }
+}
+
+SpanKernels::InstructionSet SpanKernels::GetBestSupported()
+{
+    for (const InstructionSet set : { InstructionSet::AVX2, InstructionSet::SSE41 })
+    {
+        if (IsSupported(set))
+        {
+            return set;
+        }
+    }
+
+    return InstructionSet::SCALAR;
+}
+
+const SpanKernels& SpanKernels::Get(InstructionSet set)
+{
+    assert(IsSupported(set) && "Span kernels not supported by the host CPU");
+
+    switch (set)
+    {
+#if defined(PSEMU_HAS_X86_SIMD)
+        case InstructionSet::SSE41:
+            return SSE41_KERNELS;
+        case InstructionSet::AVX2:
+            return AVX2_KERNELS;
+#endif
+        default:
+            return SCALAR_KERNELS;
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef SPANKERNELS_H
+#define SPANKERNELS_H
+
+#include "rasterizer.h"
+
+#include <array>
+#include <cstdint>
+
+namespace PSEmu
+{
+
+// Offsets added to the 8 bit color components before they are truncated to 5 bits
+using DitherRow = std::array<int32_t, 4>;
+
+// Interpolated color stepped along a span, in 16.16 fixed point
+struct ColorStep
+{
+    int32_t m_r, m_g, m_b;
+    int32_t m_dr, m_dg, m_db;
+};
+
+// Texture coordinates stepped along a span, in 16.16 fixed point
+struct TexCoordStep
+{
+    int32_t m_u, m_v;
+    int32_t m_du, m_dv;
+};
+
+// Inner loops of the rasterizer, drawing a span of <count> pixels of a VRAM line from <dst>.
+// <x> is the VRAM column of <dst>, selecting the dither offsets.
+// The scalar kernels are the reference: the SIMD ones draw the same pixels, 8 or 16 at a time.
+struct SpanKernels
+{
+    enum class InstructionSet
+    {
+        SCALAR,
+        SSE41,  // 8 pixels per iteration
+        AVX2    // 16 pixels per iteration
+    };
+
+    void (*m_fill)(uint16_t* dst, int32_t count, uint16_t pixel, const DrawSettings& settings);
+    void (*m_shade)(uint16_t* dst, int32_t x, int32_t count, ColorStep color, const DitherRow& dither,
+                    const DrawSettings& settings);
+
+    // The SIMD kernels fetch the texels decoded by the texture cache, and fall back to the scalar
+    // kernel for the primitives sampling the VRAM
+    void (*m_texture)(uint16_t* dst, const VRAM& vram, int32_t x, int32_t count, ColorStep color,
+                      TexCoordStep texCoord, const DitherRow& dither, const DrawSettings& settings,
+                      const TextureSettings& texture);
+
+    // Checks the host CPU with CPUID
+    static bool IsSupported(InstructionSet set);
+    static InstructionSet GetBestSupported();
+
+    // <set> must be supported
+    static const SpanKernels& Get(InstructionSet set);
+};
+
+}   // end namespace PSEmu
+
+#endif // SPANKERNELS_H
@@ -0,0 +1,204 @@
+#include "texturecache.h"
+
+#include "vram.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace PSEmu;
+
+namespace
+{
+
+// 256KB each
+constexpr size_t MAX_PAGES = 16;
+
+// Copies <count> pixels of <line> from column <x>, wrapping around, and tells whether they changed
+bool UpdatePixels(const uint16_t* line, uint32_t x, uint32_t count, uint16_t* pixels)
+{
+    if (x + count <= VRAM::WIDTH)
+    {
+        if (std::memcmp(pixels, line + x, count * sizeof(uint16_t)) == 0)
+        {
+            return false;
+        }
+
+        std::memcpy(pixels, line + x, count * sizeof(uint16_t));
+        return true;
+    }
+
+    bool changed = false;
+    for (uint32_t iPixel = 0; iPixel < count; ++iPixel)
+    {
+        const uint16_t pixel = line[(x + iPixel) % VRAM::WIDTH];
+        changed |= pixels[iPixel] != pixel;
+        pixels[iPixel] = pixel;
+    }
+
+    return changed;
+}
+
+}   // end anonymous namespace
+
+// Batch 0 is never current, so that pages can be replaced before they are used
+TextureCache::TextureCache() : m_pages{}, m_batch{ 1 }, m_useCount{ 0 }
+{
+    m_pages.reserve(MAX_PAGES);
+}
+
+void TextureCache::Prepare(VRAM& vram, Primitive& primitive)
+{
+    if (primitive.m_texturing == Rasterizer::Texturing::NONE)
+    {
+        return;
+    }
+
+    // Its texels change as it is drawn
+    TextureSettings& texture = primitive.m_texture;
+    if (primitive.DrawsOverTexels())
+    {
+        return;
+    }
+
+    Page* page = FindPage(texture);
+    if (page == nullptr)
+    {
+        return;
+    }
+
+    // The texture coordinates are interpolated between the ones of the vertices, give or take the rounding
+    // of their gradients, unless the texture window moves them
+    uint32_t firstV = 0;
+    uint32_t lineCount = TextureSettings::PAGE_SIZE;
+    if (texture.m_windowMaskY == 0)
+    {
+        const auto vertices = primitive.m_vertices.begin();
+        const auto [minVertex, maxVertex] = std::minmax_element(vertices, vertices + primitive.m_vertexCount,
+                                                                [](const Vertex& a, const Vertex& b) { return a.m_v < b.m_v; });
+        firstV = (minVertex->m_v + TextureSettings::PAGE_SIZE - 1) % TextureSettings::PAGE_SIZE;
+        lineCount = std::min<uint32_t>(maxVertex->m_v - minVertex->m_v + 3, TextureSettings::PAGE_SIZE);
+    }
+
+    // Write tracking pages span whole lines, which usually hold the frame buffer next to the textures:
+    // the pixels written since they were checked are compared to the ones decoded, in a new epoch
+    uint64_t epoch = 0;
+    auto startEpoch = [&vram, &epoch]()
+    {
+        if (epoch == 0)
+        {
+            epoch = vram.StartWriteEpoch();
+        }
+        return epoch;
+    };
+
+    if (texture.GetPaletteWidth() != 0 &&
+        (page->m_clutEpoch == 0 || vram.IsPageWrittenSince(page->m_clutY / VRAM::LINES_PER_PAGE, page->m_clutEpoch)))
+    {
+        if (UpdatePixels(vram.GetLine(page->m_clutY), page->m_clutX, texture.GetPaletteWidth(), page->m_clut.data()))
+        {
+            page->m_lineEpochs.fill(0);
+        }
+        page->m_clutEpoch = startEpoch();
+    }
+
+    for (uint32_t iLine = 0; iLine < lineCount; ++iLine)
+    {
+        const uint32_t v = (firstV + iLine) % TextureSettings::PAGE_SIZE;
+        const uint32_t y = (page->m_pageY + v) % VRAM::HEIGHT;
+        const uint64_t lineEpoch = page->m_lineEpochs[v];
+        if (lineEpoch != 0 && !vram.IsPageWrittenSince(y / VRAM::LINES_PER_PAGE, lineEpoch))
+        {
+            continue;
+        }
+
+        uint16_t* pixels = &page->m_pixels[v * TextureSettings::PAGE_SIZE];
+        if (UpdatePixels(vram.GetLine(y), page->m_pageX, texture.GetPageWidth(), pixels) || lineEpoch == 0)
+        {
+            DecodeLine(*page, v);
+        }
+        page->m_lineEpochs[v] = startEpoch();
+    }
+
+    texture.m_texels = page->m_texels.data();
+}
+
+void TextureCache::StartBatch()
+{
+    ++m_batch;
+}
+
+// Pages used by the current batch are kept, they may not be drawn yet
+TextureCache::Page* TextureCache::FindPage(const TextureSettings& texture)
+{
+    const uint32_t pageY = texture.m_pageY % VRAM::HEIGHT;
+    const bool hasPalette = texture.GetPaletteWidth() != 0;
+    const uint32_t clutX = hasPalette ? texture.m_clutX : 0;
+    const uint32_t clutY = hasPalette ? texture.m_clutY : 0;
+
+    Page* replaced = nullptr;
+    for (Page& page : m_pages)
+    {
+        if (page.m_pageX == texture.m_pageX && page.m_pageY == pageY && page.m_depth == texture.m_depth &&
+            page.m_clutX == clutX && page.m_clutY == clutY)
+        {
+            page.m_batch = m_batch;
+            page.m_lastUse = ++m_useCount;
+            return &page;
+        }
+
+        if (page.m_batch != m_batch && (replaced == nullptr || page.m_lastUse < replaced->m_lastUse))
+        {
+            replaced = &page;
+        }
+    }
+
+    if (m_pages.size() < MAX_PAGES)
+    {
+        replaced = &m_pages.emplace_back();
+        replaced->m_pixels.resize(TextureSettings::PAGE_SIZE * TextureSettings::PAGE_SIZE);
+        // The SIMD kernels gather the texels 32 bits at a time, reading past the last one
+        replaced->m_texels.resize(TextureSettings::PAGE_SIZE * TextureSettings::PAGE_SIZE + 1);
+    }
+    else if (replaced == nullptr)
+    {
+        return nullptr;
+    }
+
+    replaced->m_pageX = texture.m_pageX;
+    replaced->m_pageY = pageY;
+    replaced->m_depth = texture.m_depth;
+    replaced->m_clutX = clutX;
+    replaced->m_clutY = clutY;
+    replaced->m_batch = m_batch;
+    replaced->m_lastUse = ++m_useCount;
+    replaced->m_clutEpoch = 0;
+    replaced->m_lineEpochs.fill(0);
+
+    return replaced;
+}
+
+// Texels are looked up like SampleTexture does, from the pixels copied by Prepare
+void TextureCache::DecodeLine(Page& page, uint32_t v) const
+{
+    const uint16_t* pixels = &page.m_pixels[v * TextureSettings::PAGE_SIZE];
+    uint16_t* texels = &page.m_texels[v * TextureSettings::PAGE_SIZE];
+
+    switch (page.m_depth)
+    {
+        case TextureDepth::T4BIT:
+            for (uint32_t u = 0; u < TextureSettings::PAGE_SIZE; ++u)
+            {
+                texels[u] = page.m_clut[(pixels[u / 4] >> ((u % 4) * 4)) & 0xF];
+            }
+            break;
+        case TextureDepth::T8BIT:
+            for (uint32_t u = 0; u < TextureSettings::PAGE_SIZE; ++u)
+            {
+                texels[u] = page.m_clut[(pixels[u / 2] >> ((u % 2) * 8)) & 0xFF];
+            }
+            break;
+        default:
+            std::copy_n(pixels, TextureSettings::PAGE_SIZE, texels);
+            break;
+    }
+}
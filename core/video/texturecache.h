@@ -0,0 +1,74 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include "rasterizer.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace PSEmu
+{
+
+class VRAM;
+
+// Texture pages decoded to 15 bit texels, so that the texture span kernel reads a flat array
+// instead of looking up the palette for each texel. Pages are keyed by their position, depth
+// and palette, and decoded line after line as the primitives use them. Lines are decoded again
+// once their pixels or their palette changed, which is only checked when the VRAM page holding
+// them was written (see VRAM::StartWriteEpoch).
+class TextureCache
+{
+public:
+    TextureCache();
+
+    // It should not be possible to copy an instance of this class
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // But it should be possible to move it
+    TextureCache(TextureCache&&) = default;
+    TextureCache& operator=(TextureCache&&) = default;
+
+public:
+    // Points the texture of a textured <primitive> to its decoded texels. They are left in VRAM
+    // when the primitive draws over them, or when all the pages are used by the current batch.
+    void Prepare(VRAM& vram, Primitive& primitive);
+
+    // The primitives prepared so far are drawn: their pages can be replaced
+    void StartBatch();
+
+private:
+    struct Page
+    {
+        uint32_t m_pageX = 0;
+        uint32_t m_pageY = 0;
+        TextureDepth m_depth = TextureDepth::T4BIT;
+        uint32_t m_clutX = 0;   /**< Always 0 for 15 bit pages */
+        uint32_t m_clutY = 0;
+
+        uint64_t m_batch = 0;       /**< Last batch using the page */
+        uint64_t m_lastUse = 0;     /**< Replaced first when lowest */
+
+        // VRAM pixels the texels were decoded from, to tell whether they changed since
+        std::array<uint16_t, 256> m_clut{};
+        uint64_t m_clutEpoch = 0;   /**< 0 when not copied */
+        std::vector<uint16_t> m_pixels;
+
+        std::vector<uint16_t> m_texels;
+        std::array<uint64_t, TextureSettings::PAGE_SIZE> m_lineEpochs{};   /**< 0 when not decoded */
+    };
+
+private:
+    Page* FindPage(const TextureSettings& texture);
+    void DecodeLine(Page& page, uint32_t v) const;
+
+private:
+    std::vector<Page> m_pages;
+    uint64_t m_batch;
+    uint64_t m_useCount;
+};
+
+}   // end namespace PSEmu
+
+#endif // TEXTURECACHE_H
@@ -0,0 +1,145 @@
+#include "tilerasterizer.h"
+
+#include <algorithm>
+
+using namespace PSEmu;
+
+namespace
+{
+
+// Bounds the memory used by the primitives of a frame never flushed
+constexpr size_t MAX_PENDING_PRIMITIVES = 16 * 1024;
+
+// Blocks of columns covering <width> columns from <left>, wrapping around the right edge of the VRAM
+uint64_t GetColumnBlocks(uint32_t left, uint32_t width)
+{
+    constexpr uint32_t BLOCK_COUNT = VRAM::WIDTH / TileRasterizer::COLUMN_BLOCK_WIDTH;
+
+    uint64_t blocks = 0;
+    if (width != 0)
+    {
+        const uint32_t first = left / TileRasterizer::COLUMN_BLOCK_WIDTH;
+        const uint32_t last = std::min(first + BLOCK_COUNT - 1, (left + width - 1) / TileRasterizer::COLUMN_BLOCK_WIDTH);
+        for (uint32_t block = first; block <= last; ++block)
+        {
+            blocks |= uint64_t{ 1 } << (block % BLOCK_COUNT);
+        }
+    }
+
+    return blocks;
+}
+
+}   // end anonymous namespace
+
+TileRasterizer::TileRasterizer(VRAM& vram, Rasterizer& rasterizer, TextureCache& textureCache, size_t threadCount)
+    : m_vram{ vram }, m_rasterizer{ rasterizer }, m_textureCache{ textureCache }, m_threadPool{ threadCount },
+      m_primitives{}, m_bins{}, m_tilesToDraw{}, m_writtenBlocks{}, m_texelBlocks{} { }
+
+void TileRasterizer::Draw(const Primitive& primitive)
+{
+    int32_t left = 0;
+    int32_t top = 0;
+    int32_t right = 0;
+    int32_t bottom = 0;
+    if (!primitive.GetBounds(left, top, right, bottom))
+    {
+        return;
+    }
+
+    const TextureSettings& texture = primitive.m_texture;
+    const uint32_t pageBottom = texture.m_pageY + TextureSettings::PAGE_SIZE - 1;
+    const uint64_t blocks = GetColumnBlocks(left, right - left + 1);
+
+    uint64_t pageBlocks = 0;
+    uint64_t paletteBlocks = 0;
+    if (primitive.m_texturing != Rasterizer::Texturing::NONE)
+    {
+        pageBlocks = GetColumnBlocks(texture.m_pageX, texture.GetPageWidth());
+        paletteBlocks = GetColumnBlocks(texture.m_clutX, texture.GetPaletteWidth());
+    }
+
+    // The texels must be read once the primitives before are drawn, and before the ones after are
+    if (HasBlocks(m_writtenBlocks, texture.m_pageY, pageBottom, pageBlocks) ||
+        HasBlocks(m_writtenBlocks, texture.m_clutY, texture.m_clutY, paletteBlocks) ||
+        HasBlocks(m_texelBlocks, top, bottom, blocks) || m_primitives.size() == MAX_PENDING_PRIMITIVES)
+    {
+        Flush();
+    }
+
+    // Its texels change as it is drawn, from the top
+    if (primitive.DrawsOverTexels())
+    {
+        Flush();
+        m_rasterizer.Draw(m_vram, primitive);
+        return;
+    }
+
+    AddBlocks(m_texelBlocks, texture.m_pageY, pageBottom, pageBlocks);
+    AddBlocks(m_texelBlocks, texture.m_clutY, texture.m_clutY, paletteBlocks);
+    AddBlocks(m_writtenBlocks, top, bottom, blocks);
+
+    const uint32_t index = static_cast<uint32_t>(m_primitives.size());
+    m_textureCache.Prepare(m_vram, m_primitives.emplace_back(primitive));
+
+    for (uint32_t tile = top / TILE_HEIGHT; tile <= bottom / TILE_HEIGHT; ++tile)
+    {
+        if (m_bins[tile].empty())
+        {
+            m_tilesToDraw.push_back(tile);
+        }
+        m_bins[tile].push_back(index);
+    }
+}
+
+void TileRasterizer::Flush()
+{
+    m_threadPool.Run(m_tilesToDraw.size(), [this](size_t iTile) { DrawTile(m_tilesToDraw[iTile]); });
+    m_textureCache.StartBatch();
+
+    for (const uint32_t tile : m_tilesToDraw)
+    {
+        m_bins[tile].clear();
+    }
+    m_tilesToDraw.clear();
+    m_primitives.clear();
+    m_writtenBlocks.fill(0);
+    m_texelBlocks.fill(0);
+}
+
+// Called by the threads of the pool
+void TileRasterizer::DrawTile(uint32_t tile)
+{
+    const int32_t tileTop = static_cast<int32_t>(tile * TILE_HEIGHT);
+    const int32_t tileBottom = tileTop + static_cast<int32_t>(TILE_HEIGHT) - 1;
+
+    for (const uint32_t index : m_bins[tile])
+    {
+        Primitive primitive = m_primitives[index];
+        primitive.m_settings.m_areaTop = std::max(primitive.m_settings.m_areaTop, tileTop);
+        primitive.m_settings.m_areaBottom = std::min(primitive.m_settings.m_areaBottom, tileBottom);
+
+        m_rasterizer.Draw(m_vram, primitive);
+    }
+}
+
+// Lines are inclusive and wrap around the bottom of the VRAM like the texture coordinates
+template <typename TFunction>
+void TileRasterizer::ForEachTileInLines(uint32_t top, uint32_t bottom, TFunction function)
+{
+    for (uint32_t tile = top / TILE_HEIGHT; tile <= bottom / TILE_HEIGHT; ++tile)
+    {
+        function(tile % TILE_COUNT);
+    }
+}
+
+bool TileRasterizer::HasBlocks(const TileBlocks& tileBlocks, uint32_t top, uint32_t bottom, uint64_t blocks)
+{
+    bool hasBlocks = false;
+    ForEachTileInLines(top, bottom, [&](uint32_t tile) { hasBlocks |= (tileBlocks[tile] & blocks) != 0; });
+    return hasBlocks;
+}
+
+void TileRasterizer::AddBlocks(TileBlocks& tileBlocks, uint32_t top, uint32_t bottom, uint64_t blocks)
+{
+    ForEachTileInLines(top, bottom, [&](uint32_t tile) { tileBlocks[tile] |= blocks; });
+}
@@ -0,0 +1,78 @@
+#ifndef TILERASTERIZER_H
+#define TILERASTERIZER_H
+
+#include "rasterizer.h"
+#include "texturecache.h"
+#include "vram.h"
+#include "../utils/threadpool.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace PSEmu
+{
+
+// Draws the primitives in parallel. VRAM is split into tiles, and each primitive is binned into
+// the tiles it covers. Once flushed, the tiles are drawn by a thread pool, each tile drawing its
+// primitives in the order they were submitted: the pixels are the same as when the primitives
+// are drawn one after the other.
+// Tiles span whole lines, so that the spans drawn and the VRAM write tracking pages each
+// belong to a single tile.
+class TileRasterizer
+{
+public:
+    static constexpr uint32_t TILE_HEIGHT = 16;
+    static constexpr uint32_t TILE_COUNT = VRAM::HEIGHT / TILE_HEIGHT;
+
+    // The texture hazards are tracked by blocks of columns in each tile
+    static constexpr uint32_t COLUMN_BLOCK_WIDTH = VRAM::WIDTH / 64;
+
+public:
+    // Draws in <vram> with <rasterizer> and <textureCache>, which must outlive it
+    TileRasterizer(VRAM& vram, Rasterizer& rasterizer, TextureCache& textureCache, size_t threadCount);
+
+    // It should not be possible to copy or move this class: the threads keep using it
+    TileRasterizer(const TileRasterizer&) = delete;
+    TileRasterizer& operator=(const TileRasterizer&) = delete;
+
+    TileRasterizer(TileRasterizer&&) = delete;
+    TileRasterizer& operator=(TileRasterizer&&) = delete;
+
+public:
+    // Flushes first when the primitive could write the texels of a pending textured primitive,
+    // or when it is textured and a pending primitive could write its texels.
+    // Textured primitives drawing over their own texels are drawn right away, in one piece.
+    void Draw(const Primitive& primitive);
+
+    // Must be called before anything else accesses the VRAM
+    void Flush();
+
+private:
+    // Columns of each tile, in blocks
+    using TileBlocks = std::array<uint64_t, TILE_COUNT>;
+
+private:
+    void DrawTile(uint32_t tile);
+
+    template <typename TFunction>
+    static void ForEachTileInLines(uint32_t top, uint32_t bottom, TFunction function);
+    static bool HasBlocks(const TileBlocks& tileBlocks, uint32_t top, uint32_t bottom, uint64_t blocks);
+    static void AddBlocks(TileBlocks& tileBlocks, uint32_t top, uint32_t bottom, uint64_t blocks);
+
+private:
+    VRAM& m_vram;
+    Rasterizer& m_rasterizer;
+    TextureCache& m_textureCache;
+    Utils::ThreadPool m_threadPool;
+
+    std::vector<Primitive> m_primitives;
+    std::array<std::vector<uint32_t>, TILE_COUNT> m_bins;  /**< Indices of the primitives of each tile */
+    std::vector<uint32_t> m_tilesToDraw;
+    TileBlocks m_writtenBlocks;     /**< Written by the pending primitives */
+    TileBlocks m_texelBlocks;       /**< Read by the pending textured primitives */
+};
+
+}   // end namespace PSEmu
+
+#endif // TILERASTERIZER_H
@@ -0,0 +1,37 @@
+#include "vram.h"
+
+#include <cstring>
+
+using namespace PSEmu;
+
+VRAM::VRAM() : m_pixels(WIDTH * HEIGHT, 0), m_pageWriteEpochs(PAGE_COUNT, 0), m_writeEpoch{ 0 } { }
+
+const uint8_t* VRAM::GetData() const
+{
+    return reinterpret_cast<const uint8_t*>(m_pixels.data());
+}
+
+// Writes from now on are told apart from the earlier ones
+uint64_t VRAM::StartWriteEpoch()
+{
+    return ++m_writeEpoch;
+}
+
+// Replace the content of <page> by DIRTY_PAGE_SIZE bytes from <src>
+void VRAM::WritePage(uint32_t page, const uint8_t* src)
+{
+    std::memcpy(reinterpret_cast<uint8_t*>(m_pixels.data()) + page * DIRTY_PAGE_SIZE, src, DIRTY_PAGE_SIZE);
+    m_pageWriteEpochs[page] = m_writeEpoch;
+}
+
+// The content is written and read back in one go
+void VRAM::Save(Utils::StateWriter& writer) const
+{
+    writer.WriteBytes(m_pixels.data(), SIZE);
+}
+
+void VRAM::Load(Utils::StateReader& reader)
+{
+    reader.ReadBytes(m_pixels.data(), SIZE);
+    m_pageWriteEpochs.assign(PAGE_COUNT, m_writeEpoch);
+}
@@ -0,0 +1,81 @@
+#ifndef VRAM_H
+#define VRAM_H
+
+#include "../utils/state.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace PSEmu
+{
+
+// Video memory of the GPU: 1024x512 pixels of 16 bits.
+// Writes are tracked by pages of whole lines like the RAM (see RAM::StartWriteEpoch).
+class VRAM
+{
+public:
+    static constexpr uint32_t WIDTH = 1024;
+    static constexpr uint32_t HEIGHT = 512;
+    static constexpr uint32_t SIZE = WIDTH * HEIGHT * sizeof(uint16_t);
+
+    static constexpr uint32_t DIRTY_PAGE_SIZE = 4 * 1024;
+    static constexpr uint32_t LINES_PER_PAGE = DIRTY_PAGE_SIZE / (WIDTH * sizeof(uint16_t));
+    static constexpr uint32_t PAGE_COUNT = SIZE / DIRTY_PAGE_SIZE;
+
+public:
+    VRAM();
+
+    // It should not be possible to copy an instance of this class
+    VRAM(const VRAM&) = delete;
+    VRAM& operator=(const VRAM&) = delete;
+
+    // But it should be possible to move it
+    VRAM(VRAM&&) = default;
+    VRAM& operator=(VRAM&&) = default;
+
+public:
+    // Coordinates wrap around the edges
+    uint16_t GetPixel(uint32_t x, uint32_t y) const
+    {
+        return m_pixels[(y % HEIGHT) * WIDTH + (x % WIDTH)];
+    }
+
+    void SetPixel(uint32_t x, uint32_t y, uint16_t value)
+    {
+        y %= HEIGHT;
+        m_pixels[y * WIDTH + (x % WIDTH)] = value;
+        m_pageWriteEpochs[y / LINES_PER_PAGE] = m_writeEpoch;
+    }
+
+    const uint16_t* GetLine(uint32_t y) const { return &m_pixels[y * WIDTH]; }
+
+    // Marks the line as written: the pointer must not be kept after writing
+    uint16_t* GetLineForWrite(uint32_t y)
+    {
+        m_pageWriteEpochs[y / LINES_PER_PAGE] = m_writeEpoch;
+        return &m_pixels[y * WIDTH];
+    }
+
+    const uint8_t* GetData() const;
+
+    uint64_t StartWriteEpoch();
+    bool IsPageWrittenSince(uint32_t page, uint64_t epoch) const { return m_pageWriteEpochs[page] >= epoch; }
+    void MarkPageWritten(uint32_t page) { m_pageWriteEpochs[page] = m_writeEpoch; }
+
+    uint32_t GetPageCount() const { return PAGE_COUNT; }
+    void WritePage(uint32_t page, const uint8_t* src);
+
+    void Save(Utils::StateWriter& writer) const;
+    void Load(Utils::StateReader& reader);
+
+private:
+    std::vector<uint16_t> m_pixels;
+
+    // Epoch in which each page was last written
+    std::vector<uint64_t> m_pageWriteEpochs;
+    uint64_t m_writeEpoch;
+};
+
+}   // end namespace PSEmu
+
+#endif // VRAM_H
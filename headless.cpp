@@ -0,0 +1,299 @@
+#include "cpu/r3000a.h"
+#include "cpu/rewind.h"
+#include "cpu/runahead.h"
+#include "memory/psxexe.h"
+#include "utils/hash.h"
+#include "utils/state.h"
+#include "video/spankernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+using namespace PSEmu;
+
+namespace
+{
+
+struct Options
+{
+    std::string m_biosPath;
+    std::string m_exePath;
+    std::string m_loadStatePath;
+    std::string m_saveStatePath;
+    uint64_t m_frames = 0;
+    uint64_t m_cycles = 0;
+    uint64_t m_rewindFrames = 0;
+    uint32_t m_runAheadFrames = 0;
+    bool m_cached = false;
+    bool m_fastMem = false;
+    bool m_scalarSpans = false;
+    bool m_gpuThread = false;
+    size_t m_rasterThreads = 1;
+    bool m_hle = false;
+};
+
+void PrintUsage(const char* program)
+{
+    std::cerr << "Usage: " << program << " (--bios <file> | --hle) [--exe <file>] (--frames <n> | --cycles <n>)"
+              << " [--cached] [--fastmem] [--scalar-spans] [--gpu-thread] [--raster-threads <n>]"
+              << " [--load-state <file>] [--save-state <file>]"
+              << " [--rewind <n>] [--run-ahead <n>]\n";
+}
+
+bool ParseOptions(int argc, char** argv, Options& options)
+{
+    for (int iArg = 1; iArg < argc; ++iArg)
+    {
+        const std::string arg = argv[iArg];
+        const bool hasValue = (iArg + 1) < argc;
+
+        if (arg == "--bios" && hasValue)
+        {
+            options.m_biosPath = argv[++iArg];
+        }
+        else if (arg == "--exe" && hasValue)
+        {
+            options.m_exePath = argv[++iArg];
+        }
+        else if (arg == "--load-state" && hasValue)
+        {
+            options.m_loadStatePath = argv[++iArg];
+        }
+        else if (arg == "--save-state" && hasValue)
+        {
+            options.m_saveStatePath = argv[++iArg];
+        }
+        else if (arg == "--frames" && hasValue)
+        {
+            options.m_frames = std::strtoull(argv[++iArg], nullptr, 10);
+        }
+        else if (arg == "--cycles" && hasValue)
+        {
+            options.m_cycles = std::strtoull(argv[++iArg], nullptr, 10);
+        }
+        else if (arg == "--rewind" && hasValue)
+        {
+            options.m_rewindFrames = std::strtoull(argv[++iArg], nullptr, 10);
+        }
+        else if (arg == "--run-ahead" && hasValue)
+        {
+            options.m_runAheadFrames = static_cast<uint32_t>(std::strtoul(argv[++iArg], nullptr, 10));
+        }
+        else if (arg == "--raster-threads" && hasValue)
+        {
+            options.m_rasterThreads = std::strtoull(argv[++iArg], nullptr, 10);
+        }
+        else if (arg == "--cached")
+        {
+            options.m_cached = true;
+        }
+        else if (arg == "--fastmem")
+        {
+            options.m_fastMem = true;
+        }
+        else if (arg == "--scalar-spans")
+        {
+            options.m_scalarSpans = true;
+        }
+        else if (arg == "--gpu-thread")
+        {
+            options.m_gpuThread = true;
+        }
+        else if (arg == "--hle")
+        {
+            options.m_hle = true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    // Rewinding and running ahead work by frames
+    return (!options.m_biosPath.empty() || options.m_hle) && (options.m_frames != 0 || options.m_cycles != 0) &&
+           (options.m_rewindFrames <= options.m_frames) && (options.m_runAheadFrames == 0 || options.m_frames != 0);
+}
+
+// The BIOS takes well under that to initialize the kernel
+constexpr uint64_t MAX_BOOT_CYCLES = 10ull * 33868800;
+
+constexpr size_t MAX_REWIND_BYTES = 256 * 1024 * 1024;
+
+}   // end anonymous namespace
+
+// Runs the emulator without any user interface and prints statistics
+// which can be compared between runs
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+    {
+        PrintUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // The HLE kernel doesn't need a BIOS image but can still be given one
+    BIOS bios;
+    if (!options.m_biosPath.empty() && !bios.Init(options.m_biosPath))
+    {
+        std::cerr << "Couldn't load BIOS " << options.m_biosPath << '\n';
+        return EXIT_FAILURE;
+    }
+
+    PsxExe exe;
+    if (!options.m_exePath.empty() && !exe.Init(options.m_exePath))
+    {
+        std::cerr << "Couldn't load PS-X EXE " << options.m_exePath << '\n';
+        return EXIT_FAILURE;
+    }
+
+    const auto mode = options.m_cached ? R3000A::ExecutionMode::CACHED_INTERPRETER : R3000A::ExecutionMode::INTERPRETER;
+    R3000A cpu{ Interconnect{ std::move(bios), options.m_fastMem }, Debugger{}, mode, options.m_hle };
+
+    Interconnect& interconnect = cpu.GetInterconnect();
+    GPU& gpu = interconnect.GetGPU();
+    const Scheduler& scheduler = interconnect.GetScheduler();
+
+    // The reference kernels draw the same pixels as the SIMD ones, only slower
+    if (options.m_scalarSpans)
+    {
+        gpu.GetRasterizer().SetSpanKernels(SpanKernels::Get(SpanKernels::InstructionSet::SCALAR));
+    }
+
+    // The CPU owns the GPU, which won't move anymore
+    if (options.m_gpuThread)
+    {
+        gpu.SetRenderThreadEnabled(true);
+    }
+    gpu.SetRasterizerThreadCount(options.m_rasterThreads);
+
+    // Resume from a checkpoint instead of booting
+    if (!options.m_loadStatePath.empty())
+    {
+        const auto loadStart = std::chrono::steady_clock::now();
+
+        Utils::StateFile stateFile;
+        if (!stateFile.Open(options.m_loadStatePath) || !cpu.LoadState(stateFile.GetData(), stateFile.GetSize()))
+        {
+            std::cerr << "Couldn't load state " << options.m_loadStatePath << '\n';
+            return EXIT_FAILURE;
+        }
+
+        const std::chrono::duration<double, std::milli> loadTime = std::chrono::steady_clock::now() - loadStart;
+        std::cout << "load state (ms): " << loadTime.count() << '\n';
+    }
+    // Only let the BIOS initialize the kernel: the EXE replaces the shell and its intro.
+    // The HLE kernel starts at the shell entry point.
+    else if (!options.m_exePath.empty())
+    {
+        if (!cpu.RunUntil(SHELL_ENTRY_ADDRESS, MAX_BOOT_CYCLES))
+        {
+            std::cerr << "The BIOS didn't reach the shell entry point\n";
+            return EXIT_FAILURE;
+        }
+
+        std::cout << "boot cycles:     " << scheduler.GetCycles() << '\n';
+        cpu.SideLoad(exe);
+    }
+
+    const uint64_t startCycle = scheduler.GetCycles();
+    const uint64_t startInstruction = cpu.GetInstructionCount();
+    const auto start = std::chrono::steady_clock::now();
+
+    // When rewinding, a snapshot is taken before each frame and the last ones are undone at the end
+    std::optional<RewindBuffer> rewind;
+    if (options.m_rewindFrames != 0)
+    {
+        rewind.emplace(options.m_rewindFrames, MAX_REWIND_BYTES);
+    }
+    std::chrono::duration<double, std::milli> captureTime{};
+
+    RunAhead runAhead{ options.m_runAheadFrames };
+    uint64_t presentedFrames = 0;
+    gpu.SetFrameHandler([&presentedFrames](const GPU&) { ++presentedFrames; });
+
+    if (options.m_frames != 0)
+    {
+        const uint64_t endFrame = gpu.GetFrameCount() + options.m_frames;
+        while (gpu.GetFrameCount() < endFrame)
+        {
+            if (rewind)
+            {
+                const auto captureStart = std::chrono::steady_clock::now();
+                rewind->Capture(cpu);
+                captureTime += std::chrono::steady_clock::now() - captureStart;
+            }
+
+            runAhead.RunFrame(cpu);
+        }
+    }
+    else
+    {
+        uint64_t remainingCycles = options.m_cycles;
+        while (remainingCycles > 0)
+        {
+            const uint32_t cycles = static_cast<uint32_t>(std::min<uint64_t>(remainingCycles, gpu.GetCyclesPerFrame()));
+            cpu.Run(cycles);
+            remainingCycles -= cycles;
+        }
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    const double seconds = elapsed.count();
+    const uint64_t frames = options.m_frames != 0 ? options.m_frames : gpu.GetFrameCount();
+
+    if (rewind)
+    {
+        const size_t memoryUsage = rewind->GetMemoryUsage();
+        const size_t snapshots = rewind->GetCount();
+
+        const auto rewindStart = std::chrono::steady_clock::now();
+        while (rewind->Rewind(cpu)) { }
+        const std::chrono::duration<double, std::milli> rewindTime = std::chrono::steady_clock::now() - rewindStart;
+
+        std::cout << "rewind snapshots: " << snapshots << '\n'
+                  << "rewind memory:   " << memoryUsage << '\n'
+                  << "capture (ms):    " << captureTime.count() / frames << '\n'
+                  << "rewind (ms):     " << rewindTime.count() / snapshots << '\n';
+    }
+
+    const uint64_t ramHash = Utils::HashFNV1a(interconnect.GetRAM().GetData(), RAM_SIZE);
+    const uint64_t vramHash = Utils::HashFNV1a(gpu.GetVRAM().GetData(), VRAM::SIZE);
+
+    const uint64_t instructions = cpu.GetInstructionCount() - startInstruction;
+
+    std::cout << "frames:          " << frames << '\n'
+              << "presented:       " << presentedFrames << '\n'
+              << "cycles:          " << scheduler.GetCycles() - startCycle << '\n'
+              << "instructions:    " << instructions << '\n'
+              << "time (s):        " << seconds << '\n'
+              << "instructions/s:  " << static_cast<uint64_t>(instructions / seconds) << '\n'
+              << "frame time (ms): " << (frames != 0 ? seconds * 1000.0 / frames : 0.0) << '\n'
+              << "pc:              0x" << std::hex << std::setw(8) << std::setfill('0') << cpu.GetPC() << '\n'
+              << "ram hash:        0x" << std::setw(16) << ramHash << '\n'
+              << "vram hash:       0x" << std::setw(16) << vramHash << std::dec << '\n';
+
+    if (!options.m_saveStatePath.empty())
+    {
+        const auto saveStart = std::chrono::steady_clock::now();
+
+        std::vector<uint8_t> state;
+        cpu.SaveState(state);
+        if (!Utils::WriteStateFile(options.m_saveStatePath, state))
+        {
+            std::cerr << "Couldn't save state " << options.m_saveStatePath << '\n';
+            return EXIT_FAILURE;
+        }
+
+        const std::chrono::duration<double, std::milli> saveTime = std::chrono::steady_clock::now() - saveStart;
+        std::cout << "save state (ms): " << saveTime.count() << '\n';
+    }
+
+    return EXIT_SUCCESS;
+}
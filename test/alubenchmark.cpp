@@ -0,0 +1,288 @@
+#include "cpu/instruction.h"
+#include "cpu/overflow.h"
+#include "cpu/r3000a.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <tuple>
+#include <vector>
+
+using namespace PSEmu;
+
+// Times the overflow check of ADD, ADDI and SUB: the std::function check they used to call against the
+// operators they call now, and the CPU running them. Only meaningful in a release build.
+//
+// PSEmuALUBenchmark [iterations]
+
+namespace
+{
+
+constexpr uint32_t DEFAULT_ITERATIONS = 1000000;
+constexpr uint32_t RUN_COUNT = 5;
+
+// Registers of the workload
+constexpr uint32_t ZERO = 0;
+constexpr uint32_t T0 = 8;
+constexpr uint32_t T1 = 9;
+constexpr uint32_t T2 = 10;
+constexpr uint32_t T3 = 11;
+constexpr uint32_t T4 = 12;
+constexpr uint32_t T5 = 13;
+constexpr uint32_t T6 = 14;
+constexpr uint32_t T7 = 15;
+constexpr uint32_t T8 = 24;
+
+constexpr uint32_t EncodeRType(uint32_t funct, uint32_t rd, uint32_t rs, uint32_t rt)
+{
+    return (rs << 21) | (rt << 16) | (rd << 11) | funct;
+}
+
+constexpr uint32_t EncodeIType(uint32_t op, uint32_t rt, uint32_t rs, int16_t imm)
+{
+    return (op << 26) | (rs << 21) | (rt << 16) | static_cast<uint16_t>(imm);
+}
+
+constexpr uint32_t Add(uint32_t rd, uint32_t rs, uint32_t rt)   { return EncodeRType(0x20, rd, rs, rt); }
+constexpr uint32_t Sub(uint32_t rd, uint32_t rs, uint32_t rt)   { return EncodeRType(0x22, rd, rs, rt); }
+constexpr uint32_t Addi(uint32_t rt, uint32_t rs, int16_t imm)  { return EncodeIType(0x08, rt, rs, imm); }
+constexpr uint32_t Addiu(uint32_t rt, uint32_t rs, int16_t imm) { return EncodeIType(0x09, rt, rs, imm); }
+constexpr uint32_t Beq(uint32_t rs, uint32_t rt, int16_t imm)   { return EncodeIType(0x04, rt, rs, imm); }
+constexpr uint32_t NOP = 0;
+
+// The old check reports overflows for ADD with a negative rhs and SUB with a positive rhs, which don't overflow.
+// The workload has none of them, and never overflows: both checks execute the same instructions.
+constexpr std::array<uint32_t, 3> SETUP = { Addiu(T0, ZERO, 1), Addiu(T1, ZERO, 3), Addiu(T8, ZERO, -2) };
+constexpr std::array<uint32_t, 6> BODY = { Add(T2, T0, T1), Addi(T3, T2, 5), Sub(T4, T3, T8),
+                                           Add(T5, T4, T1), Addi(T6, T5, 7), Sub(T7, T6, T8) };
+constexpr uint32_t BODY_REPEATS = 4;
+
+// Each instruction takes 2 cycles, and the loop ends with a branch and its delay slot
+constexpr uint32_t CYCLES_PER_ITERATION = 2 * (BODY_REPEATS * BODY.size() + 2);
+constexpr uint32_t MAX_ITERATIONS = std::numeric_limits<uint32_t>::max() / CYCLES_PER_ITERATION;
+
+// Where the BIOS shell would load a PS-X EXE
+constexpr uint32_t PROGRAM_ADDRESS = 0x80010000;
+
+template <typename T>
+using ALUOperands = std::tuple<T, T, T>;
+
+template <typename T>
+ALUOperands<T> DecodeSignExtendedImmediate(const std::array<uint32_t, 32>& regs, Instruction inst)
+{
+    return { inst.GetRt(), regs[inst.GetRs()], inst.GetImmSe() };
+}
+
+template <typename T>
+ALUOperands<T> DecodeThreeOperands(const std::array<uint32_t, 32>& regs, Instruction inst)
+{
+    return { inst.GetRd(), regs[inst.GetRs()], regs[inst.GetRt()] };
+}
+
+// Registers of the R3000A, and the overflow exceptions it would have triggered
+struct Registers
+{
+    std::array<uint32_t, 32> m_values{};
+    uint32_t m_overflows = 0;
+};
+
+// The check before OverflowingPlus and OverflowingMinus, and how R3000A::ExecuteTrappingALU called it
+bool WouldOverflow(int32_t lhs, int32_t rhs, std::function<int32_t(int32_t,int32_t)> func)
+{
+    return lhs > func(std::numeric_limits<int32_t>::max(), rhs);
+}
+
+template <typename TOperator, typename TOverflow, typename TDecoder>
+void ExecuteOldTrappingALU(Registers& regs, TOperator&& op, TOverflow&& overflowHandler, TDecoder&& dec, Instruction inst)
+{
+    const auto& [destReg, lhs, rhs] = dec(regs.m_values, inst);
+
+    if (WouldOverflow(lhs, rhs, overflowHandler))
+    {
+        ++regs.m_overflows;
+    }
+
+    regs.m_values[destReg] = op(lhs, rhs);
+}
+
+// R3000A::ExecuteTrappingALU
+template <typename TOperator, typename TDecoder>
+void ExecuteTrappingALU(Registers& regs, TOperator&& op, TDecoder&& dec, Instruction inst)
+{
+    const auto& [destReg, lhs, rhs] = dec(regs.m_values, inst);
+
+    int32_t result;
+    if (op(lhs, rhs, result))
+    {
+        ++regs.m_overflows;
+        return;
+    }
+
+    regs.m_values[destReg] = result;
+}
+
+void OldADD(Registers& regs, Instruction inst)  { ExecuteOldTrappingALU(regs, std::plus<int32_t>{}, std::minus<int32_t>{}, DecodeThreeOperands<int32_t>, inst); }
+void OldADDI(Registers& regs, Instruction inst) { ExecuteOldTrappingALU(regs, std::plus<int32_t>{}, std::minus<int32_t>{}, DecodeSignExtendedImmediate<int32_t>, inst); }
+void OldSUB(Registers& regs, Instruction inst)  { ExecuteOldTrappingALU(regs, std::minus<int32_t>{}, std::plus<int32_t>{}, DecodeThreeOperands<int32_t>, inst); }
+
+void NewADD(Registers& regs, Instruction inst)  { ExecuteTrappingALU(regs, OverflowingPlus{}, DecodeThreeOperands<int32_t>, inst); }
+void NewADDI(Registers& regs, Instruction inst) { ExecuteTrappingALU(regs, OverflowingPlus{}, DecodeSignExtendedImmediate<int32_t>, inst); }
+void NewSUB(Registers& regs, Instruction inst)  { ExecuteTrappingALU(regs, OverflowingMinus{}, DecodeThreeOperands<int32_t>, inst); }
+
+using Handler = void (*)(Registers&, Instruction);
+
+struct DecodedInstruction
+{
+    Handler m_handler;
+    Instruction m_inst;
+};
+
+// The body of the loop, dispatched through function pointers like the decoded blocks of the cached interpreter
+std::vector<DecodedInstruction> DecodeBody(Handler add, Handler addi, Handler sub)
+{
+    std::vector<DecodedInstruction> body;
+    for (uint32_t iRepeat = 0; iRepeat < BODY_REPEATS; ++iRepeat)
+    {
+        for (const uint32_t word : BODY)
+        {
+            const Instruction inst{ word };
+            const Handler handler = inst.GetOp() == ADDI ? addi : (inst.GetOp() == SUB ? sub : add);
+            body.push_back({ handler, inst });
+        }
+    }
+    return body;
+}
+
+// Best of the runs, as the noise only ever slows them down
+template <typename TRun>
+double MeasureInstructionsPerSecond(TRun&& run)
+{
+    double best = 0.0;
+    for (uint32_t iRun = 0; iRun < RUN_COUNT; ++iRun)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const uint64_t instructionCount = run();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::max(best, static_cast<double>(instructionCount) / elapsed.count());
+    }
+    return best;
+}
+
+double MeasureChecks(Handler add, Handler addi, Handler sub, uint32_t iterations, Registers& regs)
+{
+    const std::vector<DecodedInstruction> body = DecodeBody(add, addi, sub);
+    return MeasureInstructionsPerSecond([&]()
+    {
+        regs = Registers{};
+        regs.m_values[T0] = 1;
+        regs.m_values[T1] = 3;
+        regs.m_values[T8] = static_cast<uint32_t>(-2);
+
+        for (uint32_t iIteration = 0; iIteration < iterations; ++iIteration)
+        {
+            for (const DecodedInstruction& decoded : body)
+            {
+                decoded.m_handler(regs, decoded.m_inst);
+            }
+        }
+        return static_cast<uint64_t>(iterations) * body.size();
+    });
+}
+
+// The loop runs in RAM without a BIOS: interrupts stay disabled as after a reset
+double MeasureCPU(R3000A::ExecutionMode mode, uint32_t iterations, Registers& regs)
+{
+    R3000A cpu{ Interconnect{ BIOS{} }, Debugger{}, mode };
+    Interconnect& interconnect = cpu.GetInterconnect();
+
+    uint32_t address = PROGRAM_ADDRESS;
+    for (const uint32_t word : SETUP)
+    {
+        interconnect.Store<uint32_t>(address, word);
+        address += 4;
+    }
+
+    const uint32_t loopAddress = address;
+    for (uint32_t iRepeat = 0; iRepeat < BODY_REPEATS; ++iRepeat)
+    {
+        for (const uint32_t word : BODY)
+        {
+            interconnect.Store<uint32_t>(address, word);
+            address += 4;
+        }
+    }
+
+    // Relative to the delay slot
+    const int32_t offset = static_cast<int32_t>(loopAddress - (address + 4)) / 4;
+    interconnect.Store<uint32_t>(address, Beq(ZERO, ZERO, static_cast<int16_t>(offset)));
+    interconnect.Store<uint32_t>(address + 4, NOP);
+
+    const uint32_t cycles = CYCLES_PER_ITERATION * iterations;
+
+    const double instructionsPerSecond = MeasureInstructionsPerSecond([&]()
+    {
+        cpu.SetPC(PROGRAM_ADDRESS);
+        const uint64_t startCount = cpu.GetInstructionCount();
+        cpu.Run(cycles);
+        return cpu.GetInstructionCount() - startCount;
+    });
+
+    regs.m_values = cpu.GetRegisters();
+    return instructionsPerSecond;
+}
+
+bool CheckRegisters(const char* name, const Registers& regs)
+{
+    // 1 + 3 = 4, + 5 = 9, - -2 = 11, + 3 = 14, + 7 = 21, - -2 = 23
+    if (regs.m_values[T7] != 23 || regs.m_overflows != 0)
+    {
+        std::cerr << name << ": wrong result " << regs.m_values[T7] << " with " << regs.m_overflows << " overflows\n";
+        return false;
+    }
+    return true;
+}
+
+void PrintResult(const char* name, double instructionsPerSecond)
+{
+    std::cout << name << " (M instructions/s): " << instructionsPerSecond / 1e6 << '\n';
+}
+
+}   // end anonymous namespace
+
+int main(int argc, char** argv)
+{
+    const uint32_t iterations = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : DEFAULT_ITERATIONS;
+    if (iterations == 0 || iterations > MAX_ITERATIONS)
+    {
+        std::cerr << "Usage: " << argv[0] << " [iterations, up to " << MAX_ITERATIONS << "]\n";
+        return EXIT_FAILURE;
+    }
+
+    Registers oldRegs;
+    const double oldChecks = MeasureChecks(&OldADD, &OldADDI, &OldSUB, iterations, oldRegs);
+    Registers newRegs;
+    const double newChecks = MeasureChecks(&NewADD, &NewADDI, &NewSUB, iterations, newRegs);
+
+    Registers interpreterRegs;
+    const double interpreter = MeasureCPU(R3000A::ExecutionMode::INTERPRETER, iterations, interpreterRegs);
+    Registers cachedRegs;
+    const double cached = MeasureCPU(R3000A::ExecutionMode::CACHED_INTERPRETER, iterations, cachedRegs);
+
+    if (!CheckRegisters("std::function check", oldRegs) || !CheckRegisters("overflowing operators", newRegs) ||
+        !CheckRegisters("interpreter", interpreterRegs) || !CheckRegisters("cached interpreter", cachedRegs))
+    {
+        return EXIT_FAILURE;
+    }
+
+    PrintResult("std::function check", oldChecks);
+    PrintResult("overflowing operators", newChecks);
+    std::cout << "speedup: " << newChecks / oldChecks << '\n';
+    PrintResult("interpreter", interpreter);
+    PrintResult("cached interpreter", cached);
+    return EXIT_SUCCESS;
+}
@@ -3,7 +3,7 @@
 
 #include <gtest/gtest.h>
 
-#include "../src/emulator/cpu/r3000a.h"
+#include "cpu/r3000a.h"
 
 class CPUFixture : public ::testing::Test
 {
@@ -0,0 +1,218 @@
+#include "video/spankernels.h"
+#include "video/vram.h"
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace PSEmu;
+
+namespace
+{
+
+constexpr uint32_t SPAN_COUNT = 20000;
+constexpr int32_t MAX_SPAN_LENGTH = 300;
+
+// VRAM line holding the spans, with pixels on both sides to catch writes out of the span
+using Line = std::array<uint16_t, VRAM::WIDTH>;
+
+// The scalar kernels are the reference for the SIMD ones
+class SpanKernelsTest : public ::testing::TestWithParam<SpanKernels::InstructionSet>
+{
+protected:
+    void SetUp() override
+    {
+        if (!SpanKernels::IsSupported(GetParam()))
+        {
+            GTEST_SKIP() << "Instruction set not supported by the host CPU";
+        }
+
+        // Fully transparent texels (0) are common in textures
+        m_texels.resize(TextureSettings::PAGE_SIZE * TextureSettings::PAGE_SIZE);
+        for (uint16_t& texel : m_texels)
+        {
+            texel = (m_random() % 4 == 0) ? 0 : static_cast<uint16_t>(m_random());
+        }
+
+        for (uint32_t y = 0; y < VRAM::HEIGHT; ++y)
+        {
+            for (uint32_t x = 0; x < VRAM::WIDTH; ++x)
+            {
+                m_vram.SetPixel(x, y, static_cast<uint16_t>(m_random()));
+            }
+        }
+    }
+
+    // Pixels already there, half of them with the mask bit set
+    Line RandomLine()
+    {
+        Line line;
+        for (uint16_t& pixel : line)
+        {
+            pixel = static_cast<uint16_t>(m_random());
+        }
+        return line;
+    }
+
+    DrawSettings RandomDrawSettings()
+    {
+        DrawSettings settings;
+        settings.m_dithering = (m_random() & 1) != 0;
+        settings.m_forceSetMaskBit = (m_random() & 1) != 0;
+        settings.m_preserveMaskedPixels = (m_random() & 1) != 0;
+        return settings;
+    }
+
+    // The rasterizer passes zero offsets when dithering is disabled
+    DitherRow RandomDither(const DrawSettings& settings)
+    {
+        DitherRow dither{};
+        if (settings.m_dithering)
+        {
+            for (int32_t& offset : dither)
+            {
+                offset = static_cast<int32_t>(m_random() % 8) - 4;
+            }
+        }
+        return dither;
+    }
+
+    // Mostly colors within 0-255 along the span, sometimes any fixed point value
+    ColorStep RandomColor()
+    {
+        const bool anyValue = m_random() % 4 == 0;
+        const auto component = [&]() { return anyValue ? static_cast<int32_t>(m_random()) : static_cast<int32_t>((m_random() % 256) << 16); };
+        const auto step = [&]() { return anyValue ? static_cast<int32_t>(m_random()) : static_cast<int32_t>(m_random() % 0x20000) - 0x10000; };
+
+        ColorStep color;
+        color.m_r = component();
+        color.m_g = component();
+        color.m_b = component();
+        color.m_dr = step();
+        color.m_dg = step();
+        color.m_db = step();
+        return color;
+    }
+
+    TexCoordStep RandomTexCoord()
+    {
+        TexCoordStep texCoord;
+        texCoord.m_u = static_cast<int32_t>((m_random() % 256) << 16);
+        texCoord.m_v = static_cast<int32_t>((m_random() % 256) << 16);
+        texCoord.m_du = static_cast<int32_t>(m_random() % 0x40000) - 0x20000;
+        texCoord.m_dv = static_cast<int32_t>(m_random() % 0x40000) - 0x20000;
+        return texCoord;
+    }
+
+    // Decoded by the texture cache, or sampled from the VRAM, with a texture window a third of the time
+    TextureSettings RandomTexture()
+    {
+        TextureSettings texture;
+        texture.m_pageX = (m_random() % 16) * 64;
+        texture.m_pageY = (m_random() % 2) * 256;
+        texture.m_depth = static_cast<TextureDepth>(m_random() % 3);
+        texture.m_clutX = (m_random() % 48) * 16;
+        texture.m_clutY = m_random() % VRAM::HEIGHT;
+        texture.m_texels = (m_random() % 4 != 0) ? m_texels.data() : nullptr;
+
+        if (m_random() % 3 == 0)
+        {
+            texture.m_windowMaskX = m_random() & 0x1F;
+            texture.m_windowMaskY = m_random() & 0x1F;
+            texture.m_windowOffsetX = m_random() & 0x1F;
+            texture.m_windowOffsetY = m_random() & 0x1F;
+        }
+        return texture;
+    }
+
+    // Position and length of a span within a line
+    void RandomSpan(int32_t& x, int32_t& count)
+    {
+        count = static_cast<int32_t>(m_random() % MAX_SPAN_LENGTH) + 1;
+        x = static_cast<int32_t>(m_random() % (VRAM::WIDTH - MAX_SPAN_LENGTH));
+    }
+
+protected:
+    std::mt19937 m_random{ 1234 };
+    VRAM m_vram;
+    std::vector<uint16_t> m_texels;
+};
+
+}   // end anonymous namespace
+
+TEST_P(SpanKernelsTest, FillMatchesScalar)
+{
+    const SpanKernels& reference = SpanKernels::Get(SpanKernels::InstructionSet::SCALAR);
+    const SpanKernels& kernels = SpanKernels::Get(GetParam());
+
+    for (uint32_t iSpan = 0; iSpan < SPAN_COUNT; ++iSpan)
+    {
+        int32_t x, count;
+        RandomSpan(x, count);
+        const uint16_t pixel = static_cast<uint16_t>(m_random() & 0x7FFF);
+        const DrawSettings settings = RandomDrawSettings();
+
+        Line expected = RandomLine();
+        Line actual = expected;
+        reference.m_fill(expected.data() + x, count, pixel, settings);
+        kernels.m_fill(actual.data() + x, count, pixel, settings);
+
+        ASSERT_EQ(expected, actual) << "span " << iSpan << " at " << x << ", " << count << " pixels";
+    }
+}
+
+TEST_P(SpanKernelsTest, ShadeMatchesScalar)
+{
+    const SpanKernels& reference = SpanKernels::Get(SpanKernels::InstructionSet::SCALAR);
+    const SpanKernels& kernels = SpanKernels::Get(GetParam());
+
+    for (uint32_t iSpan = 0; iSpan < SPAN_COUNT; ++iSpan)
+    {
+        int32_t x, count;
+        RandomSpan(x, count);
+        const ColorStep color = RandomColor();
+        const DrawSettings settings = RandomDrawSettings();
+        const DitherRow dither = RandomDither(settings);
+
+        Line expected = RandomLine();
+        Line actual = expected;
+        reference.m_shade(expected.data() + x, x, count, color, dither, settings);
+        kernels.m_shade(actual.data() + x, x, count, color, dither, settings);
+
+        ASSERT_EQ(expected, actual) << "span " << iSpan << " at " << x << ", " << count << " pixels";
+    }
+}
+
+TEST_P(SpanKernelsTest, TextureMatchesScalar)
+{
+    const SpanKernels& reference = SpanKernels::Get(SpanKernels::InstructionSet::SCALAR);
+    const SpanKernels& kernels = SpanKernels::Get(GetParam());
+
+    for (uint32_t iSpan = 0; iSpan < SPAN_COUNT; ++iSpan)
+    {
+        int32_t x, count;
+        RandomSpan(x, count);
+        const ColorStep color = RandomColor();
+        const TexCoordStep texCoord = RandomTexCoord();
+        const DrawSettings settings = RandomDrawSettings();
+        const DitherRow dither = RandomDither(settings);
+        const TextureSettings texture = RandomTexture();
+
+        Line expected = RandomLine();
+        Line actual = expected;
+        reference.m_texture(expected.data() + x, m_vram, x, count, color, texCoord, dither, settings, texture);
+        kernels.m_texture(actual.data() + x, m_vram, x, count, color, texCoord, dither, settings, texture);
+
+        ASSERT_EQ(expected, actual) << "span " << iSpan << " at " << x << ", " << count << " pixels";
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(SIMD, SpanKernelsTest,
+                         ::testing::Values(SpanKernels::InstructionSet::SSE41, SpanKernels::InstructionSet::AVX2),
+                         [](const ::testing::TestParamInfo<SpanKernels::InstructionSet>& info)
+                         {
+                             return info.param == SpanKernels::InstructionSet::SSE41 ? "SSE41" : "AVX2";
+                         });
@@ -0,0 +1,189 @@
+#include "video/rasterizer.h"
+#include "video/spankernels.h"
+#include "video/texturecache.h"
+#include "video/vram.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+using namespace PSEmu;
+
+namespace
+{
+
+// Texture page and palette of the tests, on the lines of a 320x240 frame buffer next to them
+constexpr uint32_t PAGE_X = 0;
+constexpr uint32_t PAGE_Y = 0;
+constexpr uint32_t CLUT_X = 0;
+constexpr uint32_t CLUT_Y = 300;
+constexpr int32_t FRAME_BUFFER_LEFT = 320;
+constexpr int32_t FRAME_BUFFER_TOP = 0;
+
+// Draws the same primitives with the texels decoded by the texture cache, and with the texels sampled from
+// the VRAM: both must give the same pixels, whatever was written to the VRAM in between
+class TextureCacheTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        // Both sample the texels the same way
+        m_rasterizer.SetSpanKernels(SpanKernels::Get(SpanKernels::InstructionSet::SCALAR));
+
+        std::mt19937 random{ 1234 };
+        for (uint32_t y = 0; y < VRAM::HEIGHT; ++y)
+        {
+            for (uint32_t x = 0; x < VRAM::WIDTH; ++x)
+            {
+                Write(x, y, static_cast<uint16_t>(random()));
+            }
+        }
+    }
+
+    void Write(uint32_t x, uint32_t y, uint16_t pixel)
+    {
+        m_cached.SetPixel(x, y, pixel);
+        m_reference.SetPixel(x, y, pixel);
+    }
+
+    // Textured quad in the frame buffer, sampling the texels from line <top> to line <bottom> down its height
+    Primitive MakeQuad(TextureDepth depth, uint8_t top, uint8_t bottom) const
+    {
+        Primitive primitive;
+        primitive.m_texturing = Rasterizer::Texturing::BLENDED;
+        primitive.m_vertexCount = 4;
+
+        const int32_t left = FRAME_BUFFER_LEFT;
+        const int32_t right = FRAME_BUFFER_LEFT + 255;
+        const int32_t height = std::abs(bottom - top);
+        primitive.m_vertices[0] = { left, FRAME_BUFFER_TOP, 0x808080, 0, top };
+        primitive.m_vertices[1] = { right, FRAME_BUFFER_TOP, 0x808080, 255, top };
+        primitive.m_vertices[2] = { left, FRAME_BUFFER_TOP + height, 0x808080, 0, bottom };
+        primitive.m_vertices[3] = { right, FRAME_BUFFER_TOP + height, 0x808080, 255, bottom };
+
+        primitive.m_settings.m_areaRight = VRAM::WIDTH - 1;
+        primitive.m_settings.m_areaBottom = VRAM::HEIGHT - 1;
+
+        primitive.m_texture.m_pageX = PAGE_X;
+        primitive.m_texture.m_pageY = PAGE_Y;
+        primitive.m_texture.m_depth = depth;
+        primitive.m_texture.m_clutX = CLUT_X;
+        primitive.m_texture.m_clutY = CLUT_Y;
+        return primitive;
+    }
+
+    void Draw(const Primitive& primitive)
+    {
+        Primitive cachedPrimitive = primitive;
+        m_textureCache.Prepare(m_cached, cachedPrimitive);
+        ASSERT_NE(nullptr, cachedPrimitive.m_texture.m_texels) << "The texels aren't decoded by the cache";
+        m_rasterizer.Draw(m_cached, cachedPrimitive);
+        m_textureCache.StartBatch();
+
+        m_rasterizer.Draw(m_reference, primitive);
+    }
+
+    void ExpectSameVRAM() const
+    {
+        for (uint32_t y = 0; y < VRAM::HEIGHT; ++y)
+        {
+            ASSERT_EQ(0, std::memcmp(m_cached.GetLine(y), m_reference.GetLine(y), VRAM::WIDTH * sizeof(uint16_t)))
+                << "line " << y << " differs";
+        }
+    }
+
+protected:
+    VRAM m_cached;
+    VRAM m_reference;
+    Rasterizer m_rasterizer;
+    TextureCache m_textureCache;
+};
+
+}   // end anonymous namespace
+
+TEST_F(TextureCacheTest, ClutWrite)
+{
+    for (const TextureDepth depth : { TextureDepth::T4BIT, TextureDepth::T8BIT })
+    {
+        const Primitive primitive = MakeQuad(depth, 0, 200);
+        Draw(primitive);
+
+        // A palette entry changes, while the texels don't
+        const uint32_t entries = depth == TextureDepth::T4BIT ? 16 : 256;
+        for (uint32_t entry = 0; entry < entries; entry += 5)
+        {
+            Write(CLUT_X + entry, CLUT_Y, static_cast<uint16_t>(0x7C00 | entry));
+            Draw(primitive);
+            ExpectSameVRAM();
+        }
+    }
+}
+
+// The frame buffer lines hold the texels too: drawing there marks their VRAM page as written, without changing the texels
+TEST_F(TextureCacheTest, TexelWriteOnFrameBufferPage)
+{
+    for (const TextureDepth depth : { TextureDepth::T4BIT, TextureDepth::T8BIT, TextureDepth::T15BIT })
+    {
+        const Primitive primitive = MakeQuad(depth, 0, 200);
+        Draw(primitive);
+        Draw(primitive);
+        ExpectSameVRAM();
+
+        // A texel changes on a line the quad was just drawn over
+        for (uint32_t v = 0; v < 200; v += 7)
+        {
+            Write(PAGE_X + v % 64, PAGE_Y + v, static_cast<uint16_t>(0x1234 + v));
+            Draw(primitive);
+            ExpectSameVRAM();
+        }
+    }
+}
+
+// The texture window moves the texture coordinates out of the lines covered by the vertices
+TEST_F(TextureCacheTest, TextureWindow)
+{
+    Primitive primitive = MakeQuad(TextureDepth::T15BIT, 16, 31);
+    Draw(primitive);
+
+    // Lines 48 to 63 are read instead of 16 to 31, after they changed
+    for (uint32_t v = 48; v < 64; ++v)
+    {
+        Write(PAGE_X + v, PAGE_Y + v, static_cast<uint16_t>(0x4321 + v));
+    }
+
+    primitive.m_texture.m_windowMaskY = 0x1F;
+    primitive.m_texture.m_windowOffsetY = 48 / 8;
+    Draw(primitive);
+    ExpectSameVRAM();
+}
+
+// The lines decoded for a primitive are estimated from the texture coordinates of its vertices, with a line of margin
+// on each side. The first and last lines must be decoded again once written, and so must the margins, wrapping around.
+TEST_F(TextureCacheTest, LinesAroundVertices)
+{
+    for (const uint8_t top : { 0, 1, 100, 250 })
+    {
+        const uint8_t bottom = static_cast<uint8_t>(std::min(top + 5, 255));
+        Draw(MakeQuad(TextureDepth::T15BIT, top, bottom));
+
+        // The first and last lines, and the lines just out of them
+        for (const uint32_t v : { top + 255u, top + 0u, bottom + 0u, bottom + 1u })
+        {
+            for (uint32_t u = 0; u < 256; ++u)
+            {
+                Write(PAGE_X + u, PAGE_Y + v % 256, static_cast<uint16_t>(0x0421 * (u % 31) + v));
+            }
+        }
+
+        Draw(MakeQuad(TextureDepth::T15BIT, top, bottom));
+        ExpectSameVRAM();
+
+        // Sampled the other way around
+        Draw(MakeQuad(TextureDepth::T15BIT, bottom, top));
+        ExpectSameVRAM();
+    }
+}
@@ -0,0 +1,244 @@
+#include "video/rasterizer.h"
+#include "video/texturecache.h"
+#include "video/tilerasterizer.h"
+#include "video/vram.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace PSEmu;
+
+namespace
+{
+
+constexpr uint32_t PRIMITIVE_COUNT = 1000;
+
+// Same content in every VRAM filled with the same seed
+void FillVRAM(VRAM& vram, uint32_t seed)
+{
+    std::mt19937 random{ seed };
+    for (uint32_t y = 0; y < VRAM::HEIGHT; ++y)
+    {
+        uint16_t* line = vram.GetLineForWrite(y);
+        for (uint32_t x = 0; x < VRAM::WIDTH; ++x)
+        {
+            line[x] = static_cast<uint16_t>(random());
+        }
+    }
+}
+
+// The way the GPU draws without the tile rasterizer
+void DrawSequentially(VRAM& vram, const std::vector<Primitive>& primitives)
+{
+    Rasterizer rasterizer;
+    TextureCache textureCache;
+
+    for (Primitive primitive : primitives)
+    {
+        textureCache.Prepare(vram, primitive);
+        rasterizer.Draw(vram, primitive);
+        textureCache.StartBatch();
+    }
+}
+
+void DrawTiled(VRAM& vram, const std::vector<Primitive>& primitives, size_t threadCount)
+{
+    Rasterizer rasterizer;
+    TextureCache textureCache;
+    TileRasterizer tileRasterizer{ vram, rasterizer, textureCache, threadCount };
+
+    for (const Primitive& primitive : primitives)
+    {
+        tileRasterizer.Draw(primitive);
+    }
+    tileRasterizer.Flush();
+}
+
+// Draws <primitives> in parallel with each thread count, which must give the pixels they give one after the other
+class TileRasterizerTest : public ::testing::TestWithParam<size_t>
+{
+protected:
+    void ExpectSameVRAM(const std::vector<Primitive>& primitives)
+    {
+        VRAM expected;
+        FillVRAM(expected, 42);
+        DrawSequentially(expected, primitives);
+
+        VRAM actual;
+        FillVRAM(actual, 42);
+        DrawTiled(actual, primitives, GetParam());
+
+        for (uint32_t y = 0; y < VRAM::HEIGHT; ++y)
+        {
+            ASSERT_EQ(0, std::memcmp(expected.GetLine(y), actual.GetLine(y), VRAM::WIDTH * sizeof(uint16_t)))
+                << "line " << y << " differs";
+        }
+    }
+
+    // Vertices can be out of the VRAM, to clip the primitives against its edges
+    Vertex RandomVertex(int32_t left, int32_t top, int32_t width, int32_t height)
+    {
+        Vertex vertex;
+        vertex.m_x = left + static_cast<int32_t>(m_random() % static_cast<uint32_t>(width));
+        vertex.m_y = top + static_cast<int32_t>(m_random() % static_cast<uint32_t>(height));
+        vertex.m_color = m_random() & 0xFFFFFF;
+        vertex.m_u = static_cast<uint8_t>(m_random());
+        vertex.m_v = static_cast<uint8_t>(m_random());
+        return vertex;
+    }
+
+    Primitive RandomPrimitive(int32_t left, int32_t top, int32_t width, int32_t height)
+    {
+        Primitive primitive;
+        primitive.m_shading = (m_random() & 1) ? Rasterizer::Shading::GOURAUD : Rasterizer::Shading::FLAT;
+        primitive.m_vertexCount = (m_random() & 1) ? 4 : 3;
+        for (Vertex& vertex : primitive.m_vertices)
+        {
+            vertex = RandomVertex(left, top, width, height);
+        }
+
+        DrawSettings& settings = primitive.m_settings;
+        settings.m_areaLeft = static_cast<int32_t>(m_random() % 64);
+        settings.m_areaTop = static_cast<int32_t>(m_random() % 64);
+        settings.m_areaRight = static_cast<int32_t>(VRAM::WIDTH - 1 - m_random() % 64);
+        settings.m_areaBottom = static_cast<int32_t>(VRAM::HEIGHT - 1 - m_random() % 64);
+        settings.m_dithering = (m_random() & 1) != 0;
+        settings.m_forceSetMaskBit = (m_random() % 4) == 0;
+        settings.m_preserveMaskedPixels = (m_random() % 4) == 0;
+        return primitive;
+    }
+
+    // Textured from the page at <pageX>, <pageY>, with its palette at <clutX>, <clutY>
+    Primitive RandomTexturedPrimitive(int32_t left, int32_t top, int32_t width, int32_t height,
+                                      uint32_t pageX, uint32_t pageY, uint32_t clutX, uint32_t clutY)
+    {
+        Primitive primitive = RandomPrimitive(left, top, width, height);
+        primitive.m_texturing = Rasterizer::Texturing::BLENDED;
+
+        TextureSettings& texture = primitive.m_texture;
+        texture.m_pageX = pageX;
+        texture.m_pageY = pageY;
+        texture.m_depth = static_cast<TextureDepth>(m_random() % 3);
+        texture.m_clutX = clutX;
+        texture.m_clutY = clutY;
+        if (m_random() % 4 == 0)
+        {
+            texture.m_windowMaskX = m_random() & 0x1F;
+            texture.m_windowMaskY = m_random() & 0x1F;
+            texture.m_windowOffsetX = m_random() & 0x1F;
+            texture.m_windowOffsetY = m_random() & 0x1F;
+        }
+        return primitive;
+    }
+
+protected:
+    std::mt19937 m_random{ 1234 };
+};
+
+}   // end anonymous namespace
+
+// Large primitives each covering many tiles, drawn over each other
+TEST_P(TileRasterizerTest, OverlappingPrimitives)
+{
+    std::vector<Primitive> primitives;
+    for (uint32_t iPrimitive = 0; iPrimitive < PRIMITIVE_COUNT; ++iPrimitive)
+    {
+        primitives.push_back(RandomPrimitive(-64, -64, VRAM::WIDTH + 128, VRAM::HEIGHT + 128));
+    }
+
+    ExpectSameVRAM(primitives);
+}
+
+// Textured primitives sample the pages and palettes written by the primitives drawn before them,
+// and write the pages sampled by the ones drawn after them
+TEST_P(TileRasterizerTest, TextureFeedback)
+{
+    std::vector<Primitive> primitives;
+    for (uint32_t iPrimitive = 0; iPrimitive < PRIMITIVE_COUNT; ++iPrimitive)
+    {
+        const uint32_t pageX = (m_random() % 4) * 64;
+        const uint32_t pageY = (m_random() % 2) * 256;
+        const uint32_t clutX = 512 + (m_random() % 4) * 16;
+        const uint32_t clutY = m_random() % VRAM::HEIGHT;
+
+        if (m_random() % 2 == 0)
+        {
+            // Small, over the pages, the palettes, or elsewhere
+            const int32_t left = static_cast<int32_t>(m_random() % 640);
+            const int32_t top = static_cast<int32_t>(m_random() % VRAM::HEIGHT);
+            primitives.push_back(RandomPrimitive(left, top, 96, 96));
+        }
+        else
+        {
+            primitives.push_back(RandomTexturedPrimitive(640, 0, VRAM::WIDTH - 640, VRAM::HEIGHT, pageX, pageY, clutX, clutY));
+        }
+    }
+
+    ExpectSameVRAM(primitives);
+}
+
+// Once the texture cache holds no more pages for the pending primitives, they sample the VRAM when they are drawn:
+// the primitives written after them over their page must be drawn after them
+TEST_P(TileRasterizerTest, WritesOverPendingTexels)
+{
+    std::vector<Primitive> primitives;
+    while (primitives.size() < PRIMITIVE_COUNT)
+    {
+        // Each palette takes a page of the texture cache. The 8 bit ones span 256 pixels: none is drawn over.
+        for (uint32_t clutY = 0; clutY < 24; ++clutY)
+        {
+            Primitive primitive = RandomTexturedPrimitive(640, 0, VRAM::WIDTH - 640, VRAM::HEIGHT, 0, 0, 256, clutY);
+            primitive.m_texture.m_depth = TextureDepth::T8BIT;
+            primitives.push_back(primitive);
+        }
+
+        primitives.push_back(RandomPrimitive(0, 0, 256, 256));
+    }
+
+    ExpectSameVRAM(primitives);
+}
+
+// Textured primitives drawing over their own page or palette read the texels they write
+TEST_P(TileRasterizerTest, DrawsOverTexels)
+{
+    std::vector<Primitive> primitives;
+    uint32_t drawingOverTexels = 0;
+    for (uint32_t iPrimitive = 0; iPrimitive < PRIMITIVE_COUNT; ++iPrimitive)
+    {
+        const uint32_t pageX = (m_random() % 16) * 64;
+        const uint32_t pageY = (m_random() % 2) * 256;
+
+        Primitive primitive;
+        if (m_random() % 2 == 0)
+        {
+            // Over its page, the right part of which wraps around the right edge of the VRAM
+            primitive = RandomTexturedPrimitive(static_cast<int32_t>(pageX), static_cast<int32_t>(pageY), 256, 256,
+                                                pageX, pageY, m_random() % VRAM::WIDTH, m_random() % VRAM::HEIGHT);
+        }
+        else
+        {
+            // Over its palette only
+            const uint32_t clutX = (m_random() % 48) * 16;
+            const uint32_t clutY = m_random() % VRAM::HEIGHT;
+            primitive = RandomTexturedPrimitive(static_cast<int32_t>(clutX), static_cast<int32_t>(clutY) - 32, 256, 64,
+                                                pageX, pageY, clutX, clutY);
+        }
+
+        drawingOverTexels += primitive.DrawsOverTexels() ? 1 : 0;
+        primitives.push_back(primitive);
+
+        // Untextured primitives in between, pending in the tiles when the next one is drawn
+        primitives.push_back(RandomPrimitive(-64, -64, VRAM::WIDTH + 128, VRAM::HEIGHT + 128));
+    }
+
+    // 15 bit textures have no palette to draw over, and some primitives are clipped away by the drawing area
+    ASSERT_GT(drawingOverTexels, PRIMITIVE_COUNT / 2);
+
+    ExpectSameVRAM(primitives);
+}
+
+INSTANTIATE_TEST_SUITE_P(Threads, TileRasterizerTest, ::testing::Values(1, 2, 4, 7));